@@ -0,0 +1,144 @@
+#include "arena.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Allocations are aligned to the strictest alignment of the basic types
+#define ARENA_ALIGNMENT 16
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+// The block header is padded, so that the memory after it is aligned
+#define ARENA_BLOCK_HEADER_SIZE ALIGN_UP(sizeof(ArenaBlock))
+
+/**
+ * Returns the memory of the given block, which follows its header.
+ * */
+static char* getBlockData(ArenaBlock* block)
+{
+    return (char*)block + ARENA_BLOCK_HEADER_SIZE;
+}
+
+void initArena(Arena* arena, size_t blockSize)
+{
+    arena->blocks = NULL;
+    arena->current = NULL;
+    arena->last = NULL;
+    arena->blockSize = blockSize ? ALIGN_UP(blockSize) : ARENA_BLOCK_SIZE;
+}
+
+void deleteArena(Arena* arena)
+{
+    if(!arena) return;
+
+    ArenaBlock* block = arena->blocks;
+
+    while(block)
+    {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    initArena(arena, arena->blockSize);
+}
+
+void resetArena(Arena* arena)
+{
+    if(!arena) return;
+
+    // The rest of the blocks are reset once allocation reaches them
+    arena->current = arena->blocks;
+    arena->last = NULL;
+
+    if(arena->current)
+        arena->current->used = 0;
+}
+
+void* allocArena(Arena* arena, size_t size)
+{
+    size = ALIGN_UP(size ? size : 1);
+
+    // Move on to the next block until one with enough room is found. The
+    // .. blocks are reused in order, so the ones after current are free.
+    ArenaBlock* tail = NULL;
+
+    while(arena->current && arena->current->size - arena->current->used < size)
+    {
+        tail = arena->current;
+        arena->current = arena->current->next;
+
+        if(arena->current)
+            arena->current->used = 0;
+    }
+
+    if(!arena->current)
+    {
+        size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+
+        ArenaBlock* block = (ArenaBlock*)malloc(ARENA_BLOCK_HEADER_SIZE + blockSize);
+
+        if(!block)
+        {
+            // Leave the arena at its last block
+            arena->current = tail;
+            return NULL;
+        }
+
+        STATS_ALLOCATION();
+
+        block->size = blockSize;
+        block->used = 0;
+        block->next = NULL;
+
+        // Append the block to the end of the list
+        if(tail) tail->next = block;
+        else     arena->blocks = block;
+
+        arena->current = block;
+    }
+
+    void* ptr = getBlockData(arena->current) + arena->current->used;
+
+    arena->current->used += size;
+    arena->last = ptr;
+
+    return ptr;
+}
+
+void* arenaRealloc(Arena* arena, void* ptr, size_t oldSize, size_t newSize)
+{
+    if(ptr) STATS_REALLOCATION();
+
+    if(!arena)
+    {
+        if(!ptr) STATS_ALLOCATION();
+
+        return realloc(ptr, newSize);
+    }
+
+    // The latest allocation can grow or shrink in place
+    if(ptr && ptr == arena->last)
+    {
+        ArenaBlock* block = arena->current;
+        size_t start = (char*)ptr - getBlockData(block);
+
+        if(ALIGN_UP(newSize) <= block->size - start)
+        {
+            block->used = start + ALIGN_UP(newSize ? newSize : 1);
+            return ptr;
+        }
+    }
+
+    void* newPtr = allocArena(arena, newSize);
+
+    if(newPtr && ptr)
+        memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+
+    return newPtr;
+}
+
+void arenaFree(Arena* arena, void* ptr)
+{
+    if(!arena) free(ptr);
+}
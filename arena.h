@@ -0,0 +1,68 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (1 << 16)
+
+/**
+ * Block of memory that an arena allocates from.
+ * */
+typedef struct ArenaBlock ArenaBlock;
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t size;
+    size_t used;
+};
+
+/**
+ * Bump pointer allocator. Allocations are carved out of large blocks and
+ * .. are never freed one by one. Instead, resetArena() makes all the memory
+ * .. of the arena available again at once, keeping the blocks for reuse.
+ *
+ * blocks is the list of the blocks of the arena, current is the one being
+ * .. allocated from, and last is the latest allocation, which is the only
+ * .. one that can grow in place.
+ * */
+typedef struct {
+    ArenaBlock* blocks;
+    ArenaBlock* current;
+    void* last;
+    size_t blockSize;
+} Arena;
+
+/**
+ * Initializes the given arena. Blocks are at least the given number of
+ * .. bytes, or ARENA_BLOCK_SIZE if it is 0.
+ * */
+void initArena(Arena*, size_t);
+
+/**
+ * Frees all the blocks of the given arena.
+ * */
+void deleteArena(Arena*);
+
+/**
+ * Makes all the memory of the given arena available again in O(1).
+ * Everything allocated from the arena becomes invalid.
+ * */
+void resetArena(Arena*);
+
+/**
+ * Allocates the given number of bytes from the given arena, aligned for any
+ * .. type. Returns NULL if the allocation failed.
+ * */
+void* allocArena(Arena*, size_t);
+
+/**
+ * Helpers for the data structures that can allocate either from an arena or
+ * .. from the heap. If the given arena is NULL, they behave as realloc() and
+ * .. free(). Otherwise, arenaRealloc() grows the latest allocation in place
+ * .. when possible and copies it otherwise, which should be given the old
+ * .. size of the memory, and arenaFree() does nothing.
+ * */
+void* arenaRealloc(Arena*, void*, size_t, size_t);
+void arenaFree(Arena*, void*);
+
+#endif
@@ -0,0 +1,348 @@
+#include "ast.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Capacity of the first allocation of the node pool
+#define AST_MIN_CAPACITY 64
+
+static const char* astKindNames[] = {
+    [AST_PROGRAM] = "PROGRAM",
+    [AST_BLOCK] = "BLOCK",
+    [AST_CONST_DECLARATION] = "CONST_DECLARATION",
+    [AST_VAR_DECLARATION] = "VAR_DECLARATION",
+    [AST_PROC_DECLARATION] = "PROC_DECLARATION",
+    [AST_ASSIGN] = "ASSIGN",
+    [AST_CALL] = "CALL",
+    [AST_BEGIN] = "BEGIN",
+    [AST_IF] = "IF",
+    [AST_WHILE] = "WHILE",
+    [AST_WRITE] = "WRITE",
+    [AST_READ] = "READ",
+    [AST_EMPTY] = "EMPTY",
+    [AST_ODD] = "ODD",
+    [AST_RELATION] = "RELATION",
+    [AST_BINARY] = "BINARY",
+    [AST_NEGATE] = "NEGATE",
+    [AST_IDENTIFIER] = "IDENTIFIER",
+    [AST_NUMBER] = "NUMBER"
+};
+
+// The operators, as they are written in the source
+static const char* operatorTexts[] = {
+    [plussym] = "+", [minussym] = "-", [multsym] = "*", [slashsym] = "/",
+    [eqsym] = "=", [neqsym] = "<>", [lessym] = "<", [leqsym] = "<=",
+    [gtrsym] = ">", [geqsym] = ">="
+};
+
+static const char* symbolTypeNames[] = {
+    [CONST] = "const", [VAR] = "var", [PROC] = "procedure"
+};
+
+void initAst(Ast* ast, Arena* arena)
+{
+    ast->nodes = NULL;
+    ast->numberOfNodes = 0;
+    ast->capacity = 0;
+
+    ast->root = -1;
+    ast->incomplete = 0;
+
+    ast->arena = arena;
+}
+
+void deleteAst(Ast* ast)
+{
+    if(!ast) return;
+
+    arenaFree(ast->arena, ast->nodes);
+
+    initAst(ast, ast->arena);
+}
+
+void clearAst(Ast* ast)
+{
+    ast->numberOfNodes = 0;
+    ast->root = -1;
+    ast->incomplete = 0;
+}
+
+void initAstStack(AstStack* stack)
+{
+    stack->frames = NULL;
+    stack->depth = 0;
+    stack->capacity = 0;
+}
+
+void deleteAstStack(AstStack* stack)
+{
+    if(!stack) return;
+
+    free(stack->frames);
+
+    initAstStack(stack);
+}
+
+AstFrame* pushAstFrame(AstStack* stack, const Ast* ast, int node, int state)
+{
+    // Double the capacity if the stack is full
+    if(stack->depth == stack->capacity)
+    {
+        int capacity = stack->capacity ? stack->capacity * 2 : AST_MIN_CAPACITY;
+
+        AstFrame* frames = realloc(stack->frames, capacity * sizeof(AstFrame));
+
+        if(!frames) return NULL;
+
+        stack->frames = frames;
+        stack->capacity = capacity;
+    }
+
+    AstFrame* frame = &stack->frames[stack->depth++];
+
+    frame->node = node;
+    frame->state = state;
+    frame->child = ast->nodes[node].firstChild;
+    frame->saved[0] = -1;
+    frame->saved[1] = -1;
+
+    return frame;
+}
+
+int addAstNode(Ast* ast, AstKind kind, int op, int level, int value, int symbol)
+{
+    // Double the capacity if the pool is full
+    if(ast->numberOfNodes == ast->capacity)
+    {
+        int capacity = ast->capacity ? ast->capacity * 2 : AST_MIN_CAPACITY;
+
+        AstNode* nodes = arenaRealloc(ast->arena, ast->nodes, ast->capacity * sizeof(AstNode), capacity * sizeof(AstNode));
+
+        if(!nodes)
+        {
+            ast->incomplete = 1;
+            return -1;
+        }
+
+        ast->nodes = nodes;
+        ast->capacity = capacity;
+    }
+
+    int ind = ast->numberOfNodes++;
+    AstNode* node = &ast->nodes[ind];
+
+    node->kind = (unsigned char)kind;
+    node->op = (unsigned char)op;
+    node->level = (unsigned short)level;
+    node->firstChild = -1;
+    node->nextSibling = -1;
+    node->value = value;
+    node->symbol = symbol;
+    node->firstToken = -1;
+    node->endToken = -1;
+
+    return ind;
+}
+
+/**
+ * Copies the given node, without its children, to the given index of the
+ * .. given pool, and pushes its frame on the given stack of the copy, the
+ * .. saved numbers of which are the copy and the copy of the latest child
+ * .. that is copied. Returns 0 if the stack cannot grow.
+ * */
+static int pushAstCopy(AstStack* stack, const Ast* ast, int ind, AstNode* nodes, int copy)
+{
+    nodes[copy] = ast->nodes[ind];
+    nodes[copy].firstChild = -1;
+    nodes[copy].nextSibling = -1;
+
+    AstFrame* frame = pushAstFrame(stack, ast, ind, 0);
+
+    if(!frame) return 0;
+
+    frame->saved[0] = copy;
+    frame->saved[1] = -1;
+
+    return 1;
+}
+
+/**
+ * Copies the given node and its children to the beginning of the given
+ * .. pool, in depth first order, and returns the number of copied nodes, or
+ * .. -1 if the stack of the copy cannot be allocated
+ * */
+static int copyAstNode(const Ast* ast, int ind, AstNode* nodes)
+{
+    AstStack stack;
+    initAstStack(&stack);
+
+    int next = 0;
+
+    if(!pushAstCopy(&stack, ast, ind, nodes, next++))
+        next = -1;
+
+    while(next >= 0 && stack.depth > 0)
+    {
+        AstFrame* frame = &stack.frames[stack.depth - 1];
+        int child = frame->child;
+
+        // Leave the node once its children are all copied
+        if(child < 0)
+        {
+            stack.depth--;
+            continue;
+        }
+
+        frame->child = ast->nodes[child].nextSibling;
+
+        if(frame->saved[1] < 0)
+            nodes[frame->saved[0]].firstChild = next;
+        else
+            nodes[frame->saved[1]].nextSibling = next;
+
+        frame->saved[1] = next;
+
+        if(!pushAstCopy(&stack, ast, child, nodes, next++))
+            next = -1;
+    }
+
+    deleteAstStack(&stack);
+
+    return next;
+}
+
+int compactAst(Ast* ast)
+{
+    if(!ast || ast->root < 0) return 1;
+
+    AstNode* nodes = arenaRealloc(ast->arena, NULL, 0, ast->capacity * sizeof(AstNode));
+
+    if(!nodes) return 0;
+
+    int numberOfNodes = copyAstNode(ast, ast->root, nodes);
+
+    if(numberOfNodes < 0)
+    {
+        arenaFree(ast->arena, nodes);
+        return 0;
+    }
+
+    ast->numberOfNodes = numberOfNodes;
+    ast->root = 0;
+
+    arenaFree(ast->arena, ast->nodes);
+    ast->nodes = nodes;
+
+    return 1;
+}
+
+int getAstChildCount(const Ast* ast, int node)
+{
+    int count = 0;
+
+    for(int child = ast->nodes[node].firstChild; child >= 0; child = ast->nodes[child].nextSibling)
+        count++;
+
+    return count;
+}
+
+const char* getAstKindName(AstKind kind)
+{
+    if(kind < AST_PROGRAM || kind > AST_NUMBER) return "(null)";
+
+    return astKindNames[kind];
+}
+
+/**
+ * Writes the line of the given node, indented by the given depth
+ * */
+static void printAstNode(const Ast* ast, int ind, int depth, const InternPool* names, const SymbolTable* symbolTable, Sink* out)
+{
+    const AstNode* node = &ast->nodes[ind];
+
+    for(int i = 0; i < depth; i++)
+        writeSink(out, "  ", 2);
+
+    writeSinkString(out, getAstKindName(node->kind));
+
+    switch(node->kind)
+    {
+    case AST_RELATION:
+    case AST_BINARY:
+    case AST_NEGATE:
+        if(node->op < sizeof(operatorTexts) / sizeof(operatorTexts[0]) && operatorTexts[node->op])
+        {
+            writeSink(out, " ", 1);
+            writeSinkString(out, operatorTexts[node->op]);
+        }
+        break;
+
+    case AST_NUMBER:
+        printfSink(out, " %d", node->value);
+        break;
+
+    case AST_IDENTIFIER:
+    case AST_PROC_DECLARATION:
+        if(names && node->value >= 0 && node->value < names->numberOfStrings)
+        {
+            writeSink(out, " ", 1);
+            writeSink(out, getInternedString(names, node->value), getInternedStringLength(names, node->value));
+        }
+
+        if(node->symbol < 0)
+            writeSinkString(out, " (undeclared)");
+        else if(symbolTable && node->symbol < symbolTable->numberOfSymbols)
+        {
+            const Symbol* symbol = &symbolTable->symbols[node->symbol];
+            printfSink(out, " (%s, level %u)", symbolTypeNames[symbol->type], symbol->level);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    writeSink(out, "\n", 1);
+}
+
+int printAst(const Ast* ast, const InternPool* names, const SymbolTable* symbolTable, Sink* out)
+{
+    if(!ast || !out) return 0;
+
+    writeSinkString(out, "Abstract Syntax Tree\n====================\n");
+
+    if(ast->root < 0) return 0;
+
+    AstStack stack;
+    initAstStack(&stack);
+
+    int err = 0;
+
+    if(pushAstFrame(&stack, ast, ast->root, 0))
+        printAstNode(ast, ast->root, 0, names, symbolTable, out);
+    else
+        err = -1;
+
+    // The nodes are written as they are entered, each indented by the depth of its parent's frame
+    while(!err && stack.depth > 0)
+    {
+        AstFrame* frame = &stack.frames[stack.depth - 1];
+        int child = frame->child;
+
+        if(child < 0)
+        {
+            stack.depth--;
+            continue;
+        }
+
+        frame->child = ast->nodes[child].nextSibling;
+
+        printAstNode(ast, child, stack.depth, names, symbolTable, out);
+
+        if(!pushAstFrame(&stack, ast, child, 0))
+            err = -1;
+    }
+
+    deleteAstStack(&stack);
+
+    return err;
+}
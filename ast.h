@@ -0,0 +1,241 @@
+#ifndef __AST_H__
+#define __AST_H__
+
+#include "data.h"
+#include "arena.h"
+#include "intern.h"
+#include "symbol.h"
+#include "sink.h"
+
+/**
+ * Kinds of the nodes of the abstract syntax tree. The kinds of the
+ * .. declarations have the same values as their NonTerminal entries, and the
+ * .. statements, conditions and expressions get one kind for each form.
+ *
+ * The children of each kind, in order, are:
+ * AST_PROGRAM          : BLOCK
+ * AST_BLOCK            : CONST_DECLARATION?, VAR_DECLARATION?,
+ *                        PROC_DECLARATION*, statement
+ * AST_CONST_DECLARATION, AST_VAR_DECLARATION : IDENTIFIER+, the declared
+ *                        names
+ * AST_PROC_DECLARATION : BLOCK, the procedure itself is the name
+ * AST_ASSIGN           : IDENTIFIER, expression
+ * AST_CALL, AST_READ, AST_WRITE : IDENTIFIER
+ * AST_BEGIN            : statement+
+ * AST_IF               : condition, statement, statement? (else)
+ * AST_WHILE            : condition, statement
+ * AST_EMPTY            : none
+ * AST_ODD              : expression
+ * AST_RELATION         : expression, expression
+ * AST_BINARY           : expression, expression
+ * AST_NEGATE           : expression
+ * AST_IDENTIFIER, AST_NUMBER : none
+ * */
+typedef enum {
+    AST_PROGRAM = PROGRAM,
+    AST_BLOCK = BLOCK,
+    AST_CONST_DECLARATION = CONST_DECLARATION,
+    AST_VAR_DECLARATION = VAR_DECLARATION,
+    AST_PROC_DECLARATION = PROC_DECLARATION,
+
+    // Statements
+    AST_ASSIGN,
+    AST_CALL,
+    AST_BEGIN,
+    AST_IF,
+    AST_WHILE,
+    AST_WRITE,
+    AST_READ,
+    AST_EMPTY,
+
+    // Conditions
+    AST_ODD,
+    AST_RELATION,
+
+    // Expressions
+    AST_BINARY,
+    AST_NEGATE,
+    AST_IDENTIFIER,
+    AST_NUMBER
+} AstKind;
+
+/**
+ * A node of the tree, which links to the others by their indices in the
+ * .. node pool of the tree, -1 meaning none.
+ * kind        : AstKind of the node
+ * op          : token id of the operator of RELATION, BINARY and NEGATE
+ * level       : level the node is in, 0 being the global level
+ * firstChild  : the first child of the node
+ * nextSibling : the next child of the parent of the node
+ * value       : value of NUMBER, name of IDENTIFIER and PROC_DECLARATION
+ *               as an id in the lexemes of the token list
+ * symbol      : index of the symbol that IDENTIFIER and PROC_DECLARATION
+ *               refer to in the symbol table of the parse, -1 if the name
+ *               is not declared
+ * firstToken, endToken : the tokens of PROGRAM, BLOCK, PROC_DECLARATION and
+ *               the statements, from firstToken up to but not including
+ *               endToken, as indices in the token list. -1 for the other
+ *               kinds
+ * */
+typedef struct {
+    unsigned char kind;
+    unsigned char op;
+    unsigned short level;
+    int firstChild;
+    int nextSibling;
+    int value;
+    int symbol;
+    int firstToken;
+    int endToken;
+} AstNode;
+
+/**
+ * Abstract syntax tree, with all of its nodes in one pool.
+ * root       : index of the PROGRAM node, -1 if there is no tree
+ * incomplete : not 0 if a node lacks a child, which happens when the parser
+ *              goes on after an error
+ * If arena is not NULL, the nodes are allocated from it.
+ * */
+typedef struct {
+    AstNode* nodes;
+    int numberOfNodes;
+    int capacity;
+
+    int root;
+    int incomplete;
+
+    Arena* arena;
+} Ast;
+
+/**
+ * A list of children under construction, so that children are appended in
+ * .. constant time
+ * */
+typedef struct {
+    int parent;
+    int last;
+} AstChildren;
+
+/**
+ * Frame of a node on the stack of a pass over a tree. The passes keep the
+ * .. nodes they are in on a stack of their own instead of recursing, so that
+ * .. the trees of deeply nested programs, which iterative parses build, do
+ * .. not overflow the thread stack.
+ * node  : the node
+ * state : where the pass is in the node, which is up to the pass
+ * child : the child of the node that the pass goes on with
+ * saved : what else the pass keeps till it leaves the node
+ * */
+typedef struct {
+    int node;
+    int state;
+    int child;
+    int saved[2];
+} AstFrame;
+
+/**
+ * Stack of the frames of a pass, depth of which are in use. It is allocated
+ * .. from the heap once it grows.
+ * */
+typedef struct {
+    AstFrame* frames;
+    int depth;
+    int capacity;
+} AstStack;
+
+/**
+ * Initializes the given stack to an empty one.
+ * */
+void initAstStack(AstStack*);
+
+/**
+ * Makes the necessary deallocations on the given stack, and empties it.
+ * */
+void deleteAstStack(AstStack*);
+
+/**
+ * Pushes a frame of the given node and state, whose child is the first child
+ * .. of the node, on the given stack of a pass over the given tree, doubling
+ * .. the stack if it is full. Returns the frame, which is valid till the next
+ * .. push, or NULL if the stack cannot grow.
+ * */
+AstFrame* pushAstFrame(AstStack*, const Ast*, int node, int state);
+
+/**
+ * Initializes the given tree to an empty tree, which allocates from the given
+ * .. arena, or from the heap if it is NULL.
+ * */
+void initAst(Ast*, Arena*);
+
+/**
+ * Makes the necessary deallocations on the given tree, and empties it.
+ * */
+void deleteAst(Ast*);
+
+/**
+ * Removes all the nodes of the given tree, keeping the allocated pool.
+ * */
+void clearAst(Ast*);
+
+/**
+ * Adds a node without children to the given tree and returns its index, or
+ * .. -1 if it cannot be allocated, in which case the tree is incomplete.
+ * */
+int addAstNode(Ast*, AstKind, int op, int level, int value, int symbol);
+
+/**
+ * Moves the nodes that can be reached from the root of the given tree to the
+ * .. beginning of its pool, in depth first order, and drops the others.
+ * Returns 0 if the new pool cannot be allocated, in which case the tree is
+ * .. not changed.
+ * */
+int compactAst(Ast*);
+
+/**
+ * Starts a list of children of the given node, which are then appended by
+ * .. appendAstChild().
+ * */
+static inline AstChildren getAstChildren(int parent)
+{
+    AstChildren children = { parent, -1 };
+    return children;
+}
+
+/**
+ * Appends the given node to the given list of children. If the node is -1,
+ * .. the tree is marked incomplete instead.
+ * */
+static inline void appendAstChild(Ast* ast, AstChildren* children, int child)
+{
+    if(child < 0 || children->parent < 0)
+    {
+        ast->incomplete = 1;
+        return;
+    }
+
+    if(children->last < 0) ast->nodes[children->parent].firstChild = child;
+    else                   ast->nodes[children->last].nextSibling = child;
+
+    children->last = child;
+}
+
+/**
+ * Returns the number of the children of the given node.
+ * */
+int getAstChildCount(const Ast*, int node);
+
+/**
+ * Returns the name of the given kind of node.
+ * */
+const char* getAstKindName(AstKind);
+
+/**
+ * Writes the given tree on the given sink, one node per line, indented by
+ * .. its depth. Names are looked up in the given pool, and the symbols of the
+ * .. identifiers in the given symbol table, if it is not NULL. Returns 0, or
+ * .. -1 if the stack of the nodes it is in cannot be allocated, in which
+ * .. case the tree is written in part.
+ * */
+int printAst(const Ast*, const InternPool*, const SymbolTable*, Sink*);
+
+#endif
@@ -0,0 +1,833 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+#include "token.h"
+#include "sink.h"
+#include "lexer.h"
+#include "fold.h"
+#include "codegen.h"
+#include "vm.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/**
+ * A file of the manifest
+ * */
+typedef struct {
+    const char* inputPath;
+    const char* outputPath;
+} BatchJob;
+
+/**
+ * Deque of the indices of the jobs of a worker. The owner pops from bottom,
+ * .. thieves steal from top. No job is pushed once the workers start, so a
+ * .. worker is done when all the deques are empty.
+ * */
+typedef struct {
+    pthread_mutex_t lock;
+    int* jobs;
+    int top;
+    int bottom;
+} JobDeque;
+
+typedef struct {
+    const BatchJob* jobs;
+    JobDeque* deques;
+    int numberOfWorkers;
+    ParseOptions options;
+
+    // Number of the failed jobs, written under failuresLock
+    pthread_mutex_t failuresLock;
+    int failures;
+} Batch;
+
+typedef struct {
+    Batch* batch;
+    int index;
+} Worker;
+
+/**
+ * Creates the missing parent directories of the given path, as mkdir -p does.
+ * */
+void makeParentDirectories(const char* path);
+
+/**
+ * Reads the jobs of the manifest at the given path. The paths are allocated
+ * .. from the given arena. Returns the number of jobs, or -1 on failure.
+ * */
+int readManifest(const char* path, Arena*, BatchJob**);
+
+/**
+ * Returns the index of the next job of the given worker, from its own deque
+ * .. or stolen from another one. Returns -1 if no job is left.
+ * */
+int takeJob(Batch*, int worker);
+
+void* runWorker(void*);
+
+/**
+ * Same as parseFile(), except that the tokens are streamed to the parser.
+ * */
+static int parseStream(const char* inputPath, const char* outputPath, ParseOptions options, Arena* arena, ParserContext* ctx);
+
+/**
+ * Returns the seconds since the given time, which it sets to the time now
+ * */
+static double getLapSeconds(double* start)
+{
+    double now = getStatsSeconds();
+    double lap = now - *start;
+
+    *start = now;
+
+    return lap;
+}
+
+/**
+ * Takes the results of the latest parse of the given context into the given
+ * .. stats of a run
+ * */
+static void takeParseStats(RunStats* stats, const ParserContext* ctx, int err)
+{
+    stats->err = err;
+    stats->symbols = ctx->symbolTable.numberOfSymbols;
+    stats->parser = ctx->stats;
+}
+
+/**
+ * Writes the given stats of a run to stderr, if the options ask for them,
+ * .. with the allocations the thread made since the given counters
+ * */
+static void printStats(RunStats* stats, ParseOptions options, AllocationStats start)
+{
+    if(!options.stats) return;
+
+    AllocationStats now = getAllocationStats();
+
+    stats->allocations.allocations = now.allocations - start.allocations;
+    stats->allocations.reallocations = now.reallocations - start.reallocations;
+
+    printRunStats(stats, stderr);
+}
+
+/**
+ * Writes the verdict of the latest parse of the given context, which is
+ * .. every error it found if it recovered from them
+ * */
+static void printParserVerdict(const ParserContext* ctx, const TokenList* tokenList, int err, Sink* sink)
+{
+    if(ctx->recover) printParserErrorsToSink(ctx, &tokenList->lexemes, sink);
+    else             printParserErrToSink(err, sink);
+}
+
+/**
+ * Folds the tree of the latest parse of the given context, if it has one
+ * .. and the parse succeeded, and writes it to the given sink, as the
+ * .. options say.
+ * */
+static void printParsedAst(const ParserContext* ctx, const TokenList* tokenList, ParseOptions options, int err, Sink* sink)
+{
+    if(!ctx->ast || err || ctx->ast->incomplete) return;
+
+    if(options.fold && foldAst(ctx->ast, &ctx->symbolTable) < 0)
+        fprintf(stderr, "Could not allocate the stack of the folding\n");
+
+    if(options.ast && printAst(ctx->ast, &tokenList->lexemes, &ctx->symbolTable, sink) < 0)
+        fprintf(stderr, "Could not allocate the stack of the tree\n");
+}
+
+/**
+ * Generates the code of the tree of the latest parse of the given context,
+ * .. if the parse succeeded, and writes or runs it as the options say.
+ * */
+static void runParsedAst(const ParserContext* ctx, ParseOptions options, int err, Arena* arena, Sink* sink)
+{
+    if(!(options.code || options.run) || !ctx->ast || err || ctx->ast->incomplete) return;
+
+    Code code;
+    initCode(&code, arena);
+
+    int codeGenErr = generateCode(ctx->ast, &ctx->symbolTable, &code);
+
+    if(codeGenErr < 0)
+        fprintf(stderr, "Could not allocate the code\n");
+    else if(codeGenErr)
+        printCodeGenErrToSink(codeGenErr, sink);
+    else
+    {
+        if(options.code)
+        {
+            writeSinkString(sink, "\nGenerated Code\n==============\n");
+            printCode(&code, sink);
+        }
+
+        if(options.run)
+        {
+            writeSinkString(sink, "\nProgram Output\n==============\n");
+
+            int vmErr = runCode(&code, stdin, sink, arena);
+
+            if(vmErr < 0) fprintf(stderr, "Could not allocate the stack\n");
+            else          printVmErrToSink(vmErr, sink);
+        }
+    }
+
+    deleteCode(&code);
+}
+
+/**
+ * Returns a hash of the options that change the output of a parse
+ * */
+static uint64_t hashParseOptions(ParseOptions options)
+{
+    long long fields[] = { options.mode, options.ast, options.fold, options.code, options.recover,
+                           options.iterative, options.maxDepth, (long long)options.maxStackSize,
+                           options.symbolFormat };
+
+    return hashCacheBytes(fields, sizeof(fields), 0);
+}
+
+/**
+ * Writes the symbol table of the given context, which the parse with the
+ * .. given error code left, next to the output file at the given path if
+ * .. the options export the symbols, or removes the one of an earlier run
+ * .. if the parse failed. Returns 0 on success, -1 if it cannot be written.
+ * */
+static int exportSymbolTable(ParserContext* ctx, const char* outputPath, ParseOptions options, int err)
+{
+    if(!options.exportSymbols) return 0;
+
+    size_t length = strlen(outputPath);
+    char* path = malloc(length + sizeof(SYMBOL_TABLE_EXTENSION));
+
+    if(!path) return -1;
+
+    memcpy(path, outputPath, length);
+    memcpy(path + length, SYMBOL_TABLE_EXTENSION, sizeof(SYMBOL_TABLE_EXTENSION));
+
+    int ret = 0;
+
+    if(err)
+        remove(path);
+    else
+    {
+        FILE* out = fopen(path, "wb");
+
+        if(!out || writeBinarySymbolTable(&ctx->symbolTable, out) != 0) ret = -1;
+        if(out && fclose(out) != 0) ret = -1;
+
+        if(ret != 0) fprintf(stderr, "Could not write \"%s\"\n", path);
+    }
+
+    free(path);
+
+    return ret;
+}
+
+/**
+ * Parses the given token list of the file at the given path as the options
+ * .. say, and writes the output to the given file, unless the parse cache of
+ * .. the options has the output already, in which case it is written from
+ * .. there without parsing. Sets the stats of the run from the given start
+ * .. of the phase after loading on. The symbols are exported next to the
+ * .. file at outputPath, if the options say so.
+ * Returns 1 on success, 0 if the output cannot be buffered or written.
+ * */
+static int parseTokenList(TokenList* tokenList, const char* inputPath, const char* outputPath, ParseOptions options,
+                          Arena* arena, ParserContext* ctx, FILE* outp, RunStats* stats, double phaseStart)
+{
+    // The output only depends on the tokens and the options, unless the code
+    // .. is run, and reads stdin. A hit would not export the symbols.
+    int cacheable = options.cache && !options.run && !options.exportSymbols;
+    uint64_t cacheKey = 0;
+
+    if(cacheable)
+    {
+        cacheKey = getParseCacheKey(options.cache, tokenList, hashParseOptions(options));
+
+        CachedParse parse;
+        int hit = lookupParseCache(options.cache, cacheKey, tokenList->numberOfTokens, outp, &parse);
+
+        if(hit)
+        {
+            stats->cached = 1;
+            stats->err = parse.err;
+            stats->symbols = parse.symbols;
+            stats->parser.tokens = parse.tokens;
+            stats->emitSeconds = getLapSeconds(&phaseStart);
+
+            return hit > 0;
+        }
+
+        // Hashing reads all the tokens once more
+        stats->loadSeconds += getLapSeconds(&phaseStart);
+    }
+
+    // The output of a parse to cache is read back from the output file once
+    // .. it is complete, see parseFile(), unless it is not a regular file,
+    // .. such as a pipe, in which case it is buffered
+    struct stat outputStat;
+    int readBack = cacheable && fstat(fileno(outp), &outputStat) == 0 && S_ISREG(outputStat.st_mode);
+
+    char* output = NULL;
+    size_t outputSize = 0;
+    FILE* out = cacheable && !readBack ? open_memstream(&output, &outputSize) : NULL;
+
+    // The parsing history and the error message go through one sink
+    Sink sink;
+    initSink(&sink, out ? out : outp);
+
+    // The tree lives as long as the rest of the parse, in the arena
+    Ast ast;
+    initAst(&ast, arena);
+    ctx->ast = options.ast || options.code || options.run ? &ast : NULL;
+    ctx->mode = options.mode;
+    ctx->symbolFormat = options.symbolFormat;
+    ctx->recover = options.recover;
+    ctx->iterative = options.iterative;
+    ctx->maxDepth = options.maxDepth;
+    ctx->maxStackSize = options.maxStackSize;
+    ctx->parallel = options.parallel;
+
+    int err = parser_ctx(ctx, tokenList, &sink);
+
+    stats->parseSeconds = getLapSeconds(&phaseStart);
+    takeParseStats(stats, ctx, err);
+
+    int ret = exportSymbolTable(ctx, outputPath, options, err) == 0;
+
+    printParsedAst(ctx, tokenList, options, err, &sink);
+    printParserVerdict(ctx, tokenList, err, &sink);
+
+    stats->emitSeconds = getLapSeconds(&phaseStart);
+
+    runParsedAst(ctx, options, err, arena, &sink);
+
+    stats->codeSeconds = getLapSeconds(&phaseStart);
+
+    deleteSink(&sink);
+
+    ctx->ast = NULL;
+    deleteAst(&ast);
+
+    CachedParse parse = { stats->err, stats->symbols, stats->parser.tokens };
+
+    if(out)
+    {
+        if(fclose(out) == 0 && output)
+        {
+            ret = fwrite(output, 1, outputSize, outp) == outputSize;
+
+            storeParseCache(options.cache, cacheKey, tokenList->numberOfTokens, parse, output, outputSize);
+        }
+        else
+        {
+            fprintf(stderr, "Could not buffer the output of \"%s\"\n", inputPath);
+            ret = 0;
+        }
+
+        free(output);
+    }
+    else if(readBack && fflush(outp) == 0)
+    {
+        long size = ftell(outp);
+        void* mapping = size > 0 ? mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(outp), 0) : NULL;
+
+        if(size == 0)
+            storeParseCache(options.cache, cacheKey, tokenList->numberOfTokens, parse, "", 0);
+        else if(size > 0 && mapping != MAP_FAILED)
+        {
+            storeParseCache(options.cache, cacheKey, tokenList->numberOfTokens, parse, mapping, size);
+            munmap(mapping, size);
+        }
+    }
+
+    stats->emitSeconds += getLapSeconds(&phaseStart);
+
+    return ret;
+}
+
+int parseOpenFiles(const char* inputPath, const char* outputPath, FILE* inp, FILE* outp, ParseOptions options,
+                   Arena* arena, ParserContext* ctx, int* err)
+{
+    // Read the token list. Binary token lists are recognized by their magic
+    // .. number and mapped without copying. PL/0 source, which does not start
+    // .. with the token list header, is lexed right into the token list.
+    TokenList tokenList;
+    int lexerErr = 0;
+
+    // Times and counters of the phases, for --stats
+    RunStats stats = { .input = inputPath };
+    AllocationStats allocations = getAllocationStats();
+    double phaseStart = getStatsSeconds();
+
+    if(isBinaryTokenList(inp))
+        tokenList = mapBinaryTokenList(inp);
+    else if(isPL0Source(inp))
+        tokenList = readSourceTokenList(inp, arena, &lexerErr);
+    else
+        tokenList = readTokenListInArena(inp, arena);
+
+    stats.loadSeconds = getLapSeconds(&phaseStart);
+    stats.err = lexerErr;
+
+    int ret = 0;
+
+    if(lexerErr)
+    {
+        // Nothing is parsed without all the tokens
+        Sink sink;
+        initSink(&sink, outp);
+
+        printLexerErrToSink(lexerErr, &sink);
+
+        deleteSink(&sink);
+
+        // Nothing is parsed, so an exported symbol table is out of date
+        exportSymbolTable(ctx, outputPath, options, lexerErr);
+    }
+    else if(options.toBinary)
+    {
+        // Convert the token list instead of parsing it
+        if(writeBinaryTokenList(tokenList, outp) != 0)
+        {
+            fprintf(stderr, "Could not write the binary token list to \"%s\"\n", outputPath);
+            ret = -1;
+        }
+    }
+    else if(!parseTokenList(&tokenList, inputPath, outputPath, options, arena, ctx, outp, &stats, phaseStart))
+        ret = -1;
+
+    printStats(&stats, options, allocations);
+
+    if(err) *err = stats.err;
+
+    // The symbol table of the context is allocated from the arena too
+    deleteSymbolTable(&ctx->symbolTable);
+    deleteTokenList(&tokenList);
+    resetArena(arena);
+
+    return ret;
+}
+
+int parseFile(const char* inputPath, const char* outputPath, ParseOptions options, Arena* arena, ParserContext* ctx)
+{
+    FILE *inp, *outp;
+
+    // open the input file for reading
+    if( !(inp = fopen(inputPath, "rb")) )
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", inputPath);
+        return -1;
+    }
+
+    // open the output file for writing, and for reading back an output to
+    // .. cache
+    if( !(outp = fopen(outputPath, options.toBinary ? "wb" : options.cache ? "w+" : "w")) )
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", outputPath);
+
+        // Before terminating, close the input file
+        fclose(inp);
+
+        return -1;
+    }
+
+    if(options.stream && !options.toBinary && !isBinaryTokenList(inp))
+    {
+        fclose(outp);
+        fclose(inp);
+
+        return parseStream(inputPath, outputPath, options, arena, ctx);
+    }
+
+    int ret = parseOpenFiles(inputPath, outputPath, inp, outp, options, arena, ctx, NULL);
+
+    fclose(inp);
+
+    if(fclose(outp) != 0)
+    {
+        fprintf(stderr, "Could not write \"%s\"\n", outputPath);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+static int parseStream(const char* inputPath, const char* outputPath, ParseOptions options, Arena* arena, ParserContext* ctx)
+{
+    FILE *inp, *outp;
+
+    if( !(inp = fopen(inputPath, "rb")) )
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", inputPath);
+        return -1;
+    }
+
+    if( !(outp = fopen(outputPath, "w")) )
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", outputPath);
+        fclose(inp);
+        return -1;
+    }
+
+    int ret = 0;
+
+    // The tokens are read while parsing, so loading is only opening the
+    // .. stream
+    RunStats stats = { .input = inputPath };
+    AllocationStats allocations = getAllocationStats();
+    double phaseStart = getStatsSeconds();
+
+    TokenStream stream;
+
+    if(openTokenStream(&stream, inp, arena, options.streamMode) != 0)
+    {
+        fprintf(stderr, "Could not stream \"%s\"\n", inputPath);
+        ret = -1;
+    }
+    else
+    {
+        stats.loadSeconds = getLapSeconds(&phaseStart);
+
+        Sink sink;
+        initSink(&sink, outp);
+
+        Ast ast;
+        initAst(&ast, arena);
+        ctx->ast = options.ast || options.code || options.run ? &ast : NULL;
+        ctx->mode = options.mode;
+        ctx->symbolFormat = options.symbolFormat;
+        ctx->recover = options.recover;
+        ctx->iterative = options.iterative;
+        ctx->maxDepth = options.maxDepth;
+        ctx->maxStackSize = options.maxStackSize;
+        ctx->parallel = options.parallel;
+
+        int err = parser_ctx(ctx, &stream.tokenList, &sink);
+
+        // The verdict is the lexer error if there is any in the input, as
+        // .. when the whole input is lexed before parsing
+        int lexerErr = drainTokenStream(&stream);
+
+        stats.parseSeconds = getLapSeconds(&phaseStart);
+        takeParseStats(&stats, ctx, lexerErr ? lexerErr : err);
+
+        if(exportSymbolTable(ctx, outputPath, options, lexerErr ? lexerErr : err) != 0) ret = -1;
+
+        if(lexerErr) printLexerErrToSink(lexerErr, &sink);
+        else
+        {
+            printParsedAst(ctx, &stream.tokenList, options, err, &sink);
+            printParserVerdict(ctx, &stream.tokenList, err, &sink);
+
+            stats.emitSeconds = getLapSeconds(&phaseStart);
+
+            runParsedAst(ctx, options, err, arena, &sink);
+
+            stats.codeSeconds = getLapSeconds(&phaseStart);
+        }
+
+        deleteSink(&sink);
+
+        stats.emitSeconds += getLapSeconds(&phaseStart);
+        printStats(&stats, options, allocations);
+
+        ctx->ast = NULL;
+        deleteAst(&ast);
+
+        deleteSymbolTable(&ctx->symbolTable);
+        closeTokenStream(&stream);
+    }
+
+    resetArena(arena);
+
+    fclose(inp);
+
+    if(fclose(outp) != 0)
+    {
+        fprintf(stderr, "Could not write \"%s\"\n", outputPath);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+void makeParentDirectories(const char* path)
+{
+    size_t length = strlen(path);
+
+    char* dir = malloc(length + 1);
+    if(!dir) return;
+
+    memcpy(dir, path, length + 1);
+
+    // Create each directory of the path, from the outermost one
+    for(size_t i = 1; i < length; i++)
+    {
+        if(dir[i] != '/') continue;
+
+        dir[i] = '\0';
+
+        if(mkdir(dir, 0777) != 0 && errno != EEXIST)
+        {
+            // The open of the output reports the failure
+            break;
+        }
+
+        dir[i] = '/';
+    }
+
+    free(dir);
+}
+
+int readManifest(const char* path, Arena* arena, BatchJob** jobsOut)
+{
+    FILE* manifest = fopen(path, "r");
+
+    if(!manifest)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", path);
+        return -1;
+    }
+
+    BatchJob* jobs = NULL;
+    int numberOfJobs = 0;
+    int capacity = 0;
+
+    char* line = NULL;
+    size_t lineCapacity = 0;
+
+    while(getline(&line, &lineCapacity, manifest) != -1)
+    {
+        // Split the first two columns, as read does in the test scripts
+        const char* columns[2];
+        size_t lengths[2];
+        int numberOfColumns = 0;
+
+        const char* c = line;
+
+        while(numberOfColumns < 2)
+        {
+            while(*c && isspace((unsigned char)*c)) c++;
+            if(!*c) break;
+
+            columns[numberOfColumns] = c;
+
+            while(*c && !isspace((unsigned char)*c)) c++;
+
+            lengths[numberOfColumns] = c - columns[numberOfColumns];
+            numberOfColumns++;
+        }
+
+        // Skip empty lines
+        if(numberOfColumns == 0) continue;
+
+        if(numberOfColumns < 2)
+        {
+            fprintf(stderr, "Missing output path for \"%.*s\" in \"%s\"\n", (int)lengths[0], columns[0], path);
+            continue;
+        }
+
+        if(numberOfJobs == capacity)
+        {
+            int newCapacity = capacity ? capacity * 2 : 64;
+
+            BatchJob* newJobs = arenaRealloc(arena, jobs, capacity * sizeof(BatchJob), newCapacity * sizeof(BatchJob));
+            if(!newJobs) break;
+
+            jobs = newJobs;
+            capacity = newCapacity;
+        }
+
+        char* paths[2];
+
+        paths[0] = allocArena(arena, lengths[0] + 1);
+        paths[1] = allocArena(arena, lengths[1] + 1);
+        if(!paths[0] || !paths[1]) break;
+
+        for(int i = 0; i < 2; i++)
+        {
+            memcpy(paths[i], columns[i], lengths[i]);
+            paths[i][lengths[i]] = '\0';
+        }
+
+        jobs[numberOfJobs].inputPath = paths[0];
+        jobs[numberOfJobs].outputPath = paths[1];
+        numberOfJobs++;
+    }
+
+    free(line);
+    fclose(manifest);
+
+    *jobsOut = jobs;
+    return numberOfJobs;
+}
+
+int takeJob(Batch* batch, int worker)
+{
+    // Try the own deque first, then the others in order
+    for(int i = 0; i < batch->numberOfWorkers; i++)
+    {
+        int victim = (worker + i) % batch->numberOfWorkers;
+        JobDeque* deque = &batch->deques[victim];
+
+        int job = -1;
+
+        pthread_mutex_lock(&deque->lock);
+
+        if(deque->top < deque->bottom)
+        {
+            if(victim == worker) job = deque->jobs[--deque->bottom];
+            else                 job = deque->jobs[deque->top++];
+        }
+
+        pthread_mutex_unlock(&deque->lock);
+
+        if(job >= 0) return job;
+    }
+
+    return -1;
+}
+
+void* runWorker(void* arg)
+{
+    Worker* worker = arg;
+    Batch* batch = worker->batch;
+
+    // Each worker parses with its own arena and context, so the workers share
+    // .. nothing but the deques
+    Arena arena;
+    initArena(&arena, 0);
+
+    ParserContext ctx;
+    initParserContext(&ctx, batch->options.mode);
+
+    int failures = 0;
+    int job;
+
+    while((job = takeJob(batch, worker->index)) >= 0)
+    {
+        const BatchJob* file = &batch->jobs[job];
+
+        makeParentDirectories(file->outputPath);
+
+        if(parseFile(file->inputPath, file->outputPath, batch->options, &arena, &ctx) != 0)
+            failures++;
+    }
+
+    deleteParserContext(&ctx);
+    deleteArena(&arena);
+
+    pthread_mutex_lock(&batch->failuresLock);
+    batch->failures += failures;
+    pthread_mutex_unlock(&batch->failuresLock);
+
+    return NULL;
+}
+
+int runBatch(const char* manifestPath, int numberOfWorkers, ParseOptions options)
+{
+    // The jobs and the deques live as long as the batch
+    Arena arena;
+    initArena(&arena, 0);
+
+    BatchJob* jobs = NULL;
+    int numberOfJobs = readManifest(manifestPath, &arena, &jobs);
+
+    if(numberOfJobs < 0)
+    {
+        deleteArena(&arena);
+        return -1;
+    }
+
+    if(numberOfWorkers <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numberOfWorkers = cpus > 0 ? (int)cpus : 1;
+    }
+
+    // No need for more workers than files
+    if(numberOfWorkers > numberOfJobs) numberOfWorkers = numberOfJobs ? numberOfJobs : 1;
+
+    Batch batch;
+    batch.jobs = jobs;
+    batch.numberOfWorkers = numberOfWorkers;
+    batch.options = options;
+    batch.failures = 0;
+    pthread_mutex_init(&batch.failuresLock, NULL);
+
+    batch.deques = allocArena(&arena, numberOfWorkers * sizeof(JobDeque));
+    int* jobIndices = allocArena(&arena, (numberOfJobs ? numberOfJobs : 1) * sizeof(int));
+
+    Worker* workers = allocArena(&arena, numberOfWorkers * sizeof(Worker));
+    pthread_t* threads = allocArena(&arena, numberOfWorkers * sizeof(pthread_t));
+
+    if(!batch.deques || !jobIndices || !workers || !threads)
+    {
+        fprintf(stderr, "Could not allocate the batch of \"%s\"\n", manifestPath);
+        pthread_mutex_destroy(&batch.failuresLock);
+        deleteArena(&arena);
+        return -1;
+    }
+
+    // Give each worker a contiguous range of the manifest, so neighbouring
+    // .. files are parsed by the same worker unless they are stolen
+    for(int i = 0; i < numberOfJobs; i++) jobIndices[i] = i;
+
+    for(int w = 0; w < numberOfWorkers; w++)
+    {
+        JobDeque* deque = &batch.deques[w];
+
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->jobs = jobIndices;
+
+        // Reversed so that the owner, which pops from bottom, goes in order
+        deque->top = (int)((long)numberOfJobs * w / numberOfWorkers);
+        deque->bottom = (int)((long)numberOfJobs * (w + 1) / numberOfWorkers);
+
+        for(int lo = deque->top, hi = deque->bottom - 1; lo < hi; lo++, hi--)
+        {
+            int tmp = jobIndices[lo];
+            jobIndices[lo] = jobIndices[hi];
+            jobIndices[hi] = tmp;
+        }
+    }
+
+    // Worker 0 runs on the calling thread
+    int started = 1;
+
+    for(int w = 0; w < numberOfWorkers; w++)
+    {
+        workers[w].batch = &batch;
+        workers[w].index = w;
+    }
+
+    for(int w = 1; w < numberOfWorkers; w++, started++)
+    {
+        // The remaining workers steal the jobs of the ones that cannot start
+        if(pthread_create(&threads[w], NULL, runWorker, &workers[w]) != 0)
+            break;
+    }
+
+    runWorker(&workers[0]);
+
+    for(int w = 1; w < started; w++)
+        pthread_join(threads[w], NULL);
+
+    for(int w = 0; w < numberOfWorkers; w++)
+        pthread_mutex_destroy(&batch.deques[w].lock);
+
+    pthread_mutex_destroy(&batch.failuresLock);
+    deleteArena(&arena);
+
+    return batch.failures;
+}
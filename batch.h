@@ -0,0 +1,108 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "arena.h"
+#include "parser.h"
+#include "stream.h"
+#include "cache.h"
+
+// Appended to the output path to get the path of the exported symbol table
+#define SYMBOL_TABLE_EXTENSION ".sym"
+
+/**
+ * Options shared by all the files of a run.
+ * mode          : mode the parser runs in
+ * toBinary      : if not 0, the token lists are written in the binary token
+ *                 list format instead of being parsed
+ * stream        : if not 0, the tokens of the inputs that are not binary token
+ *                 lists are streamed to the parser, see stream.h, instead of
+ *                 being read as a whole first
+ * streamMode    : how the streamed tokens are produced
+ * ast           : if not 0, the abstract syntax tree of a successful parse is
+ *                 written before the success message, see printAst()
+ * fold          : if not 0, the tree is folded by foldAst() first
+ * code          : if not 0, the code generated from the tree, see codegen.h,
+ *                 is written after the success message
+ * run           : if not 0, the code is run after the success message, with
+ *                 the output of the program written to the output file, and
+ *                 its input read from stdin
+ * recover       : if not 0, the parser recovers from syntax errors, and all
+ *                 the errors it finds are written, see ParserContext
+ * iterative     : if not 0, the parser runs on a stack of its own, with the
+ *                 limits maxDepth and maxStackSize, see ParserContext
+ * stats         : if not 0, the times of the phases and the counters of each
+ *                 file are written to stderr, see stats.h
+ * parallel      : number of threads that the top-level procedures of each
+ *                 file may be parsed on, see ParserContext
+ * symbolFormat  : format the symbol table is written in, see
+ *                 SymbolTableFormat
+ * exportSymbols : if not 0, the symbol table of a successful parse is also
+ *                 written in the binary symbol table format, see symbol.h, to
+ *                 the output path with SYMBOL_TABLE_EXTENSION appended. The
+ *                 file is removed if the parse fails
+ * cache         : if not NULL, the outputs of the parses are looked up in it
+ *                 and stored in it, unless the code is run, which reads stdin,
+ *                 the symbols are exported, which a hit would skip, or the
+ *                 tokens are streamed, see cache.h
+ * */
+typedef struct {
+    ParserMode mode;
+    int toBinary;
+    int stream;
+    TokenStreamMode streamMode;
+    int ast;
+    int fold;
+    int code;
+    int run;
+    int recover;
+    int iterative;
+    int maxDepth;
+    size_t maxStackSize;
+    int stats;
+    int parallel;
+    SymbolTableFormat symbolFormat;
+    int exportSymbols;
+    ParseCache* cache;
+} ParseOptions;
+
+/**
+ * Parses the token list in the file at inputPath and writes the output to
+ * .. the file at outputPath, which is the same as the output of a single
+ * .. parser.out run. Everything is allocated from the given arena, which is
+ * .. reset before returning, and the parser state is kept in the given
+ * .. context.
+ * A streamed parse writes the parsing history up to a lexer error, if any,
+ * .. but gives the same verdict, as the rest of the input is still lexed.
+ * Returns 0 on success, -1 if a file cannot be opened or written. Parser
+ * .. errors are written to the output and are not failures.
+ * */
+int parseFile(const char* inputPath, const char* outputPath, ParseOptions, Arena*, ParserContext*);
+
+/**
+ * Same as parseFile(), on the given files, which are open already and are
+ * .. not closed, and whose paths are only used in the messages. The output is
+ * .. written from the start of outp, which is not flushed, and the tokens
+ * .. are not streamed. If err is not
+ * .. NULL, it is set to the error code of the verdict, of the lexer or the
+ * .. parser, which is 0 for a successful parse.
+ * */
+int parseOpenFiles(const char* inputPath, const char* outputPath, FILE* inp, FILE* outp, ParseOptions,
+                   Arena*, ParserContext*, int* err);
+
+/**
+ * Runs parseFile() on every "inp out" line of the manifest file at the given
+ * .. path, which is in the same format as test/tests.txt. Columns after the
+ * .. second one are ignored, so test/tests_grader.txt is a manifest too.
+ * Missing directories of the outputs are created.
+ *
+ * The files are spread across the given number of worker threads. Each
+ * .. worker owns a deque of files and takes files from its bottom; once it is
+ * .. empty, the worker steals files from the top of the deques of the others.
+ * If numberOfWorkers is not positive, one worker per online CPU is used.
+ *
+ * Returns the number of the files that failed, or -1 if the manifest cannot
+ * .. be read.
+ * */
+int runBatch(const char* manifestPath, int numberOfWorkers, ParseOptions);
+
+#endif
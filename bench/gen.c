@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "token.h"
+#include "lexer.h"
+
+/**
+ * Generates a PL/0 program of about the given number of tokens in the given
+ * .. shape, and writes it as a token list, the way the lexer prints it, or
+ * .. as source or a binary token list. The programs parse without errors.
+ * Shapes:
+ * nested     : statements and expressions nested depth levels deep
+ * wide       : var and const declarations of very many names
+ * long       : one begin ... end block of very many statements
+ * procedures : very many procedures, each of which declares and calls some
+ * mixed      : all of the above, in turn
+ * Usage: gen [-s shape] [-n tokens] [-d depth] [--source|--binary] (output)
+ * */
+
+/**
+ * Source being generated, and the number of its tokens so far
+ * */
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+    long tokens;
+} Program;
+
+/**
+ * Appends the given tokens, separated by spaces, to the given program
+ * */
+static void emit(Program* program, const char* tokens)
+{
+    size_t length = strlen(tokens);
+
+    if(program->length + length + 2 > program->capacity)
+    {
+        program->capacity = (program->capacity + length + 2) * 2;
+        program->text = realloc(program->text, program->capacity);
+
+        if(!program->text)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(-1);
+        }
+    }
+
+    memcpy(program->text + program->length, tokens, length);
+    program->length += length;
+    program->text[program->length++] = ' ';
+
+    // Each space in the given text separates two tokens
+    program->tokens++;
+    for(size_t i = 0; i < length; i++)
+        program->tokens += tokens[i] == ' ';
+}
+
+/**
+ * Same as emit(), with the text formatted by printf() from the given number
+ * */
+static void emitf(Program* program, const char* format, long number)
+{
+    char tokens[64];
+    snprintf(tokens, sizeof(tokens), format, number);
+
+    emit(program, tokens);
+}
+
+/**
+ * Appends an expression of x and y with parentheses nested the given number
+ * .. of levels deep
+ * */
+static void emitNestedExpression(Program* program, int depth)
+{
+    for(int level = 0; level < depth; level++)
+        emit(program, level % 2 ? "- (" : "(");
+
+    emit(program, "x + 1");
+
+    for(int level = depth - 1; level >= 0; level--)
+        emit(program, level % 2 ? ") * 2" : ") / y");
+}
+
+/**
+ * Appends a statement with if, while and begin ... end nested the given
+ * .. number of levels deep, around an assignment of a nested expression
+ * */
+static void emitNestedStatement(Program* program, int depth)
+{
+    for(int level = 0; level < depth; level++)
+    {
+        switch(level % 3)
+        {
+        case 0: emit(program, "if x < 100 then"); break;
+        case 1: emit(program, "while odd y do"); break;
+        default: emit(program, "begin y := y - 1;"); break;
+        }
+    }
+
+    emit(program, "x :=");
+    emitNestedExpression(program, depth);
+
+    for(int level = depth - 1; level >= 0; level--)
+    {
+        if(level % 3 == 2)
+            emit(program, "end");
+    }
+}
+
+/**
+ * Appends the statements of the main block of each shape, till the program
+ * .. has the given number of tokens. Each one ends with a semicolon.
+ * */
+static void emitStatements(Program* program, const char* shape, long size, int depth)
+{
+    long statement = 0;
+
+    while(program->tokens < size)
+    {
+        if(strcmp(shape, "nested") == 0)
+            emitNestedStatement(program, depth);
+        else if(strcmp(shape, "long") == 0)
+        {
+            switch(statement % 4)
+            {
+            case 0: emit(program, "x := x + 1"); break;
+            case 1: emit(program, "y := x * 2 - y / 3"); break;
+            case 2: emit(program, "if x > y then x := y else y := x"); break;
+            default: emit(program, "write x"); break;
+            }
+        }
+        else
+            emitf(program, "x := x + %ld", statement % 10000);
+
+        emit(program, ";");
+        statement++;
+    }
+}
+
+/**
+ * Appends a var declaration of the given number of names, and a const
+ * .. declaration of about as many before it
+ * */
+static void emitWideDeclarations(Program* program, long names)
+{
+    emit(program, "const c0 = 0");
+    for(long name = 1; name < names / 2; name++)
+        emitf(program, ", c%ld = 1", name);
+    emit(program, ";");
+
+    emit(program, "var x, y");
+    for(long name = 0; name < names / 2; name++)
+        emitf(program, ", v%ld", name);
+    emit(program, ";");
+}
+
+/**
+ * Appends the given number of procedures, in groups of procedures nested in
+ * .. each other a few levels deep. Each one declares a variable and calls the
+ * .. procedure declared before it, if any.
+ * */
+static void emitProcedures(Program* program, long procedures)
+{
+    const int groupDepth = 4;
+
+    for(long procedure = 0; procedure < procedures; procedure += groupDepth)
+    {
+        for(int level = 0; level < groupDepth; level++)
+        {
+            emitf(program, "procedure p%ld;", procedure + level);
+            emitf(program, "var a%ld;", procedure + level);
+        }
+
+        for(int level = groupDepth - 1; level >= 0; level--)
+        {
+            emitf(program, "begin a%ld := x + 1;", procedure + level);
+
+            if(procedure > 0 && level == 0)
+                emitf(program, "call p%ld;", procedure - groupDepth);
+
+            emit(program, "x := x - 1 end;");
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* shape = "mixed";
+    long size = 100000;
+    int depth = 50;
+    int format = 't';
+
+    int argInd = 1;
+
+    for(; argInd + 1 < argc && argv[argInd][0] == '-'; argInd++)
+    {
+        if(strcmp(argv[argInd], "-s") == 0 && argInd + 2 < argc)
+            shape = argv[++argInd];
+        else if(strcmp(argv[argInd], "-n") == 0 && argInd + 2 < argc)
+            size = atol(argv[++argInd]);
+        else if(strcmp(argv[argInd], "-d") == 0 && argInd + 2 < argc)
+            depth = atoi(argv[++argInd]);
+        else if(strcmp(argv[argInd], "--source") == 0)
+            format = 's';
+        else if(strcmp(argv[argInd], "--binary") == 0)
+            format = 'b';
+        else
+            break;
+    }
+
+    int knownShape = strcmp(shape, "nested") == 0 || strcmp(shape, "wide") == 0 || strcmp(shape, "long") == 0 ||
+                     strcmp(shape, "procedures") == 0 || strcmp(shape, "mixed") == 0;
+
+    if(argc - argInd != 1 || !knownShape || size <= 0 || depth <= 0)
+    {
+        fprintf(stderr, "Usage: gen [-s nested|wide|long|procedures|mixed] [-n tokens] [-d depth] [--source|--binary] (output)\n");
+        return -1;
+    }
+
+    Program program = { NULL, 0, 0, 0 };
+
+    int mixed = strcmp(shape, "mixed") == 0;
+
+    // The declarations take about half of the tokens of their shapes, and a
+    // .. quarter each of a mixed program
+    if(strcmp(shape, "wide") == 0 || mixed)
+        emitWideDeclarations(&program, mixed ? size / 16 : size / 6);
+    else
+        emit(&program, "var x, y;");
+
+    if(strcmp(shape, "procedures") == 0 || mixed)
+        emitProcedures(&program, mixed ? size / 80 : size / 40);
+
+    emit(&program, "begin x := 0; y := 1;");
+
+    if(mixed)
+    {
+        emitStatements(&program, "nested", program.tokens + size / 4, depth);
+        emitStatements(&program, "long", size, depth);
+    }
+    else
+        emitStatements(&program, shape, size, depth);
+
+    emit(&program, "write x end.");
+
+    FILE* out = fopen(argv[argInd], "wb");
+
+    if(!out)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", argv[argInd]);
+        return -1;
+    }
+
+    int ret = 0;
+
+    if(format == 's')
+        fwrite(program.text, 1, program.length, out);
+    else
+    {
+        TokenList tokenList;
+        initTokenList(&tokenList);
+
+        if(lexSource(program.text, program.length, &tokenList) != 0)
+        {
+            fprintf(stderr, "The generated program does not lex\n");
+            ret = -1;
+        }
+        else if(format == 'b')
+            ret = writeBinaryTokenList(tokenList, out);
+        else
+            printTokenList(tokenList, out);
+
+        deleteTokenList(&tokenList);
+    }
+
+    if(fclose(out) != 0) ret = -1;
+
+    free(program.text);
+
+    return ret;
+}
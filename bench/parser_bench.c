@@ -0,0 +1,236 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "token.h"
+#include "parser.h"
+#include "sink.h"
+
+/**
+ * Times each stage of parser.out on each given token list, as printed by the
+ * .. lexer, which bench/gen.c generates: reading the list, mapping it in the
+ * .. binary token list format, parsing it quietly, recursively and on a parse
+ * .. stack, and writing the parsing history. Each time is the best of the
+ * .. given number of runs. The peak RSS is that of the whole process so far,
+ * .. so the lists are best given from the smallest to the largest.
+ * Usage: parser_bench [-n runs] (token_list)...
+ * */
+
+static double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static long getPeakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    // In kilobytes on Linux
+    return usage.ru_maxrss;
+}
+
+/**
+ * Returns the best time of the given number of reads of the token list in the
+ * .. given file, or a negative time if it cannot be read. Binary lists are
+ * .. mapped. Sets the number of the tokens.
+ * */
+static double timeReads(const char* path, int binary, int runs, int* numberOfTokens)
+{
+    double best = -1;
+
+    for(int run = 0; run < runs; run++)
+    {
+        FILE* in = fopen(path, "rb");
+
+        if(!in) return -1;
+
+        double start = getSeconds();
+
+        TokenList tokenList = binary ? mapBinaryTokenList(in) : readTokenList(in);
+
+        double elapsed = getSeconds() - start;
+
+        *numberOfTokens = tokenList.numberOfTokens;
+
+        deleteTokenList(&tokenList);
+        fclose(in);
+
+        if(best < 0 || elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+/**
+ * Returns the best time of the given number of parses of the given list in
+ * .. the given mode, writing to the given sink, or a negative time if the
+ * .. parse fails
+ * */
+static double timeParses(TokenList* tokenList, ParserMode mode, int iterative, int runs, Sink* out)
+{
+    double best = -1;
+
+    ParserContext ctx;
+    initParserContext(&ctx, mode);
+    ctx.iterative = iterative;
+
+    for(int run = 0; run < runs; run++)
+    {
+        double start = getSeconds();
+
+        int err = parser_ctx(&ctx, tokenList, out);
+        flushSink(out);
+
+        double elapsed = getSeconds() - start;
+
+        if(err)
+        {
+            best = -1;
+            break;
+        }
+
+        if(best < 0 || elapsed < best) best = elapsed;
+    }
+
+    deleteParserContext(&ctx);
+
+    return best;
+}
+
+/**
+ * Returns the size of the output of a traced parse of the given list
+ * */
+static size_t getTraceSize(TokenList* tokenList)
+{
+    char* text = NULL;
+    size_t length = 0;
+
+    FILE* out = open_memstream(&text, &length);
+    Sink sink;
+    initSink(&sink, out);
+
+    ParserContext ctx;
+    initParserContext(&ctx, PARSER_TRACE);
+    parser_ctx(&ctx, tokenList, &sink);
+    deleteParserContext(&ctx);
+
+    deleteSink(&sink);
+    fclose(out);
+    free(text);
+
+    return length;
+}
+
+static void printStage(const char* stage, double seconds, int numberOfTokens, double bytes)
+{
+    printf("  %-16s %10.3f ms  %8.2f Mtokens/s  %8.2f MB/s\n",
+           stage, seconds * 1e3, numberOfTokens / seconds / 1e6, bytes / seconds / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 5;
+    int argInd = 1;
+
+    if(argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        runs = atoi(argv[2]);
+        argInd = 3;
+    }
+
+    if(argInd >= argc || runs <= 0)
+    {
+        fprintf(stderr, "Usage: parser_bench [-n runs] (token_list)...\n");
+        return -1;
+    }
+
+    // What the parses write is not kept
+    FILE* devNull = fopen("/dev/null", "w");
+    Sink out;
+    initSink(&out, devNull);
+
+    int ret = 0;
+
+    for(; argInd < argc; argInd++)
+    {
+        FILE* in = fopen(argv[argInd], "rb");
+
+        if(!in)
+        {
+            fprintf(stderr, "Could not open \"%s\"\n", argv[argInd]);
+            ret = -1;
+            continue;
+        }
+
+        fseek(in, 0, SEEK_END);
+        double inputSize = ftell(in);
+        rewind(in);
+
+        TokenList tokenList = readTokenList(in);
+        fclose(in);
+
+        // The same list in the binary format, for the mapped reads
+        char binaryPath[] = "/tmp/parser_bench_XXXXXX";
+        int binaryFd = mkstemp(binaryPath);
+        FILE* binary = binaryFd >= 0 ? fdopen(binaryFd, "wb") : NULL;
+        double binarySize = -1;
+
+        if(binary && writeBinaryTokenList(tokenList, binary) == 0)
+            binarySize = ftell(binary);
+
+        if(binary) fclose(binary);
+
+        int numberOfTokens = 0;
+        int mappedTokens = 0;
+
+        double readTime = timeReads(argv[argInd], 0, runs, &numberOfTokens);
+        double mapTime = binarySize >= 0 ? timeReads(binaryPath, 1, runs, &mappedTokens) : -1;
+        double quietTime = timeParses(&tokenList, PARSER_QUIET, 0, runs, &out);
+        double iterativeTime = timeParses(&tokenList, PARSER_QUIET, 1, runs, &out);
+        double traceTime = timeParses(&tokenList, PARSER_TRACE, 0, runs, &out);
+
+        if(binaryFd >= 0) remove(binaryPath);
+
+        if(readTime < 0 || numberOfTokens == 0 || quietTime < 0 || iterativeTime < 0 || traceTime < 0)
+        {
+            fprintf(stderr, "Could not parse \"%s\"\n", argv[argInd]);
+            ret = -1;
+        }
+        else
+        {
+            double traceSize = getTraceSize(&tokenList);
+
+            printf("%s: %d tokens, %.2f MB\n", argv[argInd], numberOfTokens, inputSize / 1e6);
+
+            printStage("read", readTime, numberOfTokens, inputSize);
+
+            if(mapTime >= 0)
+                printStage("map binary", mapTime, mappedTokens, binarySize);
+
+            printStage("parse", quietTime, numberOfTokens, inputSize);
+            printStage("parse iterative", iterativeTime, numberOfTokens, inputSize);
+
+            // Writing the history is what a traced parse takes on top of a
+            // .. quiet one, and its rate is that of the history
+            double emitTime = traceTime > quietTime ? traceTime - quietTime : 1e-9;
+
+            printStage("parse traced", traceTime, numberOfTokens, traceSize);
+            printStage("emit history", emitTime, numberOfTokens, traceSize);
+            printf("  %-16s %10.2f MB\n", "peak RSS", getPeakRss() / 1e3);
+        }
+
+        deleteTokenList(&tokenList);
+    }
+
+    deleteSink(&out);
+    fclose(devNull);
+
+    return ret;
+}
@@ -0,0 +1,255 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "token.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "reparse.h"
+
+/**
+ * Makes random edits of a token each to each given PL/0 program, and undoes
+ * .. each of them, the way an editor would. Times the incremental parser
+ * .. against parsing the whole program again, and checks that both end up
+ * .. with the same tree and symbol table.
+ * Usage: reparse_bench [-n edits] (program.pl0)...
+ * */
+
+static double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static unsigned int seed = 12345;
+
+static int getRandom(int n)
+{
+    seed = seed * 1103515245u + 12345u;
+
+    return (int)((seed >> 8) % (unsigned int)n);
+}
+
+/**
+ * Returns the index of a random token of the given id, -1 if there is none
+ * */
+static int findRandomToken(const TokenList* tokenList, int id)
+{
+    int start = getRandom(tokenList->numberOfTokens);
+
+    for(int i = 0; i < tokenList->numberOfTokens; i++)
+    {
+        int ind = (start + i) % tokenList->numberOfTokens;
+
+        if(tokenList->ids[ind] == id) return ind;
+    }
+
+    return -1;
+}
+
+/**
+ * Returns the tree and the symbol table of the given context as text, which
+ * .. the caller frees
+ * */
+static char* printParse(const Ast* ast, const InternPool* names, SymbolTable* symbolTable)
+{
+    char* text = NULL;
+    size_t length = 0;
+
+    FILE* out = open_memstream(&text, &length);
+    Sink sink;
+    initSink(&sink, out);
+
+    printAst(ast, names, symbolTable, &sink);
+    printSymbolTableToSink(symbolTable, &sink);
+
+    deleteSink(&sink);
+    fclose(out);
+
+    return text;
+}
+
+/**
+ * Brings the given parser up to date with the given tokens and parses them
+ * .. as a whole as well. Sets the time of the update and adds the time of the
+ * .. whole parse, and returns 0 if they agree.
+ * */
+static int updateAndCheck(IncrementalParser* parser, TokenList* tokens, double* incrementalTime, double* fullTime)
+{
+    double start = getSeconds();
+    int err = updateIncremental(parser, tokens);
+    *incrementalTime = getSeconds() - start;
+
+    ParserContext ctx;
+    initParserContext(&ctx, PARSER_QUIET);
+
+    Ast ast;
+    initAst(&ast, NULL);
+    ctx.ast = &ast;
+
+    start = getSeconds();
+    int fullErr = parser_ctx(&ctx, tokens, NULL);
+    *fullTime += getSeconds() - start;
+
+    int same = err == fullErr;
+
+    if(same && !err)
+    {
+        char* text = printParse(&parser->ast, &parser->tokens.lexemes, &parser->ctx.symbolTable);
+        char* fullText = printParse(&ast, &tokens->lexemes, &ctx.symbolTable);
+
+        same = strcmp(text, fullText) == 0;
+
+        free(text);
+        free(fullText);
+    }
+
+    deleteAst(&ast);
+    deleteParserContext(&ctx);
+
+    return same ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    int edits = 200;
+    int argInd = 1;
+
+    if(argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        edits = atoi(argv[2]);
+        argInd = 3;
+    }
+
+    if(argInd >= argc || edits <= 0)
+    {
+        fprintf(stderr, "Usage: reparse_bench [-n edits] (program.pl0)...\n");
+        return -1;
+    }
+
+    int ret = 0;
+
+    for(; argInd < argc; argInd++)
+    {
+        FILE* in = fopen(argv[argInd], "rb");
+
+        if(!in)
+        {
+            fprintf(stderr, "Could not open \"%s\"\n", argv[argInd]);
+            ret = -1;
+            continue;
+        }
+
+        int lexerErr;
+        TokenList tokens = readSourceTokenList(in, NULL, &lexerErr);
+        fclose(in);
+
+        IncrementalParser parser;
+        initIncrementalParser(&parser);
+
+        if(lexerErr || tokens.numberOfTokens == 0 || parseIncremental(&parser, &tokens) != 0)
+        {
+            fprintf(stderr, "Could not parse \"%s\"\n", argv[argInd]);
+            ret = -1;
+        }
+        else
+        {
+            double incrementalTime = 0;
+            double partialTime = 0;
+            double fullTime = 0;
+            int partial = 0;
+            long reparsedTokens = 0;
+            int mismatches = 0;
+
+            for(int edit = 0; edit < edits; edit++)
+            {
+                // Change a number or a name, drop a token or declare one
+                // .. more variable, then undo it
+                TokenList replacement;
+                initTokenList(&replacement);
+
+                static const int editedIds[] = { numbersym, identsym, identsym, varsym };
+
+                int kind = getRandom(4);
+                int ind = findRandomToken(&tokens, editedIds[kind]);
+
+                if(ind < 0) ind = getRandom(tokens.numberOfTokens);
+
+                int removed = 1;
+
+                if(kind == 0)
+                {
+                    char number[8];
+                    int length = snprintf(number, sizeof(number), "%d", getRandom(1000));
+
+                    addToken(&replacement, (Token){ numbersym, internLexeme(&replacement, number, length) });
+                }
+                else if(kind == 1)
+                {
+                    int other = findRandomToken(&tokens, identsym);
+                    const char* name = getTokenLexeme(&tokens, (Token){ identsym, tokens.lexemeIds[other] });
+
+                    addToken(&replacement, (Token){ identsym, internLexeme(&replacement, name, strlen(name)) });
+                }
+                else if(kind == 3)
+                {
+                    // The new name goes right after "var"
+                    ind++;
+                    removed = 0;
+
+                    addToken(&replacement, (Token){ identsym, internLexeme(&replacement, "added", 5) });
+                    addToken(&replacement, (Token){ commasym, internLexeme(&replacement, ",", 1) });
+                }
+
+                TokenList edited = getCopy(tokens);
+
+                replaceTokens(&edited, ind, removed, &replacement, 0, replacement.numberOfTokens);
+
+                for(int step = 0; step < 2; step++)
+                {
+                    // Going back from the edit is an edit as well
+                    double time;
+                    mismatches -= updateAndCheck(&parser, step ? &tokens : &edited, &time, &fullTime);
+
+                    incrementalTime += time;
+
+                    // Edits that change nothing are not partial parses
+                    if(parser.reparsedNode >= 0 && parser.reparsedNode != parser.ast.root)
+                    {
+                        partialTime += time;
+                        partial++;
+                    }
+
+                    reparsedTokens += parser.reparsedTokens;
+                }
+
+                deleteTokenList(&edited);
+                deleteTokenList(&replacement);
+            }
+
+            int updates = edits * 2;
+
+            printf("%-24s %6d tokens  %5.1f%% partial  %8.1f tokens each  full %8.2f us  incremental %8.2f us"
+                   "  speedup %.2fx  partial %8.2f us\n",
+                   argv[argInd], tokens.numberOfTokens, 100.0 * partial / updates, (double)reparsedTokens / updates,
+                   fullTime / updates * 1e6, incrementalTime / updates * 1e6, fullTime / incrementalTime,
+                   partial ? partialTime / partial * 1e6 : 0.0);
+
+            if(mismatches)
+            {
+                fprintf(stderr, "\"%s\": %d updates differ from a whole parse\n", argv[argInd], mismatches);
+                ret = -1;
+            }
+        }
+
+        deleteIncrementalParser(&parser);
+        deleteTokenList(&tokens);
+    }
+
+    return ret;
+}
@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+
+/**
+ * Times parsing each given file the way a build does it, by starting the
+ * .. given parser.out for each one, against sending all of them, one request
+ * .. after another, over one connection to the server on the given socket,
+ * .. which parser.out --serve runs. Each time is the best of the given
+ * .. number of rounds over all the files.
+ * Usage: server_bench [-n rounds] [-p parser] (socket) (token_list)...
+ * */
+
+extern char** environ;
+
+static double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int sendAll(int fd, const void* data, size_t length)
+{
+    const char* bytes = data;
+
+    while(length > 0)
+    {
+        ssize_t n = send(fd, bytes, length, MSG_NOSIGNAL);
+
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return -1;
+
+        bytes += n;
+        length -= n;
+    }
+
+    return 0;
+}
+
+static int receiveAll(int fd, void* data, size_t length)
+{
+    char* bytes = data;
+
+    while(length > 0)
+    {
+        ssize_t n = recv(fd, bytes, length, 0);
+
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return -1;
+
+        bytes += n;
+        length -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * Connects to the server on the given path, waiting a second at most for it
+ * .. to start listening. Returns the socket, or -1 on failure.
+ * */
+static int connectToServer(const char* socketPath)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(strlen(socketPath) >= sizeof(address.sun_path)) return -1;
+
+    strcpy(address.sun_path, socketPath);
+
+    for(int attempt = 0; attempt < 100; attempt++)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if(fd < 0) return -1;
+
+        if(connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0) return fd;
+
+        close(fd);
+
+        struct timespec wait = { 0, 10 * 1000 * 1000 };
+        nanosleep(&wait, NULL);
+    }
+
+    return -1;
+}
+
+/**
+ * Reads the whole file at the given path. Returns NULL on failure.
+ * */
+static char* readFile(const char* path, size_t* length)
+{
+    FILE* in = fopen(path, "rb");
+
+    if(!in) return NULL;
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    rewind(in);
+
+    char* data = size >= 0 ? malloc(size + 1) : NULL;
+
+    if(data && fread(data, 1, size, in) != (size_t)size)
+    {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(in);
+
+    *length = size;
+
+    return data;
+}
+
+/**
+ * Sends the given input as a request of the parsing history, and reads the
+ * .. response. Returns the size of the output, or -1 on failure.
+ * */
+static long request(int fd, const char* input, size_t length, char** output, size_t* capacity)
+{
+    ParseRequestHeader header;
+    memcpy(header.magic, PARSE_REQUEST_MAGIC, 4);
+    header.flags = 0;
+    header.inputSize = length;
+
+    ParseResponseHeader response;
+
+    if(sendAll(fd, &header, sizeof(header)) != 0 || sendAll(fd, input, length) != 0 ||
+       receiveAll(fd, &response, sizeof(response)) != 0 || response.err < 0)
+        return -1;
+
+    if(response.outputSize > *capacity)
+    {
+        *capacity = response.outputSize;
+        free(*output);
+        *output = malloc(*capacity);
+
+        if(!*output) return -1;
+    }
+
+    if(receiveAll(fd, *output, response.outputSize) != 0) return -1;
+
+    return (long)response.outputSize;
+}
+
+/**
+ * Runs the given parser on the given file, writing to /dev/null. Returns 0
+ * .. if it succeeds.
+ * */
+static int spawnParser(const char* parser, const char* path)
+{
+    char* args[] = { (char*)parser, (char*)path, "/dev/null", NULL };
+    pid_t pid;
+
+    if(posix_spawn(&pid, parser, NULL, NULL, args, environ) != 0) return -1;
+
+    int status;
+
+    if(waitpid(pid, &status, 0) != pid) return -1;
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    int rounds = 5;
+    const char* parser = "./parser.out";
+    int argInd = 1;
+
+    for(; argInd + 1 < argc && argv[argInd][0] == '-'; argInd += 2)
+    {
+        if(strcmp(argv[argInd], "-n") == 0) rounds = atoi(argv[argInd + 1]);
+        else if(strcmp(argv[argInd], "-p") == 0) parser = argv[argInd + 1];
+        else break;
+    }
+
+    if(argc - argInd < 2 || rounds <= 0)
+    {
+        fprintf(stderr, "Usage: server_bench [-n rounds] [-p parser] (socket) (token_list)...\n");
+        return -1;
+    }
+
+    const char* socketPath = argv[argInd++];
+    int numberOfFiles = argc - argInd;
+
+    char** inputs = calloc(numberOfFiles, sizeof(char*));
+    size_t* lengths = calloc(numberOfFiles, sizeof(size_t));
+
+    if(!inputs || !lengths) return -1;
+
+    for(int i = 0; i < numberOfFiles; i++)
+    {
+        if(!(inputs[i] = readFile(argv[argInd + i], &lengths[i])))
+        {
+            fprintf(stderr, "Could not read \"%s\"\n", argv[argInd + i]);
+            return -1;
+        }
+    }
+
+    int fd = connectToServer(socketPath);
+
+    if(fd < 0)
+    {
+        fprintf(stderr, "Could not connect to \"%s\"\n", socketPath);
+        return -1;
+    }
+
+    char* output = NULL;
+    size_t capacity = 0;
+    double serverTime = -1;
+    double spawnTime = -1;
+    long outputSize = 0;
+    int ret = 0;
+
+    for(int round = 0; round < rounds && ret == 0; round++)
+    {
+        double start = getSeconds();
+
+        for(int i = 0; i < numberOfFiles && ret == 0; i++)
+        {
+            long size = request(fd, inputs[i], lengths[i], &output, &capacity);
+
+            if(size < 0) ret = -1;
+            else if(round == 0) outputSize += size;
+        }
+
+        double elapsed = getSeconds() - start;
+        if(serverTime < 0 || elapsed < serverTime) serverTime = elapsed;
+
+        start = getSeconds();
+
+        for(int i = 0; i < numberOfFiles && ret == 0; i++)
+        {
+            if(spawnParser(parser, argv[argInd + i]) != 0) ret = -1;
+        }
+
+        elapsed = getSeconds() - start;
+        if(spawnTime < 0 || elapsed < spawnTime) spawnTime = elapsed;
+    }
+
+    if(ret != 0)
+        fprintf(stderr, "A parse failed\n");
+    else
+    {
+        printf("%d files, %.1f KB of output\n", numberOfFiles, outputSize / 1e3);
+        printf("  %-16s %10.1f us per file\n", "process per file", spawnTime / numberOfFiles * 1e6);
+        printf("  %-16s %10.1f us per file  speedup %.1fx\n", "server", serverTime / numberOfFiles * 1e6,
+               spawnTime / serverTime);
+    }
+
+    close(fd);
+    free(output);
+
+    for(int i = 0; i < numberOfFiles; i++) free(inputs[i]);
+
+    free(inputs);
+    free(lengths);
+
+    return ret;
+}
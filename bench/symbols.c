@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "symbol.h"
+
+/**
+ * Maps each given binary symbol table, as --export-symbols writes it, and
+ * .. writes its symbols to stdout the way --symbols tsv prints them, so that
+ * .. the export can be checked against the output of the parse.
+ * Usage: symbols (table.sym)...
+ * */
+
+/**
+ * Writes the symbols of the given mapped table, in the format of
+ * .. printSymbolTableInFormat() with SYMBOL_TABLE_TSV
+ * */
+static void printBinarySymbolTable(const BinarySymbolTable* table, FILE* out)
+{
+    static const char* typeNames[] = { "CONST", "VAR", "PROC" };
+
+    fprintf(out, "Symbol Table\n============\n");
+    fprintf(out, "index\ttype\tname\tvalue\tlevel\n");
+
+    for(int i = 0; i < table->numberOfSymbols; i++)
+    {
+        const BinarySymbol* symbol = &table->symbols[i];
+
+        fprintf(out, "%d\t%s\t%s\t", i, typeNames[symbol->type], table->names + symbol->name);
+
+        if(symbol->type == CONST) fprintf(out, "%d", symbol->value);
+
+        fprintf(out, "\t%u\n", symbol->level);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage: symbols (table.sym)...\n");
+        return -1;
+    }
+
+    int ret = 0;
+
+    for(int argInd = 1; argInd < argc; argInd++)
+    {
+        FILE* in = fopen(argv[argInd], "rb");
+
+        BinarySymbolTable table;
+
+        if(!in || mapBinarySymbolTable(in, &table) != 0)
+        {
+            fprintf(stderr, "Could not map \"%s\"\n", argv[argInd]);
+            ret = -1;
+        }
+        else
+        {
+            printBinarySymbolTable(&table, stdout);
+            unmapBinarySymbolTable(&table);
+        }
+
+        if(in) fclose(in);
+    }
+
+    return ret;
+}
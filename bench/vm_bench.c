@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "arena.h"
+#include "token.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "fold.h"
+#include "codegen.h"
+#include "vm.h"
+
+/**
+ * Compiles each given PL/0 program and times its runs on the P-machine with
+ * .. each dispatch.
+ * Usage: vm_bench [-n runs] (program.pl0)...
+ * */
+
+static double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the best time of the given number of runs of the given code, or a
+ * .. negative time if the code stops with an error
+ * */
+static double timeRuns(const Code* code, VmDispatch dispatch, int runs, Sink* out, Arena* arena)
+{
+    double best = -1;
+
+    for(int run = 0; run < runs; run++)
+    {
+        double start = getSeconds();
+
+        if(runCodeWith(code, dispatch, NULL, out, arena) != 0) return -1;
+
+        double elapsed = getSeconds() - start;
+
+        if(best < 0 || elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 5;
+    int argInd = 1;
+
+    if(argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        runs = atoi(argv[2]);
+        argInd = 3;
+    }
+
+    if(argInd >= argc || runs <= 0)
+    {
+        fprintf(stderr, "Usage: vm_bench [-n runs] (program.pl0)...\n");
+        return -1;
+    }
+
+    if(!VM_HAS_THREADED_DISPATCH)
+        printf("Threaded dispatch is not supported, both modes run the switch loop\n");
+
+    // The output of the programs is not what is measured
+    FILE* devNull = fopen("/dev/null", "w");
+    Sink out;
+    initSink(&out, devNull);
+
+    int ret = 0;
+
+    for(; argInd < argc; argInd++)
+    {
+        FILE* in = fopen(argv[argInd], "rb");
+
+        if(!in)
+        {
+            fprintf(stderr, "Could not open \"%s\"\n", argv[argInd]);
+            ret = -1;
+            continue;
+        }
+
+        Arena arena;
+        initArena(&arena, 0);
+
+        int lexerErr;
+        TokenList tokenList = readSourceTokenList(in, &arena, &lexerErr);
+        fclose(in);
+
+        ParserContext ctx;
+        initParserContext(&ctx, PARSER_QUIET);
+
+        Ast ast;
+        initAst(&ast, &arena);
+        ctx.ast = &ast;
+
+        Code code;
+        initCode(&code, &arena);
+
+        int err = lexerErr ? lexerErr : parser_ctx(&ctx, &tokenList, NULL);
+
+        if(!err && !ast.incomplete)
+        {
+            foldAst(&ast, &ctx.symbolTable);
+            err = generateCode(&ast, &ctx.symbolTable, &code);
+        }
+
+        if(err || ast.incomplete)
+        {
+            fprintf(stderr, "Could not compile \"%s\"\n", argv[argInd]);
+            ret = -1;
+        }
+        else
+        {
+            double switchTime = timeRuns(&code, VM_SWITCH, runs, &out, &arena);
+            double threadedTime = timeRuns(&code, VM_THREADED, runs, &out, &arena);
+
+            if(switchTime < 0 || threadedTime < 0)
+            {
+                fprintf(stderr, "\"%s\" stopped with a runtime error\n", argv[argInd]);
+                ret = -1;
+            }
+            else
+                printf("%-24s %5d instructions  switch %8.2f ms  threaded %8.2f ms  speedup %.2fx\n",
+                       argv[argInd], code.numberOfInstructions, switchTime * 1e3, threadedTime * 1e3,
+                       switchTime / threadedTime);
+        }
+
+        deleteCode(&code);
+        deleteAst(&ast);
+        deleteParserContext(&ctx);
+        deleteTokenList(&tokenList);
+        deleteArena(&arena);
+    }
+
+    deleteSink(&out);
+    fclose(devNull);
+
+    return ret;
+}
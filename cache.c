@@ -0,0 +1,433 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define HASH_PRIME_1 0x9e3779b97f4a7c15ull
+#define HASH_PRIME_2 0xc2b2ae3d27d4eb4full
+
+// Temporary files of writers that died are removed after this many seconds
+#define STALE_TEMPORARY_SECONDS 3600
+
+/**
+ * Mixes the given word into the given hash
+ * */
+static inline uint64_t mixHash(uint64_t hash, uint64_t word)
+{
+    hash ^= word * HASH_PRIME_2;
+    hash = (hash << 31 | hash >> 33) * HASH_PRIME_1;
+
+    return hash;
+}
+
+/**
+ * Spreads every bit of the given hash over all the bits of the result
+ * */
+static inline uint64_t finishHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+uint64_t hashCacheBytes(const void* data, size_t length, uint64_t seed)
+{
+    const unsigned char* bytes = data;
+    uint64_t hash = seed ^ (length * HASH_PRIME_1);
+
+    size_t i = 0;
+
+    for(; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+
+        hash = mixHash(hash, word);
+    }
+
+    if(i < length)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, length - i);
+
+        hash = mixHash(hash, word);
+    }
+
+    return finishHash(hash);
+}
+
+static uint64_t hashLexeme(const InternPool* lexemes, int id)
+{
+    if(id < 0) return 0;
+
+    return hashCacheBytes(getInternedString(lexemes, id), getInternedStringLength(lexemes, id), 0);
+}
+
+uint64_t hashTokenList(const TokenList* tokenList, uint64_t seed)
+{
+    const InternPool* lexemes = &tokenList->lexemes;
+
+    uint64_t hash = hashCacheBytes(tokenList->ids, tokenList->numberOfTokens, seed);
+
+    // Each distinct lexeme is hashed once, unless there is no memory for the
+    // .. hashes, which gives the same hash, only slower
+    uint64_t* lexemeHashes = malloc((lexemes->numberOfStrings + 1) * sizeof(uint64_t));
+
+    if(lexemeHashes)
+    {
+        for(int id = 0; id < lexemes->numberOfStrings; id++)
+            lexemeHashes[id] = hashLexeme(lexemes, id);
+    }
+
+    for(int i = 0; i < tokenList->numberOfTokens; i++)
+    {
+        int id = tokenList->lexemeIds[i];
+
+        hash = mixHash(hash, lexemeHashes && id >= 0 ? lexemeHashes[id] : hashLexeme(lexemes, id));
+    }
+
+    free(lexemeHashes);
+
+    return finishHash(hash ^ (uint64_t)tokenList->numberOfTokens);
+}
+
+/**
+ * Returns the hash of the running executable, which is PARSE_CACHE_VERSION
+ * .. if it cannot be read
+ * */
+static uint64_t hashExecutable()
+{
+    FILE* exe = fopen("/proc/self/exe", "rb");
+
+    if(!exe) return PARSE_CACHE_VERSION;
+
+    uint64_t hash = PARSE_CACHE_VERSION;
+    char buffer[1 << 16];
+    size_t length;
+
+    while((length = fread(buffer, 1, sizeof(buffer), exe)) > 0)
+        hash = hashCacheBytes(buffer, length, hash);
+
+    fclose(exe);
+
+    return hash;
+}
+
+/**
+ * Creates the given directory and its missing parents, as mkdir -p does.
+ * Returns 0 if the directory is there in the end.
+ * */
+static int makeDirectories(char* dir)
+{
+    for(char* c = dir + 1; *c; c++)
+    {
+        if(*c != '/') continue;
+
+        *c = '\0';
+        int err = mkdir(dir, 0777) != 0 && errno != EEXIST;
+        *c = '/';
+
+        if(err) return -1;
+    }
+
+    if(mkdir(dir, 0777) != 0 && errno != EEXIST) return -1;
+
+    struct stat st;
+
+    return stat(dir, &st) == 0 && S_ISDIR(st.st_mode) ? 0 : -1;
+}
+
+int openParseCache(ParseCache* cache, const char* dir, size_t maxSize)
+{
+    cache->dir = strdup(dir);
+
+    if(!cache->dir || makeDirectories(cache->dir) != 0)
+    {
+        free(cache->dir);
+        cache->dir = NULL;
+
+        return -1;
+    }
+
+    cache->maxSize = maxSize ? maxSize : DEFAULT_PARSE_CACHE_SIZE;
+    cache->buildHash = hashExecutable();
+
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->stored = 0;
+
+    return 0;
+}
+
+/**
+ * Sets the path of the entry of the given key, which is at most
+ * .. strlen(dir) + 32 characters
+ * */
+static void getEntryPath(const ParseCache* cache, uint64_t key, char* path, size_t size)
+{
+    snprintf(path, size, "%s/%016llx.entry", cache->dir, (unsigned long long)key);
+}
+
+int lookupParseCache(ParseCache* cache, uint64_t key, int numberOfTokens, FILE* out, CachedParse* parse)
+{
+    size_t pathSize = strlen(cache->dir) + 32;
+    char* path = malloc(pathSize);
+
+    if(!path) return 0;
+
+    getEntryPath(cache, key, path, pathSize);
+
+    int fd = open(path, O_RDONLY);
+    free(path);
+
+    struct stat st;
+
+    if(fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheEntryHeader))
+    {
+        if(fd >= 0) close(fd);
+
+        return 0;
+    }
+
+    size_t size = st.st_size;
+    const char* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if(base == MAP_FAILED)
+    {
+        close(fd);
+
+        return 0;
+    }
+
+    CacheEntryHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    // Entries are complete once they have their name, so a mismatch is a key
+    // .. collision or an entry of another version
+    int hit = memcmp(header.magic, PARSE_CACHE_MAGIC, 4) == 0 && header.version == PARSE_CACHE_VERSION &&
+              header.key == key && header.numberOfTokens == (uint64_t)numberOfTokens &&
+              header.outputSize == size - sizeof(header);
+
+    int ret = 0;
+
+    if(hit)
+    {
+        ret = fwrite(base + sizeof(header), 1, header.outputSize, out) == header.outputSize ? 1 : -1;
+
+        *parse = header.parse;
+
+        // The modification time of an entry is the time it was last used
+        futimens(fd, NULL);
+    }
+
+    munmap((void*)base, size);
+    close(fd);
+
+    return ret;
+}
+
+/**
+ * Writes all the given bytes to the given file descriptor. Returns 0 on
+ * .. success.
+ * */
+static int writeAll(int fd, const char* data, size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+
+        if(written < 0 && errno == EINTR) continue;
+        if(written <= 0) return -1;
+
+        data += written;
+        length -= written;
+    }
+
+    return 0;
+}
+
+void storeParseCache(ParseCache* cache, uint64_t key, int numberOfTokens, CachedParse parse, const char* output, size_t outputSize)
+{
+    if(cache->maxSize < sizeof(CacheEntryHeader) || outputSize > cache->maxSize - sizeof(CacheEntryHeader)) return;
+
+    CacheEntryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PARSE_CACHE_MAGIC, 4);
+    header.version = PARSE_CACHE_VERSION;
+    header.key = key;
+    header.numberOfTokens = numberOfTokens;
+    header.parse = parse;
+    header.outputSize = outputSize;
+
+    size_t pathSize = strlen(cache->dir) + 32;
+    char* path = malloc(pathSize);
+    char* temporaryPath = malloc(pathSize);
+
+    if(!path || !temporaryPath)
+    {
+        free(path);
+        free(temporaryPath);
+        return;
+    }
+
+    getEntryPath(cache, key, path, pathSize);
+
+    // Hidden, so that it is never taken for an entry
+    snprintf(temporaryPath, pathSize, "%s/.%016llx.XXXXXX", cache->dir, (unsigned long long)key);
+
+    int fd = mkstemp(temporaryPath);
+
+    if(fd >= 0)
+    {
+        int failed = fchmod(fd, 0644) != 0 ||
+                     writeAll(fd, (const char*)&header, sizeof(header)) != 0 ||
+                     writeAll(fd, output, outputSize) != 0;
+
+        failed |= close(fd) != 0;
+
+        // The rename replaces an entry of the same key at once, if another
+        // .. run stored one in the meantime
+        if(failed || rename(temporaryPath, path) != 0)
+            unlink(temporaryPath);
+        else
+        {
+            pthread_mutex_lock(&cache->lock);
+            cache->stored++;
+            pthread_mutex_unlock(&cache->lock);
+        }
+    }
+
+    free(path);
+    free(temporaryPath);
+}
+
+/**
+ * An entry of the cache directory, as eviction sees it
+ * */
+typedef struct {
+    char* name;
+    struct timespec used;
+    size_t size;
+} CacheFile;
+
+static int compareCacheFiles(const void* a, const void* b)
+{
+    const struct timespec* x = &((const CacheFile*)a)->used;
+    const struct timespec* y = &((const CacheFile*)b)->used;
+
+    if(x->tv_sec != y->tv_sec) return x->tv_sec < y->tv_sec ? -1 : 1;
+    if(x->tv_nsec != y->tv_nsec) return x->tv_nsec < y->tv_nsec ? -1 : 1;
+
+    return 0;
+}
+
+/**
+ * Removes the least recently used entries of the given cache till they take
+ * .. at most 3/4 of its size, if they take more than it, and the temporary
+ * .. files of writers that died. Concurrent evictions may remove the same
+ * .. files, which is harmless, and the entries being read stay readable.
+ * */
+static void evictParseCache(ParseCache* cache)
+{
+    DIR* dir = opendir(cache->dir);
+    if(!dir) return;
+
+    CacheFile* files = NULL;
+    int numberOfFiles = 0;
+    int capacity = 0;
+    size_t totalSize = 0;
+
+    time_t now = time(NULL);
+    struct dirent* entry;
+
+    while((entry = readdir(dir)))
+    {
+        const char* name = entry->d_name;
+        size_t length = strlen(name);
+
+        int temporary = name[0] == '.' && length > 2;
+        int isEntry = length > 6 && strcmp(name + length - 6, ".entry") == 0 && name[0] != '.';
+
+        struct stat st;
+
+        if(!(temporary || isEntry) || fstatat(dirfd(dir), name, &st, 0) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        if(temporary)
+        {
+            if(now - st.st_mtim.tv_sec > STALE_TEMPORARY_SECONDS)
+                unlinkat(dirfd(dir), name, 0);
+
+            continue;
+        }
+
+        if(numberOfFiles == capacity)
+        {
+            int newCapacity = capacity ? capacity * 2 : 256;
+            CacheFile* newFiles = realloc(files, newCapacity * sizeof(CacheFile));
+
+            if(!newFiles) break;
+
+            files = newFiles;
+            capacity = newCapacity;
+        }
+
+        char* copy = strdup(name);
+        if(!copy) break;
+
+        files[numberOfFiles].name = copy;
+        files[numberOfFiles].used = st.st_mtim;
+        files[numberOfFiles].size = st.st_size;
+        numberOfFiles++;
+
+        totalSize += st.st_size;
+    }
+
+    if(totalSize > cache->maxSize)
+    {
+        qsort(files, numberOfFiles, sizeof(CacheFile), compareCacheFiles);
+
+        size_t targetSize = cache->maxSize / 4 * 3;
+
+        for(int i = 0; i < numberOfFiles && totalSize > targetSize; i++)
+        {
+            if(unlinkat(dirfd(dir), files[i].name, 0) == 0 || errno == ENOENT)
+                totalSize -= files[i].size;
+        }
+    }
+
+    for(int i = 0; i < numberOfFiles; i++)
+        free(files[i].name);
+
+    free(files);
+    closedir(dir);
+}
+
+void closeParseCache(ParseCache* cache)
+{
+    if(!cache->dir) return;
+
+    if(cache->stored) evictParseCache(cache);
+
+    pthread_mutex_destroy(&cache->lock);
+
+    free(cache->dir);
+    cache->dir = NULL;
+}
+
+uint64_t getParseCacheKey(const ParseCache* cache, const TokenList* tokenList, uint64_t optionsHash)
+{
+    return hashTokenList(tokenList, hashCacheBytes(&optionsHash, sizeof(optionsHash), cache->buildHash));
+}
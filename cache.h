@@ -0,0 +1,127 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "token.h"
+
+#define DEFAULT_PARSE_CACHE_SIZE ((size_t)256 << 20)
+
+/**
+ * On disk cache of the outputs of parses, shared by the runs of parser.out
+ * .. and the workers of a batch.
+ *
+ * An entry is keyed by a hash of the whole token list, of its token ids and
+ * .. lexemes, mixed with a hash of the options of the run and of the parser
+ * .. executable, so that a rebuilt parser does not see the entries of the
+ * .. previous one. It holds everything the parse wrote, which is the parsing
+ * .. history or the tree, the symbol table and the verdict, and the results
+ * .. of the parse, see CacheEntryHeader.
+ *
+ * Each entry is a file of the cache directory named after its key. It is
+ * .. written under a temporary name first and renamed to its name once it is
+ * .. complete, so that concurrent runs only see complete entries, and the
+ * .. last writer of an entry wins. A hit touches the modification time of
+ * .. its entry, and once the entries take more than maxSize bytes, the least
+ * .. recently used ones are removed till they take at most 3/4 of it. This is
+ * .. done by closeParseCache(), if the run stored anything.
+ *
+ * dir       : the cache directory
+ * maxSize   : the most bytes the entries may take
+ * buildHash : hash of the parser executable
+ * stored    : number of the entries stored by this process, under lock
+ * */
+typedef struct {
+    char* dir;
+    size_t maxSize;
+    uint64_t buildHash;
+
+    pthread_mutex_t lock;
+    int stored;
+} ParseCache;
+
+/**
+ * Results of a cached parse, which --stats reports on a hit.
+ * err     : the error code of the parse
+ * symbols : the number of the symbols of the parse
+ * tokens  : the number of the tokens the parse consumed
+ * */
+typedef struct {
+    int32_t err;
+    int32_t symbols;
+    int64_t tokens;
+} CachedParse;
+
+#define PARSE_CACHE_MAGIC "PL0C"
+#define PARSE_CACHE_VERSION 1
+
+/**
+ * Header of the file of a cache entry, which the output follows.
+ * magic          : "PL0C"
+ * version        : PARSE_CACHE_VERSION
+ * key            : the key of the entry
+ * numberOfTokens : number of the tokens of the parsed list, which a hit
+ *                  checks as well as the key
+ * parse          : the results of the parse
+ * outputSize     : the size of the output
+ * */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t numberOfTokens;
+    CachedParse parse;
+    uint64_t outputSize;
+} CacheEntryHeader;
+
+/**
+ * Opens the cache in the given directory, creating it if needed, with the
+ * .. given size bound, or DEFAULT_PARSE_CACHE_SIZE if it is 0.
+ * Returns 0 on success, -1 if the directory cannot be created.
+ * */
+int openParseCache(ParseCache*, const char* dir, size_t maxSize);
+
+/**
+ * Evicts the least recently used entries of the given cache if this process
+ * .. stored any entries, and makes the necessary deallocations on it.
+ * */
+void closeParseCache(ParseCache*);
+
+/**
+ * Returns a 64 bit non cryptographic hash of the given bytes, starting from
+ * .. the given seed
+ * */
+uint64_t hashCacheBytes(const void*, size_t, uint64_t seed);
+
+/**
+ * Returns a hash of the token ids and the lexemes of the given list, which
+ * .. does not depend on the order its lexemes were interned in, starting from
+ * .. the given seed. The list should not be streamed.
+ * */
+uint64_t hashTokenList(const TokenList*, uint64_t seed);
+
+/**
+ * Returns the key of the entry of the given token list parsed with options
+ * .. of the given hash
+ * */
+uint64_t getParseCacheKey(const ParseCache*, const TokenList*, uint64_t optionsHash);
+
+/**
+ * Looks up the entry of the given key, of a list of the given number of
+ * .. tokens. On a hit, writes its output to the given file, sets the results
+ * .. of its parse, and returns 1. Returns 0 on a miss, and -1 if the output
+ * .. cannot be written.
+ * */
+int lookupParseCache(ParseCache*, uint64_t key, int numberOfTokens, FILE*, CachedParse*);
+
+/**
+ * Stores the given output of a parse of a list of the given number of
+ * .. tokens, which had the given results, as the entry of the given key.
+ * Outputs larger than the cache are not stored. Failures are not reported,
+ * .. the entry is simply not there.
+ * */
+void storeParseCache(ParseCache*, uint64_t key, int numberOfTokens, CachedParse, const char* output, size_t);
+
+#endif
@@ -0,0 +1,529 @@
+#include "codegen.h"
+#include "data.h"
+
+static const char* opNames[] = {
+    [OP_LIT] = "LIT", [OP_OPR] = "OPR", [OP_LOD] = "LOD", [OP_STO] = "STO",
+    [OP_CAL] = "CAL", [OP_INT] = "INT", [OP_JMP] = "JMP", [OP_JPC] = "JPC",
+    [OP_SIO] = "SIO"
+};
+
+// Operation of OPR for each operator token
+static const int operatorOprs[] = {
+    [plussym] = OPR_ADD, [minussym] = OPR_SUB, [multsym] = OPR_MUL, [slashsym] = OPR_DIV,
+    [eqsym] = OPR_EQL, [neqsym] = OPR_NEQ, [lessym] = OPR_LSS, [leqsym] = OPR_LEQ,
+    [gtrsym] = OPR_GTR, [geqsym] = OPR_GEQ
+};
+
+/**
+ * State of a code generation.
+ * addresses : for each symbol of the table, the address of a variable in its
+ *             record, or the address of the code of a procedure
+ * depth     : number of the words pushed by the current statement
+ * */
+typedef struct {
+    const Ast* ast;
+    const SymbolTable* symbolTable;
+    Code* code;
+
+    int* addresses;
+
+    int depth;
+    int maxDepth;
+
+    int err;
+} CodeGenerator;
+
+/**
+ * Places, in the code of the nodes, that the generation goes on from. The
+ * .. first place of each kind of node is where it begins, and each of the
+ * .. others is right after a child that it generates in turn, which is named
+ * .. after it.
+ * */
+typedef enum {
+    GS_BLOCK,
+    GS_BLOCK_CHILD,
+    GS_BLOCK_STATEMENT,
+
+    GS_STATEMENT,
+    GS_ASSIGN_EXPRESSION,
+    GS_BEGIN_STATEMENT,
+    GS_IF_CONDITION,
+    GS_IF_THEN_STATEMENT,
+    GS_IF_ELSE_STATEMENT,
+    GS_WHILE_CONDITION,
+    GS_WHILE_STATEMENT,
+    GS_WRITE_EXPRESSION,
+
+    GS_CONDITION,
+    GS_ODD_EXPRESSION,
+
+    GS_EXPRESSION,
+    GS_NEGATE_OPERAND,
+    GS_OPERATOR_LHS,
+    GS_OPERATOR_RHS
+} GenerationState;
+
+void initCode(Code* code, Arena* arena)
+{
+    code->instructions = NULL;
+    code->numberOfInstructions = 0;
+    code->capacity = 0;
+
+    code->stackMargin = FRAME_LINKS;
+    code->numberOfLevels = 1;
+
+    code->arena = arena;
+}
+
+void deleteCode(Code* code)
+{
+    if(!code) return;
+
+    arenaFree(code->arena, code->instructions);
+
+    initCode(code, code->arena);
+}
+
+/**
+ * Returns the number of the words the given instruction pushes, which is
+ * .. negative if it pops them
+ * */
+static int getStackEffect(int op, int m)
+{
+    switch(op)
+    {
+    case OP_LIT:
+    case OP_LOD:
+        return 1;
+
+    case OP_STO:
+    case OP_JPC:
+        return -1;
+
+    case OP_OPR:
+        return m == OPR_RET || m == OPR_NEG || m == OPR_ODD ? 0 : -1;
+
+    case OP_SIO:
+        return m == SIO_WRITE ? -1 : m == SIO_READ ? 1 : 0;
+
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Appends an instruction to the code and returns its address
+ * */
+static int emit(CodeGenerator* gen, int op, int l, int m)
+{
+    Code* code = gen->code;
+
+    // The buffer is sized for the tree, so it is never full
+    if(code->numberOfInstructions == code->capacity) return -1;
+
+    int address = code->numberOfInstructions++;
+
+    code->instructions[address].op = op;
+    code->instructions[address].l = l;
+    code->instructions[address].m = m;
+
+    gen->depth += getStackEffect(op, m);
+
+    if(gen->depth > gen->maxDepth)
+        gen->maxDepth = gen->depth;
+
+    return address;
+}
+
+/**
+ * Sets the target of the jump at the given address to the next instruction
+ * */
+static inline void patchJump(CodeGenerator* gen, int address)
+{
+    if(address >= 0)
+        gen->code->instructions[address].m = gen->code->numberOfInstructions;
+}
+
+/**
+ * Returns the symbol of the given IDENTIFIER node, or NULL after setting the
+ * .. error if it is not declared
+ * */
+static const Symbol* getNodeSymbol(CodeGenerator* gen, int node)
+{
+    int symbol = gen->ast->nodes[node].symbol;
+
+    if(symbol < 0)
+    {
+        if(!gen->err) gen->err = 1;
+        return NULL;
+    }
+
+    return &gen->symbolTable->symbols[symbol];
+}
+
+/**
+ * Returns the level difference between the given node and its symbol
+ * */
+static inline int getLevelDifference(CodeGenerator* gen, int node, const Symbol* symbol)
+{
+    return gen->ast->nodes[node].level - (int)symbol->level;
+}
+
+/**
+ * Moves on to the given place of the current frame, which is where the
+ * .. given child returns to, and begins the child at the given place
+ * */
+#define GENERATE(child, begin, resume) do { \
+        frame->state = (resume); \
+        if(!pushAstFrame(&stack, gen->ast, (child), (begin))) goto overflow; \
+        goto dispatch; \
+    } while(0)
+
+/**
+ * Moves on to the given place of the current frame
+ * */
+#define GENERATE_GOTO(place) do { \
+        frame->state = (place); \
+        goto dispatch; \
+    } while(0)
+
+/**
+ * Generates the code of the given block, which is the block of the program
+ * .. if the given root is. The code of each node is generated on a stack of
+ * .. the nodes it is in, in the same order as a recursion would, with its
+ * .. jumps in the saved numbers of its frame. Returns 0, or -1 if the stack
+ * .. cannot grow.
+ * */
+static int generateBlocks(CodeGenerator* gen, int root)
+{
+    const AstNode* nodes = gen->ast->nodes;
+
+    AstStack stack;
+    AstFrame* frame;
+
+    int node;
+    int first;
+    int child;
+    const Symbol* symbol;
+
+    initAstStack(&stack);
+
+    if(!pushAstFrame(&stack, gen->ast, root, GS_BLOCK))
+        goto overflow;
+
+dispatch:
+    frame = &stack.frames[stack.depth - 1];
+    node = frame->node;
+    first = nodes[node].firstChild;
+
+    switch(frame->state)
+    {
+    // block, with the address of its jump over the nested procedures and its frame size saved
+    case GS_BLOCK:
+    {
+        if(nodes[node].level >= gen->code->numberOfLevels)
+            gen->code->numberOfLevels = nodes[node].level + 1;
+
+        // The code of the nested procedures comes first, so it is jumped over
+        // .. if there is any
+        int hasProcedures = 0;
+
+        for(child = first; child >= 0; child = nodes[child].nextSibling)
+            hasProcedures |= nodes[child].kind == AST_PROC_DECLARATION;
+
+        frame->saved[0] = hasProcedures ? emit(gen, OP_JMP, 0, 0) : -1;
+        frame->saved[1] = FRAME_LINKS;
+    }
+        // Falls through
+
+    case GS_BLOCK_CHILD:
+        child = frame->child;
+
+        if(child < 0 || gen->err) goto leave;
+
+        frame->child = nodes[child].nextSibling;
+
+        switch(nodes[child].kind)
+        {
+        case AST_CONST_DECLARATION:
+            // Constants are compiled into the code
+            GENERATE_GOTO(GS_BLOCK_CHILD);
+
+        case AST_VAR_DECLARATION:
+            for(int var = nodes[child].firstChild; var >= 0; var = nodes[var].nextSibling)
+            {
+                if(nodes[var].symbol >= 0)
+                    gen->addresses[nodes[var].symbol] = frame->saved[1];
+
+                frame->saved[1]++;
+            }
+            GENERATE_GOTO(GS_BLOCK_CHILD);
+
+        case AST_PROC_DECLARATION:
+            // Set before the body, which may call itself
+            if(nodes[child].symbol >= 0)
+                gen->addresses[nodes[child].symbol] = gen->code->numberOfInstructions;
+
+            GENERATE(nodes[child].firstChild, GS_BLOCK, GS_BLOCK_CHILD);
+
+        default:
+            patchJump(gen, frame->saved[0]);
+
+            emit(gen, OP_INT, 0, frame->saved[1]);
+            GENERATE(child, GS_STATEMENT, GS_BLOCK_STATEMENT);
+        }
+
+    case GS_BLOCK_STATEMENT:
+        if(node == root) emit(gen, OP_SIO, 0, SIO_HALT);
+        else             emit(gen, OP_OPR, 0, OPR_RET);
+        GENERATE_GOTO(GS_BLOCK_CHILD);
+
+    // statement
+    case GS_STATEMENT:
+        switch(nodes[node].kind)
+        {
+        case AST_ASSIGN:
+            if(!(symbol = getNodeSymbol(gen, first))) goto leave;
+
+            if(symbol->type != VAR)
+            {
+                gen->err = 2;
+                goto leave;
+            }
+
+            GENERATE(nodes[first].nextSibling, GS_EXPRESSION, GS_ASSIGN_EXPRESSION);
+
+        case AST_CALL:
+            if(!(symbol = getNodeSymbol(gen, first))) goto leave;
+
+            if(symbol->type != PROC)
+            {
+                gen->err = 3;
+                goto leave;
+            }
+
+            // The links of the callee go on top of the stack
+            if(gen->depth + FRAME_LINKS > gen->maxDepth)
+                gen->maxDepth = gen->depth + FRAME_LINKS;
+
+            emit(gen, OP_CAL, getLevelDifference(gen, first, symbol), gen->addresses[nodes[first].symbol]);
+            goto leave;
+
+        case AST_BEGIN:
+            GENERATE_GOTO(GS_BEGIN_STATEMENT);
+
+        case AST_IF:
+            GENERATE(first, GS_CONDITION, GS_IF_CONDITION);
+
+        case AST_WHILE:
+            // The start of the loop and its exit are saved
+            frame->saved[0] = gen->code->numberOfInstructions;
+            GENERATE(first, GS_CONDITION, GS_WHILE_CONDITION);
+
+        case AST_WRITE:
+            GENERATE(first, GS_EXPRESSION, GS_WRITE_EXPRESSION);
+
+        case AST_READ:
+            if(!(symbol = getNodeSymbol(gen, first))) goto leave;
+
+            if(symbol->type != VAR)
+            {
+                gen->err = 2;
+                goto leave;
+            }
+
+            emit(gen, OP_SIO, 0, SIO_READ);
+            emit(gen, OP_STO, getLevelDifference(gen, first, symbol), gen->addresses[nodes[first].symbol]);
+            goto leave;
+
+        default:
+            goto leave;
+        }
+
+    case GS_ASSIGN_EXPRESSION:
+        symbol = &gen->symbolTable->symbols[nodes[first].symbol];
+        emit(gen, OP_STO, getLevelDifference(gen, first, symbol), gen->addresses[nodes[first].symbol]);
+        goto leave;
+
+    case GS_BEGIN_STATEMENT:
+        child = frame->child;
+
+        if(child < 0 || gen->err) goto leave;
+
+        frame->child = nodes[child].nextSibling;
+        GENERATE(child, GS_STATEMENT, GS_BEGIN_STATEMENT);
+
+    // The jumps over the then and the else statements are saved
+    case GS_IF_CONDITION:
+        frame->saved[0] = emit(gen, OP_JPC, 0, 0);
+        GENERATE(nodes[first].nextSibling, GS_STATEMENT, GS_IF_THEN_STATEMENT);
+
+    case GS_IF_THEN_STATEMENT:
+        child = nodes[nodes[first].nextSibling].nextSibling;
+
+        if(child < 0)
+        {
+            patchJump(gen, frame->saved[0]);
+            goto leave;
+        }
+
+        frame->saved[1] = emit(gen, OP_JMP, 0, 0);
+
+        patchJump(gen, frame->saved[0]);
+        GENERATE(child, GS_STATEMENT, GS_IF_ELSE_STATEMENT);
+
+    case GS_IF_ELSE_STATEMENT:
+        patchJump(gen, frame->saved[1]);
+        goto leave;
+
+    case GS_WHILE_CONDITION:
+        frame->saved[1] = emit(gen, OP_JPC, 0, 0);
+        GENERATE(nodes[first].nextSibling, GS_STATEMENT, GS_WHILE_STATEMENT);
+
+    case GS_WHILE_STATEMENT:
+        emit(gen, OP_JMP, 0, frame->saved[0]);
+
+        patchJump(gen, frame->saved[1]);
+        goto leave;
+
+    case GS_WRITE_EXPRESSION:
+        emit(gen, OP_SIO, 0, SIO_WRITE);
+        goto leave;
+
+    // condition
+    case GS_CONDITION:
+        switch(nodes[node].kind)
+        {
+        case AST_ODD:
+            GENERATE(first, GS_EXPRESSION, GS_ODD_EXPRESSION);
+
+        case AST_RELATION:
+            GENERATE(first, GS_EXPRESSION, GS_OPERATOR_LHS);
+
+        default:
+            // A folded condition is a number
+            GENERATE_GOTO(GS_EXPRESSION);
+        }
+
+    case GS_ODD_EXPRESSION:
+        emit(gen, OP_OPR, 0, OPR_ODD);
+        goto leave;
+
+    // expression
+    case GS_EXPRESSION:
+        switch(nodes[node].kind)
+        {
+        case AST_NUMBER:
+            emit(gen, OP_LIT, 0, nodes[node].value);
+            goto leave;
+
+        case AST_IDENTIFIER:
+            if(!(symbol = getNodeSymbol(gen, node))) goto leave;
+
+            if(symbol->type == CONST)
+                emit(gen, OP_LIT, 0, symbol->value);
+            else if(symbol->type == VAR)
+                emit(gen, OP_LOD, getLevelDifference(gen, node, symbol), gen->addresses[nodes[node].symbol]);
+            else if(!gen->err)
+                gen->err = 4;
+            goto leave;
+
+        case AST_NEGATE:
+            GENERATE(first, GS_EXPRESSION, GS_NEGATE_OPERAND);
+
+        case AST_BINARY:
+            GENERATE(first, GS_EXPRESSION, GS_OPERATOR_LHS);
+
+        default:
+            goto leave;
+        }
+
+    case GS_NEGATE_OPERAND:
+        emit(gen, OP_OPR, 0, OPR_NEG);
+        goto leave;
+
+    // The operands of a relation or a binary operator
+    case GS_OPERATOR_LHS:
+        GENERATE(nodes[first].nextSibling, GS_EXPRESSION, GS_OPERATOR_RHS);
+
+    case GS_OPERATOR_RHS:
+        emit(gen, OP_OPR, 0, operatorOprs[nodes[node].op]);
+        goto leave;
+    }
+
+leave:
+    // Return to the frame below, if any
+    if(--stack.depth > 0)
+        goto dispatch;
+
+    deleteAstStack(&stack);
+    return 0;
+
+overflow:
+    deleteAstStack(&stack);
+    return -1;
+}
+
+int generateCode(const Ast* ast, const SymbolTable* symbolTable, Code* code)
+{
+    code->numberOfInstructions = 0;
+    code->stackMargin = FRAME_LINKS;
+    code->numberOfLevels = 1;
+
+    if(!ast || ast->root < 0) return 0;
+
+    // No node emits more than three instructions, and the program halts
+    int capacity = 3 * ast->numberOfNodes + 1;
+
+    if(code->capacity < capacity)
+    {
+        Instruction* instructions = arenaRealloc(code->arena, code->instructions, code->capacity * sizeof(Instruction), capacity * sizeof(Instruction));
+        if(!instructions) return -1;
+
+        code->instructions = instructions;
+        code->capacity = capacity;
+    }
+
+    CodeGenerator gen;
+    gen.ast = ast;
+    gen.symbolTable = symbolTable;
+    gen.code = code;
+    gen.depth = 0;
+    gen.maxDepth = 0;
+    gen.err = 0;
+
+    gen.addresses = arenaRealloc(code->arena, NULL, 0, (symbolTable->numberOfSymbols + 1) * sizeof(int));
+    if(!gen.addresses) return -1;
+
+    int err = generateBlocks(&gen, ast->nodes[ast->root].firstChild);
+
+    arenaFree(code->arena, gen.addresses);
+
+    if(err) return err;
+
+    if(gen.maxDepth > code->stackMargin)
+        code->stackMargin = gen.maxDepth;
+
+    return gen.err;
+}
+
+void printCode(const Code* code, Sink* out)
+{
+    if(!code || !out) return;
+
+    writeSinkString(out, "Line  OP   L  M\n");
+
+    for(int i = 0; i < code->numberOfInstructions; i++)
+    {
+        const Instruction* instruction = &code->instructions[i];
+
+        printfSink(out, "%4d  %s  %d  %d\n", i, opNames[instruction->op], instruction->l, instruction->m);
+    }
+}
+
+void printCodeGenErrToSink(int errCode, Sink* sink)
+{
+    if(!sink || !errCode) return;
+
+    printfSink(sink, "\nCODE GENERATION ERROR[%d]: %s.\n", errCode, codeGenErrorMsg[errCode]);
+}
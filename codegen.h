@@ -0,0 +1,102 @@
+#ifndef __CODEGEN_H__
+#define __CODEGEN_H__
+
+#include "ast.h"
+#include "symbol.h"
+#include "arena.h"
+#include "sink.h"
+
+/**
+ * Instructions of the P-machine, see vm.h for what each one does
+ * */
+typedef enum {
+    OP_LIT = 1, OP_OPR, OP_LOD, OP_STO, OP_CAL, OP_INT, OP_JMP, OP_JPC, OP_SIO
+} OpCode;
+
+/**
+ * Operations of OPR, given by its M field
+ * */
+typedef enum {
+    OPR_RET, OPR_NEG, OPR_ADD, OPR_SUB, OPR_MUL, OPR_DIV, OPR_ODD, OPR_MOD,
+    OPR_EQL, OPR_NEQ, OPR_LSS, OPR_LEQ, OPR_GTR, OPR_GEQ
+} OprCode;
+
+/**
+ * Operations of SIO, given by its M field
+ * */
+typedef enum {
+    SIO_WRITE = 1, SIO_READ, SIO_HALT
+} SioCode;
+
+/**
+ * Number of the words at the bottom of each activation record, which the
+ * .. machine links the records with, see vm.h. The variables of the record
+ * .. come after them.
+ * */
+#define FRAME_LINKS 4
+
+/**
+ * An instruction, where l is a level difference and m is a number, a
+ * .. program or data address, or the operation of OPR and SIO
+ * */
+typedef struct {
+    int op;
+    int l;
+    int m;
+} Instruction;
+
+/**
+ * Code of a program, which starts at its first instruction.
+ * stackMargin    : the most words that a statement pushes on top of the
+ *                  variables of its activation record, including the links
+ *                  of a call, so that the stack is only checked when a
+ *                  record is allocated
+ * numberOfLevels : number of the levels the code has records at, which is
+ *                  one more than the deepest level of a procedure
+ * If arena is not NULL, the instructions are allocated from it.
+ * */
+typedef struct {
+    Instruction* instructions;
+    int numberOfInstructions;
+    int capacity;
+
+    int stackMargin;
+    int numberOfLevels;
+
+    Arena* arena;
+} Code;
+
+/**
+ * Initializes the given code to an empty one, which allocates from the given
+ * .. arena, or from the heap if it is NULL.
+ * */
+void initCode(Code*, Arena*);
+
+/**
+ * Makes the necessary deallocations on the given code, and empties it.
+ * */
+void deleteCode(Code*);
+
+/**
+ * Generates the code of the given tree, which should be complete, into the
+ * .. given code, replacing what it held. The symbols of the identifiers are
+ * .. looked up in the given symbol table, which should be the table of the
+ * .. parse that built the tree. Folded trees, see fold.h, are supported.
+ * The instructions are allocated at once, from an upper bound on their
+ * .. number given by the number of nodes.
+ * Returns 0 on success, or the code generation error code, in which case
+ * .. the code is incomplete.
+ * */
+int generateCode(const Ast*, const SymbolTable*, Code*);
+
+/**
+ * Writes the given code on the given sink, one instruction per line.
+ * */
+void printCode(const Code*, Sink*);
+
+/**
+ * Given the code generation error code, prints error message on sink.
+ * */
+void printCodeGenErrToSink(int errCode, Sink*);
+
+#endif
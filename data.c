@@ -36,7 +36,37 @@ const char* parserErrorMsg[] =
     [11] = "'do' expected",
     [12] = "Relational operator expected",
     [13] = "Right parenthesis missing",
-    [14] = "The preceding factor cannot begin with this symbol"
+    [14] = "The preceding factor cannot begin with this symbol",
+    [15] = "Program is nested deeper than the parse stack allows",
+    [16] = "Out of memory"
+};
+
+const char* lexerErrorMsg[] =
+{
+    [0] = "SUCCESS",
+    [1] = "Identifier does not start with a letter",
+    [2] = "Number is too long",
+    [3] = "Identifier is too long",
+    [4] = "Invalid symbol",
+    [5] = "Comment is not closed",
+    [6] = "Out of memory"
+};
+
+const char* codeGenErrorMsg[] =
+{
+    [0] = "SUCCESS",
+    [1] = "Undeclared identifier",
+    [2] = "Assignment to constant or procedure is not allowed",
+    [3] = "Call of a constant or variable is meaningless",
+    [4] = "Expression must not contain a procedure identifier"
+};
+
+const char* vmErrorMsg[] =
+{
+    [0] = "SUCCESS",
+    [1] = "Stack overflow",
+    [2] = "Division by zero",
+    [3] = "Input is not a number"
 };
 
 const char* nonTerminalNames[] = {
@@ -28,6 +28,12 @@ extern const char* tokenNames[];
 
 extern const char* parserErrorMsg[];
 
+extern const char* lexerErrorMsg[];
+
+extern const char* codeGenErrorMsg[];
+
+extern const char* vmErrorMsg[];
+
 extern const char* nonTerminalNames[];
 
 #endif
\ No newline at end of file
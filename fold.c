@@ -0,0 +1,302 @@
+#include "fold.h"
+#include <limits.h>
+
+/**
+ * State of a folding pass
+ * */
+typedef struct {
+    Ast* ast;
+    const SymbolTable* symbolTable;
+    int folded;
+} Folder;
+
+static inline int isNumber(const Ast* ast, int node, int value)
+{
+    return ast->nodes[node].kind == AST_NUMBER && ast->nodes[node].value == value;
+}
+
+/**
+ * Turns the given node into a NUMBER node, keeping its place in the tree
+ * */
+static void makeNumber(Folder* folder, int node, long long value)
+{
+    AstNode* n = &folder->ast->nodes[node];
+
+    n->kind = AST_NUMBER;
+    n->op = 0;
+    n->firstChild = -1;
+    n->value = (int)value;
+    n->symbol = -1;
+
+    folder->folded++;
+}
+
+/**
+ * Turns the given node into an EMPTY statement, keeping its place in the tree
+ * */
+static void makeEmpty(Folder* folder, int node)
+{
+    AstNode* n = &folder->ast->nodes[node];
+
+    n->kind = AST_EMPTY;
+    n->op = 0;
+    n->firstChild = -1;
+    n->value = 0;
+    n->symbol = -1;
+
+    folder->folded++;
+}
+
+/**
+ * Replaces the given node by a copy of the given one, which is one of its
+ * .. descendants, keeping the place of the node among its siblings
+ * */
+static void replaceNode(Folder* folder, int node, int by)
+{
+    AstNode* nodes = folder->ast->nodes;
+
+    int nextSibling = nodes[node].nextSibling;
+
+    nodes[node] = nodes[by];
+    nodes[node].nextSibling = nextSibling;
+
+    folder->folded++;
+}
+
+/**
+ * Evaluates the given binary operator. Returns 0 if the result is not
+ * .. defined or does not fit in an int.
+ * */
+static int evaluateBinary(int op, long long lhs, long long rhs, long long* result)
+{
+    switch(op)
+    {
+    case plussym:  *result = lhs + rhs; break;
+    case minussym: *result = lhs - rhs; break;
+    case multsym:  *result = lhs * rhs; break;
+    case slashsym:
+        if(rhs == 0) return 0;
+        *result = lhs / rhs;
+        break;
+    default:
+        return 0;
+    }
+
+    return *result >= INT_MIN && *result <= INT_MAX;
+}
+
+static int evaluateRelation(int op, int lhs, int rhs)
+{
+    switch(op)
+    {
+    case eqsym:  return lhs == rhs;
+    case neqsym: return lhs != rhs;
+    case lessym: return lhs < rhs;
+    case leqsym: return lhs <= rhs;
+    case gtrsym: return lhs > rhs;
+    default:     return lhs >= rhs;
+    }
+}
+
+/**
+ * Pushes the frames of the children of the given node that are folded on
+ * .. the given stack, which are the procedures and the statement of a block,
+ * .. the statements and conditions of statements and the operands of
+ * .. operators. Returns 0 if the stack cannot grow.
+ * */
+static int pushFoldedChildren(Folder* folder, AstStack* stack, int node)
+{
+    const AstNode* nodes = folder->ast->nodes;
+
+    int first = nodes[node].firstChild;
+
+    switch(nodes[node].kind)
+    {
+    case AST_BLOCK:
+        for(int child = first; child >= 0; child = nodes[child].nextSibling)
+        {
+            switch(nodes[child].kind)
+            {
+            case AST_CONST_DECLARATION:
+            case AST_VAR_DECLARATION:
+                break;
+
+            case AST_PROC_DECLARATION:
+                if(!pushAstFrame(stack, folder->ast, nodes[child].firstChild, 0)) return 0;
+                break;
+
+            default:
+                if(!pushAstFrame(stack, folder->ast, child, 0)) return 0;
+                break;
+            }
+        }
+        return 1;
+
+    case AST_ASSIGN:
+        return pushAstFrame(stack, folder->ast, nodes[first].nextSibling, 0) != NULL;
+
+    case AST_BEGIN:
+    case AST_IF:
+    case AST_WHILE:
+    case AST_ODD:
+    case AST_RELATION:
+    case AST_NEGATE:
+    case AST_BINARY:
+        for(int child = first; child >= 0; child = nodes[child].nextSibling)
+            if(!pushAstFrame(stack, folder->ast, child, 0)) return 0;
+        return 1;
+
+    default:
+        return 1;
+    }
+}
+
+/**
+ * Folds the given node, whose children are folded
+ * */
+static void foldNode(Folder* folder, int node)
+{
+    AstNode* nodes = folder->ast->nodes;
+
+    int first = nodes[node].firstChild;
+
+    switch(nodes[node].kind)
+    {
+    case AST_IDENTIFIER:
+    {
+        int symbol = nodes[node].symbol;
+
+        if(symbol >= 0 && folder->symbolTable->symbols[symbol].type == CONST)
+            makeNumber(folder, node, folder->symbolTable->symbols[symbol].value);
+        break;
+    }
+
+    case AST_NEGATE:
+        if(nodes[first].kind == AST_NUMBER && nodes[first].value != INT_MIN)
+            makeNumber(folder, node, -(long long)nodes[first].value);
+        else if(nodes[first].kind == AST_NEGATE)
+            replaceNode(folder, node, nodes[first].firstChild);
+        break;
+
+    case AST_BINARY:
+    {
+        int lhs = first;
+        int rhs = nodes[lhs].nextSibling;
+        int op = nodes[node].op;
+
+        long long result;
+
+        if(nodes[lhs].kind == AST_NUMBER && nodes[rhs].kind == AST_NUMBER)
+        {
+            if(evaluateBinary(op, nodes[lhs].value, nodes[rhs].value, &result))
+                makeNumber(folder, node, result);
+        }
+        // Drop the operands that leave the other one as it is
+        else if((op == plussym || op == minussym) && isNumber(folder->ast, rhs, 0))
+            replaceNode(folder, node, lhs);
+        else if(op == plussym && isNumber(folder->ast, lhs, 0))
+            replaceNode(folder, node, rhs);
+        else if((op == multsym || op == slashsym) && isNumber(folder->ast, rhs, 1))
+            replaceNode(folder, node, lhs);
+        else if(op == multsym && isNumber(folder->ast, lhs, 1))
+            replaceNode(folder, node, rhs);
+        break;
+    }
+
+    case AST_ODD:
+        if(nodes[first].kind == AST_NUMBER)
+            makeNumber(folder, node, nodes[first].value % 2 != 0);
+        break;
+
+    case AST_RELATION:
+    {
+        int rhs = nodes[first].nextSibling;
+
+        if(nodes[first].kind == AST_NUMBER && nodes[rhs].kind == AST_NUMBER)
+            makeNumber(folder, node, evaluateRelation(nodes[node].op, nodes[first].value, nodes[rhs].value));
+        break;
+    }
+
+    case AST_BEGIN:
+    {
+        // Unlink the empty statements
+        int previous = -1;
+
+        for(int child = first; child >= 0; child = nodes[child].nextSibling)
+        {
+            if(nodes[child].kind != AST_EMPTY)
+            {
+                previous = child;
+                continue;
+            }
+
+            if(previous < 0) nodes[node].firstChild = nodes[child].nextSibling;
+            else             nodes[previous].nextSibling = nodes[child].nextSibling;
+
+            folder->folded++;
+        }
+
+        if(nodes[node].firstChild < 0)
+            makeEmpty(folder, node);
+        break;
+    }
+
+    case AST_IF:
+    {
+        int thenStatement = nodes[first].nextSibling;
+        int elseStatement = nodes[thenStatement].nextSibling;
+
+        if(nodes[first].kind != AST_NUMBER) break;
+
+        if(nodes[first].value)   replaceNode(folder, node, thenStatement);
+        else if(elseStatement >= 0) replaceNode(folder, node, elseStatement);
+        else                     makeEmpty(folder, node);
+        break;
+    }
+
+    case AST_WHILE:
+        if(nodes[first].kind == AST_NUMBER && nodes[first].value == 0)
+            makeEmpty(folder, node);
+        break;
+
+    default:
+        break;
+    }
+}
+
+int foldAst(Ast* ast, const SymbolTable* symbolTable)
+{
+    if(!ast || ast->incomplete || ast->root < 0) return 0;
+
+    Folder folder = { ast, symbolTable, 0 };
+
+    // Each node is folded after its children, the first time its frame is
+    // .. on top of the stack with its children pushed
+    AstStack stack;
+    initAstStack(&stack);
+
+    if(!pushAstFrame(&stack, ast, ast->nodes[ast->root].firstChild, 0))
+        folder.folded = -1;
+
+    while(folder.folded >= 0 && stack.depth > 0)
+    {
+        AstFrame* frame = &stack.frames[stack.depth - 1];
+        int node = frame->node;
+
+        if(!frame->state)
+        {
+            frame->state = 1;
+
+            if(!pushFoldedChildren(&folder, &stack, node))
+                folder.folded = -1;
+            continue;
+        }
+
+        stack.depth--;
+        foldNode(&folder, node);
+    }
+
+    deleteAstStack(&stack);
+
+    return folder.folded;
+}
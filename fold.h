@@ -0,0 +1,32 @@
+#ifndef __FOLD_H__
+#define __FOLD_H__
+
+#include "ast.h"
+#include "symbol.h"
+
+/**
+ * Folds the given tree in place, using the symbols of the given symbol table,
+ * .. which should be the table of the parse that built the tree.
+ *
+ * Names of constants in expressions become their values, and the operators
+ * .. whose operands are all numbers are evaluated, the same way the program
+ * .. would, so BINARY, NEGATE, ODD and RELATION nodes become NUMBER nodes.
+ * A folded condition is a NUMBER, which holds if it is not 0. Operations
+ * .. that would overflow or divide by zero are left to run time.
+ * Operands that cannot change the result, such as x + 0 and x * 1, are
+ * .. dropped too.
+ *
+ * If statements with a constant condition are replaced by the branch that is
+ * .. taken, or EMPTY if there is none, while statements whose condition
+ * .. never holds by EMPTY, and EMPTY statements are dropped from BEGIN lists.
+ *
+ * Nodes are rewritten in place, so their indices do not change, and the
+ * .. nodes cut off from the tree stay in the pool. Incomplete trees are not
+ * .. folded.
+ * Returns the number of the nodes that are folded or pruned, or -1 if the
+ * .. stack of the nodes it is in cannot be allocated, in which case the tree
+ * .. is folded in part.
+ * */
+int foldAst(Ast*, const SymbolTable*);
+
+#endif
@@ -0,0 +1,903 @@
+/**
+ * The functions of the non-terminals of the grammar, written once and
+ * .. compiled into a variant for each kind of parse, so that each variant
+ * .. only does the work its parses need. parser.c includes this file once
+ * .. per variant, with:
+ * PARSER_VARIANT(name) : the name of the given function in the variant
+ * VARIANT_TRACES       : 1 if the variant writes the parsing history, for
+ *                        parses with an output sink
+ * VARIANT_BUILDS_AST   : 1 if the variant builds a tree, for parses with one
+ * The helpers that write the history and build the tree are compiled out
+ * .. of the variants that do neither, rather than checked on each call.
+ * Each variant calls its own functions only.
+ * */
+
+/**
+ * Helpers of parser.c, as the variant uses them. A macro is not expanded
+ * .. again in its own expansion, so each one calls the helper of its name.
+ * The child of appendChild() is evaluated in every variant, as it may
+ * .. declare a symbol.
+ * */
+#define printCurrentToken(ctx) do { if(VARIANT_TRACES) printCurrentToken(ctx); } while(0)
+#define printNonTerminal(ctx, nonTerminal) do { if(VARIANT_TRACES) printNonTerminal(ctx, nonTerminal); } while(0)
+#define addNode(ctx, kind, op, value, symbol) (VARIANT_BUILDS_AST ? addNode(ctx, kind, op, value, symbol) : -1)
+#define appendChild(ctx, children, child) \
+    do { if(VARIANT_BUILDS_AST) appendChild(ctx, children, child); else (void)(child); } while(0)
+#define addReferenceNode(ctx) (VARIANT_BUILDS_AST ? addReferenceNode(ctx) : -1)
+#define addOperatorNode(ctx, kind, op, lhs, rhs) (VARIANT_BUILDS_AST ? addOperatorNode(ctx, kind, op, lhs, rhs) : -1)
+#define setNodeTokens(ctx, node, firstToken) do { if(VARIANT_BUILDS_AST) setNodeTokens(ctx, node, firstToken); } while(0)
+
+/**
+ * The functions of the variant
+ * */
+#define program(ctx, node) PARSER_VARIANT(program)(ctx, node)
+#define block(ctx, node) PARSER_VARIANT(block)(ctx, node)
+#define const_declaration(ctx, node) PARSER_VARIANT(const_declaration)(ctx, node)
+#define var_declaration(ctx, node) PARSER_VARIANT(var_declaration)(ctx, node)
+#define proc_declaration(ctx, blockChildren) PARSER_VARIANT(proc_declaration)(ctx, blockChildren)
+#define parseProcedure(ctx, blockChildren) PARSER_VARIANT(parseProcedure)(ctx, blockChildren)
+#define statement(ctx, node) PARSER_VARIANT(statement)(ctx, node)
+#define parseStatement(ctx, node) PARSER_VARIANT(parseStatement)(ctx, node)
+#define condition(ctx, node) PARSER_VARIANT(condition)(ctx, node)
+#define parseCondition(ctx, node) PARSER_VARIANT(parseCondition)(ctx, node)
+#define relop(ctx) PARSER_VARIANT(relop)(ctx)
+#define expression(ctx, node) PARSER_VARIANT(expression)(ctx, node)
+#define term(ctx, node) PARSER_VARIANT(term)(ctx, node)
+#define factor(ctx, node) PARSER_VARIANT(factor)(ctx, node)
+
+/**
+ * Functions used for non-terminals of the grammar. Each one stores the node
+ * .. it parsed in node, or -1 if it fails or no tree is built.
+ * proc_declaration() appends each procedure to the children of its block.
+ * */
+static int program(ParserContext* ctx, int* node);
+static int block(ParserContext* ctx, int* node);
+static int const_declaration(ParserContext* ctx, int* node);
+static int var_declaration(ParserContext* ctx, int* node);
+static int proc_declaration(ParserContext* ctx, AstChildren* blockChildren);
+static int statement(ParserContext* ctx, int* node);
+static int condition(ParserContext* ctx, int* node);
+static int relop(ParserContext* ctx);
+static int expression(ParserContext* ctx, int* node);
+static int term(ParserContext* ctx, int* node);
+static int factor(ParserContext* ctx, int* node);
+
+/**
+ * Bodies of statement() and condition(), which recover from their errors
+ * */
+static int parseStatement(ParserContext* ctx, int* node);
+static int parseCondition(ParserContext* ctx, int* node);
+
+/**
+ * Body of the loop of proc_declaration(), which parses one procedure
+ * */
+static int parseProcedure(ParserContext* ctx, AstChildren* blockChildren);
+
+static int program(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, PROGRAM);
+
+    printNonTerminal(ctx, PROGRAM);
+
+    *node = -1;
+	
+	// Error variable to track errors.
+	int err = 0;
+	
+	// Pass to block and check error code returned.
+	int blockNode;
+	err = block(ctx, &blockNode);
+	if(err != 0)
+		return err;
+	
+	// Check if the last symbol is a period, otherwise return
+	// error 6 for "period expected".
+	if(getCurrentTokenType(ctx) != periodsym)
+		return 6;
+	
+	// Print period.
+	printCurrentToken(ctx);
+
+	// The program node holds the main block.
+	*node = addNode(ctx, AST_PROGRAM, 0, -1, -1);
+	AstChildren children = getAstChildren(*node);
+	appendChild(ctx, &children, blockNode);
+	setNodeTokens(ctx, *node, 0);
+
+    return 0;
+}
+
+static int block(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, BLOCK);
+
+    printNonTerminal(ctx, BLOCK);
+
+    *node = -1;
+	
+	// Error variable to track errors.
+	int err = 0;
+	int firstToken = getTokenListIteratorIndex(&ctx->it);
+
+	// The declarations and the statement are the children of
+	// the block node.
+	int self = addNode(ctx, AST_BLOCK, 0, -1, -1);
+	AstChildren children = getAstChildren(self);
+	int child;
+	
+	// Whether the statement comes right after a constant
+	// declaration, see resumeBlockDeclarations().
+	int afterConst = 0;
+	
+	// A recovering parse comes back here when the
+	// declarations go on after an error.
+declarations:;
+	int errors = ctx->numberOfErrors;
+	
+	// Check if current token is a constant and pass to constant
+	// declaration.
+	printNonTerminal(ctx, CONST_DECLARATION);
+    if(getCurrentTokenType(ctx) == constsym && err == 0)
+	{
+		err = const_declaration(ctx, &child);
+		if(err != 0)
+			err = recoverFromDeclarationError(ctx, err);
+		appendChild(ctx, &children, child);
+		afterConst = 1;
+	}
+	// Error check
+	if(err != 0)
+		return err;
+	
+	// Check if current token is a variable and pass to variable
+	// declaration.
+	printNonTerminal(ctx, VAR_DECLARATION);
+    if(getCurrentTokenType(ctx) == varsym && err == 0)
+	{
+		err = var_declaration(ctx, &child);
+		if(err != 0)
+			err = recoverFromDeclarationError(ctx, err);
+		appendChild(ctx, &children, child);
+		afterConst = 0;
+	}
+	// Error check
+	if(err != 0)
+		return err;
+	
+	// Check if current token is a procedure and pass to 
+	// procedure declaration.
+	printNonTerminal(ctx, PROC_DECLARATION);
+	// A recovering parse goes on with the next procedure.
+	while(getCurrentTokenType(ctx) == procsym && err == 0)
+	{
+		err = proc_declaration(ctx, &children);
+		if(err != 0)
+			err = recoverFromDeclarationError(ctx, err);
+		afterConst = 0;
+	}
+	// Error check
+	if(err != 0)
+		return err;
+	
+	// A recovering parse that resumed at a declaration after
+	// an error in the declarations goes back into them.
+	if(ctx->numberOfErrors > errors &&
+	   isTokenInClass(getCurrentTokenType(ctx), TC_DECLARATION_START))
+		goto declarations;
+	
+	int statementToken = afterConst ? getTokenListIteratorIndex(&ctx->it) : -1;
+	err = statement(ctx, &child);
+	appendChild(ctx, &children, child);
+	
+	if(err == 0 && resumeBlockDeclarations(ctx, statementToken))
+		goto declarations;
+	
+	setNodeTokens(ctx, self, firstToken);
+
+	if(!err)
+		*node = self;
+	
+    return err;
+}
+
+static int const_declaration(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, CONST_DECLARATION);
+
+    *node = -1;
+
+	// The declared names are the children of the declaration
+	// node.
+	int self = addNode(ctx, AST_CONST_DECLARATION, 0, -1, -1);
+	AstChildren children = getAstChildren(self);
+
+	// Do while loop parses constant declaration. Goes until a 
+	// comma isn't found.
+    do
+	{
+		// Declare a new Symbol and set its type and level 
+		// values.
+		Symbol newSym;
+		newSym.type = CONST;
+		newSym.level = ctx->currentLevel;
+		
+		// Get next token and check that it is an identifier.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != identsym)
+			return 3;
+		// Update the symbol's name.
+		newSym.name = getCurrentLexemeId(ctx);
+		
+		// Get next token and check that it is an equal sign.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != eqsym)
+			return 2;
+		
+		// Get the next token and check that it is a number.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != numbersym)
+			return 1;
+		// Update the symbol's value.
+		newSym.value = atoi(getCurrentLexeme(ctx));
+		
+		// Add the new symbol to the table.
+		appendChild(ctx, &children, addDeclaredNode(ctx, AST_IDENTIFIER, newSym));
+		
+		// Get next token.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+	} while(getCurrentTokenType(ctx) == commasym);
+	
+	// Check for semicolon and get the next token.
+	if(getCurrentTokenType(ctx) != semicolonsym)
+		return 5;
+	printCurrentToken(ctx);
+	nextToken(ctx);
+
+    // Successful parsing.
+	*node = self;
+    return 0;
+}
+
+static int var_declaration(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, VAR_DECLARATION);
+
+    *node = -1;
+
+	// The declared names are the children of the declaration
+	// node.
+	int self = addNode(ctx, AST_VAR_DECLARATION, 0, -1, -1);
+	AstChildren children = getAstChildren(self);
+
+    do
+	{
+		// Declare a new symbol and set its type and level
+		// values.
+		Symbol newSym;
+		newSym.type = VAR;
+		newSym.level = ctx->currentLevel;
+		
+		// Get next token and check that it is an identifier.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != identsym)
+			return 3;
+		// Update the symbol's name.
+		newSym.name = getCurrentLexemeId(ctx);
+		
+		// Get the next token.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		
+		// Add the new symbol to the table.
+		appendChild(ctx, &children, addDeclaredNode(ctx, AST_IDENTIFIER, newSym));
+	} while(getCurrentTokenType(ctx) == commasym);
+	
+	// Check for semicolon and get the next token.
+	if(getCurrentTokenType(ctx) != semicolonsym)
+		return 4;
+	printCurrentToken(ctx);
+	nextToken(ctx);
+
+	*node = self;
+    return 0;
+}
+
+static int proc_declaration(ParserContext* ctx, AstChildren* blockChildren)
+{
+    STATS_ENTER(ctx, PROC_DECLARATION);
+
+	// Error variable for tracking error codes.
+	int err = 0;
+	
+	// While loop parses procedure declaration. The procedures
+	// that a parallel parse has parsed already are taken from
+	// it instead.
+    while(getCurrentTokenType(ctx) == procsym && err == 0)
+	{
+		if(ctx->parallelParse && takeParsedProcedures(ctx, &err))
+			continue;
+
+		err = parseProcedure(ctx, blockChildren);
+	}
+
+    return err;
+}
+
+static int parseProcedure(ParserContext* ctx, AstChildren* blockChildren)
+{
+	// Declare a new symbol and set its type and level
+	// values.
+	int firstToken = getTokenListIteratorIndex(&ctx->it);
+	Symbol newSym;
+	newSym.type = PROC;
+	newSym.level = ctx->currentLevel;
+	
+	// Get next token and check that it is an identifier.
+	printCurrentToken(ctx);
+	nextToken(ctx);
+	if(getCurrentTokenType(ctx) != identsym)
+		return 3;
+	// Update the symbol's name.
+	newSym.name = getCurrentLexemeId(ctx);
+	
+	// Add the new symbol to the table. Each procedure is a
+	// child of the enclosing block.
+	int procNode = addDeclaredNode(ctx, AST_PROC_DECLARATION, newSym);
+	AstChildren children = getAstChildren(procNode);
+	
+	// Get next token and check that it is a semicolon.
+	printCurrentToken(ctx);
+	nextToken(ctx);
+	if(getCurrentTokenType(ctx) != semicolonsym &&
+	   !isMissingSemicolon(ctx, 5, TC_BLOCK_START))
+		return 5;
+	
+	// Get next token, unless the semicolon is missing.
+	if(getCurrentTokenType(ctx) == semicolonsym)
+	{
+		printCurrentToken(ctx);
+		nextToken(ctx);
+	}
+	
+	// Increment the current level for the next block and
+	// decrement it after the block is finished. The block
+	// declares its symbols in a scope of its own.
+	int blockNode;
+	ctx->currentLevel++;
+	if(enterScope(&ctx->symbolTable) != 0)
+	{
+		ctx->currentLevel--;
+		return PARSER_MEMORY_ERROR;
+	}
+	int err = block(ctx, &blockNode);
+	exitScope(&ctx->symbolTable);
+	ctx->currentLevel--;
+	
+	// If error is found return immediately.
+	if(err != 0)
+		return err;
+
+	appendChild(ctx, &children, blockNode);
+	appendChild(ctx, blockChildren, procNode);
+	
+	// Check for semicolon after new block.
+	if(getCurrentTokenType(ctx) != semicolonsym)
+		return 5;
+	
+	// Get next token.
+	printCurrentToken(ctx);
+	nextToken(ctx);
+	setNodeTokens(ctx, procNode, firstToken);
+
+    return 0;
+}
+
+static int statement(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, STATEMENT);
+
+    int firstToken = getTokenListIteratorIndex(&ctx->it);
+
+    int err = parseStatement(ctx, node);
+
+    setNodeTokens(ctx, *node, firstToken);
+
+    if(err != 0)
+        err = recoverFromError(ctx, err, TC_STATEMENT_FOLLOW);
+
+    return err;
+}
+
+static int parseStatement(ParserContext* ctx, int* node)
+{
+    printNonTerminal(ctx, STATEMENT);
+
+    *node = -1;
+	
+	// Error variable for tracking error codes.
+	int err = 0;
+
+	// Node of the statement and its children. A statement that
+	// is none of the below is empty.
+	int self;
+	AstChildren children;
+	int child;
+	
+	// The statement is the one that its first token begins.
+	switch(tokenInfos[getCurrentTokenType(ctx)].statement)
+	{
+	// Statement that begins with an identifier symbol.
+	case AST_ASSIGN:
+	{
+		self = addNode(ctx, AST_ASSIGN, 0, -1, -1);
+		children = getAstChildren(self);
+		appendChild(ctx, &children, addReferenceNode(ctx));
+
+		// Get next token and check if it is a become symbol.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != becomessym)
+			return 7;
+		
+		// Get next token and pass to expression.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = expression(ctx, &child);
+		appendChild(ctx, &children, child);
+		break;
+	}
+
+	// Statement that begins with a call symbol.
+	case AST_CALL:
+	{
+		self = addNode(ctx, AST_CALL, 0, -1, -1);
+		children = getAstChildren(self);
+
+		// Get next token and check if it is an identifier.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != identsym)
+			return 8;
+		appendChild(ctx, &children, addReferenceNode(ctx));
+		
+		// Get next token.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		break;
+	}
+
+	// Statement that begins with begin symbol.
+	case AST_BEGIN:
+	{
+		self = addNode(ctx, AST_BEGIN, 0, -1, -1);
+		children = getAstChildren(self);
+
+		// Get next token and pass to statement.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = statement(ctx, &child);
+		if(err != 0)
+			return err;
+		appendChild(ctx, &children, child);
+		
+		while (getCurrentTokenType(ctx) == semicolonsym || isMissingSemicolon(ctx, 10, TC_STATEMENT_START))
+		{
+			// Get next token and pass to statement, unless the
+			// semicolon is missing.
+			if(getCurrentTokenType(ctx) == semicolonsym)
+			{
+				printCurrentToken(ctx);
+				nextToken(ctx);
+			}
+			err = statement(ctx, &child);
+			if(err != 0)
+				return err;
+			appendChild(ctx, &children, child);
+		}
+		
+		// Check for end symbol and get the next token.
+		if(getCurrentTokenType(ctx) != endsym)
+			return 10;
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		break;
+	}
+
+	// Statement that begins with if symbol.
+	case AST_IF:
+	{
+		self = addNode(ctx, AST_IF, 0, -1, -1);
+		children = getAstChildren(self);
+
+		// Get next token and pass to condition.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = condition(ctx, &child);
+		if(err != 0)
+			return err;
+		appendChild(ctx, &children, child);
+		
+		// Check the token is a then symbol.
+		if(getCurrentTokenType(ctx) != thensym)
+			return 9;
+		
+		// Get next token and pass to statement.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = statement(ctx, &child);
+		if(err != 0)
+			return err;
+		appendChild(ctx, &children, child);
+		
+		// Check for else statement. Get the next token and pass
+		// to statement if an else token is the current token.
+		if(getCurrentTokenType(ctx) == elsesym)
+		{
+			printCurrentToken(ctx);
+			nextToken(ctx);
+			err = statement(ctx, &child);
+			appendChild(ctx, &children, child);
+		}
+		break;
+	}
+
+	// Statement that begins with while symbol.
+	case AST_WHILE:
+	{
+		self = addNode(ctx, AST_WHILE, 0, -1, -1);
+		children = getAstChildren(self);
+
+		// Get next token and pass to condition.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = condition(ctx, &child);
+		if(err != 0)
+			return err;
+		appendChild(ctx, &children, child);
+		
+		// Check the token is a do symbol.
+		if(getCurrentTokenType(ctx) != dosym)
+			return 11;
+		
+		// Get next token and pass to statement.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = statement(ctx, &child);
+		appendChild(ctx, &children, child);
+		break;
+	}
+
+	// Statement that begins with write symbol.
+	case AST_WRITE:
+	{
+		self = addNode(ctx, AST_WRITE, 0, -1, -1);
+		children = getAstChildren(self);
+
+		// Get next token and check if its an identifier.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != identsym)
+			return 3;
+		appendChild(ctx, &children, addReferenceNode(ctx));
+		
+		// Get next token.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		break;
+	}
+
+	// Statement that begins with read symbol.
+	case AST_READ:
+	{
+		self = addNode(ctx, AST_READ, 0, -1, -1);
+		children = getAstChildren(self);
+
+		// Get next token and check if its an identifier.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		if(getCurrentTokenType(ctx) != identsym)
+			return 3;
+		appendChild(ctx, &children, addReferenceNode(ctx));
+		
+		// Get next token.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		break;
+	}
+
+	default:
+		self = addNode(ctx, AST_EMPTY, 0, -1, -1);
+		break;
+	}
+
+	if(!err)
+		*node = self;
+
+    return err;
+}
+
+static int condition(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, CONDITION);
+
+    int err = parseCondition(ctx, node);
+
+    if(err != 0)
+        err = recoverFromError(ctx, err, TC_CONDITION_FOLLOW);
+
+    return err;
+}
+
+static int parseCondition(ParserContext* ctx, int* node)
+{
+    printNonTerminal(ctx, CONDITION);
+
+    *node = -1;
+	
+	// Error variable for tracking errors.
+	int err = 0;
+
+	int self;
+	AstChildren children;
+	int child;
+	
+	// Check if the condition begins with an odd symbol.
+    if(getCurrentTokenType(ctx) == oddsym)
+	{
+		self = addNode(ctx, AST_ODD, 0, -1, -1);
+		children = getAstChildren(self);
+
+		// Get next token and pass to expression.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = expression(ctx, &child);
+		appendChild(ctx, &children, child);
+	}
+	else
+	{
+		int lhs;
+		err = expression(ctx, &lhs);
+		if(err != 0)
+			return err;
+		
+		// Check if the current token is a relation symbol.
+		int op = relop(ctx);
+		if(getCurrentTokenType(ctx) != op)
+			return 12;
+
+		self = addNode(ctx, AST_RELATION, op, -1, -1);
+		children = getAstChildren(self);
+		appendChild(ctx, &children, lhs);
+		
+		// Get next token and pass to expression.
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = expression(ctx, &child);
+		appendChild(ctx, &children, child);
+	}
+
+	if(!err)
+		*node = self;
+
+    return err;
+}
+
+static int relop(ParserContext* ctx)
+{
+    STATS_ENTER(ctx, REL_OP);
+
+    printNonTerminal(ctx, REL_OP);
+
+	// Check the current token against the class of the relation ops.
+	int type = getCurrentTokenType(ctx);
+
+    if(isTokenInClass(type, TC_RELATION))
+	   return type;
+	
+	// Failure to find relation operator.
+    return 0;
+}
+
+static int expression(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, EXPRESSION);
+
+    printNonTerminal(ctx, EXPRESSION);
+
+    *node = -1;
+
+	// Error variable for tracking error codes.
+	int err = 0;
+	
+	// Get the next token if the current is a plus or minus sign.
+	// A leading minus negates the first term.
+	int sign = getCurrentTokenType(ctx);
+    if(isTokenInClass(sign, TC_ADDING))
+	{
+		printCurrentToken(ctx);
+		nextToken(ctx);
+	}
+	else
+		sign = 0;
+	
+	int self;
+	err = term(ctx, &self);
+	if(err != 0)
+		return err;
+
+	if(sign == minussym)
+		self = addOperatorNode(ctx, AST_NEGATE, minussym, self, -2);
+	
+	// Continue parsing until the end of the expression.
+	int op;
+	while(isTokenInClass(op = getCurrentTokenType(ctx), TC_ADDING))
+	{
+		int rhs;
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = term(ctx, &rhs);
+		if(err != 0)
+			return err;
+		self = addOperatorNode(ctx, AST_BINARY, op, self, rhs);
+	}
+
+	if(!err)
+		*node = self;
+
+    return err;
+}
+
+static int term(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, TERM);
+
+    printNonTerminal(ctx, TERM);
+
+	// Error variable for tracking errors.
+	int err = 0;
+	
+	// The factors are joined from left to right.
+	int self;
+    err = factor(ctx, &self);
+	if(err != 0)
+		return err;
+	
+	// Continue parsing until the end of the term expression.
+	int op;
+	while(isTokenInClass(op = getCurrentTokenType(ctx), TC_MULTIPLYING))
+	{
+		int rhs;
+		printCurrentToken(ctx);
+		nextToken(ctx);
+		err = factor(ctx, &rhs);
+		if(err != 0)
+			return err;
+		self = addOperatorNode(ctx, AST_BINARY, op, self, rhs);
+	}
+
+	*node = self;
+
+    return 0;
+}
+
+/**
+ * The below function is left fully-implemented as a hint.
+ * */
+static int factor(ParserContext* ctx, int* node)
+{
+    STATS_ENTER(ctx, FACTOR);
+
+    printNonTerminal(ctx, FACTOR);
+
+    *node = -1;
+
+    /**
+     * There are three possibilities for factor:
+     * 1) ident
+     * 2) number
+     * 3) '(' expression ')'
+     * */
+
+    // Is the current token a identsym?
+    if(getCurrentTokenType(ctx) == identsym)
+    {
+        *node = addReferenceNode(ctx);
+
+        // Consume identsym
+        printCurrentToken(ctx); // Printing the token is essential!
+        nextToken(ctx); // Go to the next token..
+
+        // Success
+        return 0;
+    }
+    // Is that a numbersym?
+    else if(getCurrentTokenType(ctx) == numbersym)
+    {
+        if(VARIANT_BUILDS_AST)
+            *node = addNode(ctx, AST_NUMBER, 0, atoi(getCurrentLexeme(ctx)), -1);
+
+        // Consume numbersym
+        printCurrentToken(ctx); // Printing the token is essential!
+        nextToken(ctx); // Go to the next token..
+
+        // Success
+        return 0;
+    }
+    // Is that a lparentsym?
+    else if(getCurrentTokenType(ctx) == lparentsym)
+    {
+        // Consume lparentsym
+        printCurrentToken(ctx); // Printing the token is essential!
+        nextToken(ctx); // Go to the next token..
+
+        // Continue by parsing expression.
+        int inner;
+        int err = expression(ctx, &inner);
+
+        /**
+         * If parsing of expression was not successful, immediately stop parsing
+         * and propagate the same error code by returning it.
+         * */
+        
+        if(err) return err;
+
+        // After expression, right-parenthesis should come
+        if(getCurrentTokenType(ctx) != rparentsym)
+        {
+            /**
+             * Error code 13: Right parenthesis missing.
+             * Stop parsing and return error code 13.
+             * */
+            return 13;
+        }
+
+        // It was a rparentsym. Consume rparentsym.
+        printCurrentToken(ctx); // Printing the token is essential!
+        nextToken(ctx); // Go to the next token..
+
+        // Parentheses only group, they get no node of their own
+        *node = inner;
+    }
+    else
+    {
+        /**
+          * Error code 24: The preceding factor cannot begin with this symbol.
+          * Stop parsing and return error code 24.
+          * */
+        return 14;
+    }
+
+    return 0;
+}
+
+#undef printCurrentToken
+#undef printNonTerminal
+#undef addNode
+#undef appendChild
+#undef addReferenceNode
+#undef addOperatorNode
+#undef setNodeTokens
+
+#undef program
+#undef block
+#undef const_declaration
+#undef var_declaration
+#undef proc_declaration
+#undef parseProcedure
+#undef statement
+#undef parseStatement
+#undef condition
+#undef parseCondition
+#undef relop
+#undef expression
+#undef term
+#undef factor
+
+#undef PARSER_VARIANT
+#undef VARIANT_TRACES
+#undef VARIANT_BUILDS_AST
@@ -0,0 +1,245 @@
+#include "intern.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Capacities of the first allocations made by the pool
+#define INTERN_POOL_MIN_CAPACITY 64
+#define INTERN_POOL_MIN_CHARS 512
+
+void initInternPool(InternPool* pool, Arena* arena)
+{
+    pool->chars = NULL;
+    pool->length = 0;
+    pool->charsCapacity = 0;
+
+    pool->offsets = NULL;
+    pool->numberOfStrings = 0;
+    pool->capacity = 0;
+
+    pool->slots = NULL;
+    pool->numberOfSlots = 0;
+
+    pool->readOnly = 0;
+
+    pool->arena = arena;
+}
+
+void initReadOnlyInternPool(InternPool* pool, const char* chars, const uint32_t* offsets, int numberOfStrings)
+{
+    initInternPool(pool, NULL);
+
+    pool->chars = (char*)chars;
+    pool->offsets = (uint32_t*)offsets;
+    pool->numberOfStrings = numberOfStrings;
+    pool->length = offsets[numberOfStrings];
+    pool->readOnly = 1;
+}
+
+void deleteInternPool(InternPool* pool)
+{
+    if(!pool) return;
+
+    if(!pool->readOnly)
+    {
+        arenaFree(pool->arena, pool->chars);
+        arenaFree(pool->arena, pool->offsets);
+    }
+
+    arenaFree(pool->arena, pool->slots);
+
+    initInternPool(pool, pool->arena);
+}
+
+/**
+ * FNV-1a hash of the given characters.
+ * */
+static unsigned int hashString(const char* str, size_t length)
+{
+    unsigned int hash = 2166136261u;
+
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Returns the id of the given string by comparing it with every string in
+ * .. the pool, or -1 if it is not in the pool. Used by read only pools,
+ * .. which have no hash index.
+ * */
+static int findStringLinear(const InternPool* pool, const char* str, size_t length)
+{
+    for(int id = 0; id < pool->numberOfStrings; id++)
+    {
+        if(getInternedStringLength(pool, id) == length && memcmp(getInternedString(pool, id), str, length) == 0)
+            return id;
+    }
+
+    return -1;
+}
+
+/**
+ * Returns the slot of the given string, which holds either its id or -1 if
+ * .. the string is not in the pool. The pool should have a hash index.
+ * */
+static int* findSlot(const InternPool* pool, const char* str, size_t length, unsigned int hash)
+{
+    unsigned int mask = pool->numberOfSlots - 1;
+
+    for(unsigned int i = hash & mask; ; i = (i + 1) & mask)
+    {
+        int id = pool->slots[i];
+
+        if(id < 0 ||
+           (getInternedStringLength(pool, id) == length && memcmp(getInternedString(pool, id), str, length) == 0))
+            return &pool->slots[i];
+    }
+}
+
+/**
+ * Rebuilds the hash index with the given number of slots, which should be a
+ * .. power of two larger than twice the number of strings.
+ * Returns 0 if the allocation failed.
+ * */
+static int rebuildSlots(InternPool* pool, int numberOfSlots)
+{
+    int* slots = (int*)arenaRealloc(pool->arena, NULL, 0, numberOfSlots * sizeof(int));
+
+    if(!slots) return 0;
+
+    for(int i = 0; i < numberOfSlots; i++)
+        slots[i] = -1;
+
+    arenaFree(pool->arena, pool->slots);
+
+    pool->slots = slots;
+    pool->numberOfSlots = numberOfSlots;
+
+    for(int id = 0; id < pool->numberOfStrings; id++)
+    {
+        const char* str = getInternedString(pool, id);
+        size_t length = getInternedStringLength(pool, id);
+
+        *findSlot(pool, str, length, hashString(str, length)) = id;
+    }
+
+    return 1;
+}
+
+int copyInternPool(InternPool* dst, const InternPool* src)
+{
+    if(!src->numberOfStrings) return 0;
+
+    dst->chars = (char*)arenaRealloc(dst->arena, NULL, 0, src->length);
+    dst->offsets = (uint32_t*)arenaRealloc(dst->arena, NULL, 0, (src->numberOfStrings + 1) * sizeof(uint32_t));
+
+    int numberOfSlots = INTERN_POOL_MIN_CAPACITY;
+
+    while(numberOfSlots <= src->numberOfStrings * 2)
+        numberOfSlots *= 2;
+
+    if(!dst->chars || !dst->offsets)
+    {
+        deleteInternPool(dst);
+        return -1;
+    }
+
+    memcpy(dst->chars, src->chars, src->length);
+    memcpy(dst->offsets, src->offsets, (src->numberOfStrings + 1) * sizeof(uint32_t));
+
+    dst->length = dst->charsCapacity = src->length;
+    dst->numberOfStrings = src->numberOfStrings;
+
+    // The offsets end with the end offset of the last string
+    dst->capacity = src->numberOfStrings + 1;
+
+    if(!rebuildSlots(dst, numberOfSlots))
+    {
+        deleteInternPool(dst);
+        return -1;
+    }
+
+    return 0;
+}
+
+int internString(InternPool* pool, const char* str, size_t length)
+{
+    unsigned int hash = hashString(str, length);
+
+    if(pool->numberOfSlots)
+    {
+        int id = *findSlot(pool, str, length, hash);
+
+        if(id >= 0) return id;
+    }
+    else if(pool->readOnly)
+    {
+        return findStringLinear(pool, str, length);
+    }
+
+    if(pool->readOnly) return -1;
+
+    // Grow the offsets, keeping room for the end offset
+    if(pool->numberOfStrings + 1 >= pool->capacity)
+    {
+        int capacity = pool->capacity ? pool->capacity * 2 : INTERN_POOL_MIN_CAPACITY;
+
+        uint32_t* offsets = (uint32_t*)arenaRealloc(pool->arena, pool->offsets,
+                                                    pool->capacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+
+        if(!offsets) return -1;
+
+        // The end offset of an empty pool
+        if(!pool->offsets) offsets[0] = 0;
+
+        pool->offsets = offsets;
+        pool->capacity = capacity;
+    }
+
+    if(pool->length + length + 1 > pool->charsCapacity)
+    {
+        size_t charsCapacity = pool->charsCapacity ? pool->charsCapacity * 2 : INTERN_POOL_MIN_CHARS;
+
+        while(charsCapacity < pool->length + length + 1)
+            charsCapacity *= 2;
+
+        char* chars = (char*)arenaRealloc(pool->arena, pool->chars, pool->charsCapacity, charsCapacity);
+
+        if(!chars) return -1;
+
+        pool->chars = chars;
+        pool->charsCapacity = charsCapacity;
+    }
+
+    // Keep the load factor of the hash index below 1/2
+    if((pool->numberOfStrings + 1) * 2 > pool->numberOfSlots &&
+       !rebuildSlots(pool, pool->numberOfSlots ? pool->numberOfSlots * 2 : INTERN_POOL_MIN_CAPACITY))
+        return -1;
+
+    int id = pool->numberOfStrings++;
+
+    memcpy(pool->chars + pool->length, str, length);
+    pool->chars[pool->length + length] = '\0';
+    pool->length += length + 1;
+    pool->offsets[id + 1] = (uint32_t)pool->length;
+
+    *findSlot(pool, str, length, hash) = id;
+
+    return id;
+}
+
+int findInternedString(const InternPool* pool, const char* str)
+{
+    if(!pool || !str) return -1;
+
+    size_t length = strlen(str);
+
+    if(pool->numberOfSlots)
+        return *findSlot(pool, str, length, hashString(str, length));
+
+    return findStringLinear(pool, str, length);
+}
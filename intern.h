@@ -0,0 +1,97 @@
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/**
+ * String interner. Each distinct string added to the pool is stored once and
+ * .. identified by a small integer id, given in the order of addition.
+ * Two interned strings are equal if and only if their ids are equal.
+ *
+ * The strings are stored null terminated and back to back in chars. The
+ * .. string with id i starts at offsets[i], and offsets[numberOfStrings] is
+ * .. the end of the last string.
+ * slots is the open addressing hash index from strings to their ids, with
+ * .. -1 marking the empty slots.
+ *
+ * A read only pool refers to the memory of someone else, such as a memory
+ * .. mapped binary token list, and has no hash index. Nothing can be added
+ * .. to it.
+ * If arena is not NULL, the pool allocates from it instead of the heap.
+ * */
+typedef struct {
+    char* chars;
+    size_t length;
+    size_t charsCapacity;
+
+    uint32_t* offsets;
+    int numberOfStrings;
+    int capacity;
+
+    int* slots;
+    int numberOfSlots;
+
+    int readOnly;
+
+    Arena* arena;
+} InternPool;
+
+/**
+ * Initializes the given pool to an empty pool, which allocates from the
+ * .. given arena, or from the heap if it is NULL.
+ * */
+void initInternPool(InternPool*, Arena*);
+
+/**
+ * Initializes the given pool as a read only view of the given number of
+ * .. strings, which are laid out the way InternPool stores them.
+ * */
+void initReadOnlyInternPool(InternPool*, const char* chars, const uint32_t* offsets, int numberOfStrings);
+
+/**
+ * Makes the necessary deallocations on the pool.
+ * */
+void deleteInternPool(InternPool*);
+
+/**
+ * Makes the given empty pool a copy of the given source pool, which may be
+ * .. read only. The copy is never read only, and allocates from the arena of
+ * .. the given pool.
+ * Returns 0 on success, -1 if an allocation failed.
+ * */
+int copyInternPool(InternPool*, const InternPool*);
+
+/**
+ * Returns the id of the string made of the given number of characters,
+ * .. adding it to the pool if needed. The characters do not have to be null
+ * .. terminated.
+ * Returns -1 if the pool is read only and does not contain the string, or
+ * .. if an allocation failed.
+ * */
+int internString(InternPool*, const char*, size_t);
+
+/**
+ * Returns the id of the given null terminated string, or -1 if it is not
+ * .. in the pool.
+ * */
+int findInternedString(const InternPool*, const char*);
+
+/**
+ * Returns the string with the given id. The id should be valid.
+ * */
+static inline const char* getInternedString(const InternPool* pool, int id)
+{
+    return pool->chars + pool->offsets[id];
+}
+
+/**
+ * Returns the length of the string with the given id. The id should be valid.
+ * */
+static inline size_t getInternedStringLength(const InternPool* pool, int id)
+{
+    return pool->offsets[id + 1] - pool->offsets[id] - 1;
+}
+
+#endif
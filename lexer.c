@@ -0,0 +1,437 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "lexer.h"
+#include "data.h"
+#include "scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Size of each read from the streams that cannot be memory mapped
+#define SOURCE_READ_SIZE 4096
+
+/**
+ * Classes of the characters, which are the input alphabet of the DFA.
+ * The classes from CHAR_SLASH on may begin symbols of two characters.
+ * */
+typedef enum {
+    CHAR_OTHER, CHAR_SPACE, CHAR_LETTER, CHAR_DIGIT, CHAR_SYMBOL,
+    CHAR_SLASH, CHAR_COLON, CHAR_LESS, CHAR_GREATER
+} CharClass;
+
+static unsigned char charClasses[256];
+static pthread_once_t charClassesOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Token of each single character symbol, 0 if the character is not one
+ * */
+static const unsigned char symbolTokens[256] = {
+    ['+'] = plussym, ['-'] = minussym, ['*'] = multsym, ['/'] = slashsym,
+    ['('] = lparentsym, [')'] = rparentsym, ['='] = eqsym, [','] = commasym,
+    ['.'] = periodsym, [';'] = semicolonsym, ['<'] = lessym, ['>'] = gtrsym
+};
+
+/**
+ * Reserved words, at the slots given by hashKeyword(). No two of them have
+ * .. the same slot, so a lookup compares at most one word.
+ * */
+#define KEYWORD_SLOTS 16
+#define MIN_KEYWORD_LENGTH 2
+#define MAX_KEYWORD_LENGTH 9
+
+typedef struct {
+    const char* word;
+    int token;
+} Keyword;
+
+static const Keyword keywords[KEYWORD_SLOTS] = {
+    [0]  = { "if", ifsym },          [1]  = { "procedure", procsym },
+    [2]  = { "else", elsesym },      [3]  = { "const", constsym },
+    [4]  = { "read", readsym },      [5]  = { "begin", beginsym },
+    [6]  = { "do", dosym },          [7]  = { "write", writesym },
+    [9]  = { "end", endsym },        [10] = { "call", callsym },
+    [11] = { "var", varsym },        [12] = { "then", thensym },
+    [13] = { "odd", oddsym },        [15] = { "while", whilesym }
+};
+
+/**
+ * Perfect hash of the reserved words, the given word should have at least 2
+ * .. characters.
+ * */
+static inline unsigned hashKeyword(const char* word, size_t length)
+{
+    return (unsigned)(length + 6 * (unsigned char)word[0] + 4 * (unsigned char)word[1]) & (KEYWORD_SLOTS - 1);
+}
+
+/**
+ * Returns the token of the given identifier, which is either a reserved word
+ * .. token or identsym.
+ * */
+static inline int classifyWord(const char* word, size_t length)
+{
+    if(length < MIN_KEYWORD_LENGTH || length > MAX_KEYWORD_LENGTH)
+        return identsym;
+
+    const Keyword* keyword = &keywords[hashKeyword(word, length)];
+
+    if(keyword->word && strncmp(keyword->word, word, length) == 0 && keyword->word[length] == '\0')
+        return keyword->token;
+
+    return identsym;
+}
+
+static void initCharClasses()
+{
+    for(int c = 0; c < 256; c++)
+    {
+        unsigned char charClass = CHAR_OTHER;
+
+        if(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f')
+            charClass = CHAR_SPACE;
+        else if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+            charClass = CHAR_LETTER;
+        else if(c >= '0' && c <= '9')
+            charClass = CHAR_DIGIT;
+        else if(c == '/')
+            charClass = CHAR_SLASH;
+        else if(c == ':')
+            charClass = CHAR_COLON;
+        else if(c == '<')
+            charClass = CHAR_LESS;
+        else if(c == '>')
+            charClass = CHAR_GREATER;
+        else if(symbolTokens[c])
+            charClass = CHAR_SYMBOL;
+
+        charClasses[c] = charClass;
+    }
+}
+
+/**
+ * Adds a token with the given lexeme to the given chunk, which is not full
+ * */
+static inline void addChunkToken(TokenChunk* chunk, int id, const char* lexeme, size_t length)
+{
+    int n = chunk->numberOfTokens++;
+
+    chunk->ids[n] = (unsigned char)id;
+    chunk->lengths[n] = (unsigned char)length;
+    memcpy(chunk->lexemes[n], lexeme, length);
+}
+
+/**
+ * Ends the given chunk with the given lexer error code
+ * */
+static inline void endChunk(TokenChunk* chunk, int err)
+{
+    chunk->end = 1;
+    chunk->err = err;
+}
+
+void initLexer(Lexer* lexer)
+{
+    lexer->inComment = 0;
+}
+
+size_t lexChunk(Lexer* lexer, const char* source, size_t length, int atEnd, TokenChunk* chunk)
+{
+    pthread_once(&charClassesOnce, initCharClasses);
+
+    const ScanKernels* kernels = getScanKernels();
+
+    const char* p = source;
+    const char* end = source + length;
+
+    while(!chunk->end)
+    {
+        if(lexer->inComment)
+        {
+            // Skip till the closing "*" "/", which may be split between calls
+            while(p + 1 < end && !(p[0] == '*' && p[1] == '/'))
+            {
+                const char* star = memchr(p + 1, '*', end - p - 1);
+
+                p = star ? star : end - 1;
+            }
+
+            if(p + 1 < end)
+            {
+                p += 2;
+                lexer->inComment = 0;
+                continue;
+            }
+
+            if(atEnd)
+            {
+                p = end;
+                endChunk(chunk, 5);
+            }
+
+            break;
+        }
+
+        if(p == end)
+        {
+            if(atEnd) endChunk(chunk, 0);
+            break;
+        }
+
+        if(chunk->numberOfTokens == TOKEN_CHUNK_SIZE)
+            break;
+
+        const char* start = p;
+        int charClass = charClasses[(unsigned char)*p];
+
+        // Symbols of two characters need to see the next character
+        int hasNext = p + 1 < end;
+
+        if(!hasNext && !atEnd && charClass >= CHAR_SLASH)
+            break;
+
+        switch(charClass)
+        {
+        case CHAR_SPACE:
+            // Most runs are a single separator, which is not worth a block
+            if(hasNext && charClasses[(unsigned char)p[1]] == CHAR_SPACE)
+                p += kernels->space(p, end);
+            else
+                p++;
+            break;
+
+        case CHAR_LETTER:
+            // A run longer than the limit is an error whatever follows it
+            p += scanIdentifierRun(p, end, MAX_IDENTIFIER_LENGTH + 1);
+
+            if(p - start > MAX_IDENTIFIER_LENGTH)
+            {
+                endChunk(chunk, 3);
+                break;
+            }
+
+            if(p == end && !atEnd)
+            {
+                p = start;
+                return p - source;
+            }
+
+            addChunkToken(chunk, classifyWord(start, p - start), start, p - start);
+            break;
+
+        case CHAR_DIGIT:
+            p += kernels->digit(p, end);
+
+            if(p == end && !atEnd)
+            {
+                p = start;
+                return p - source;
+            }
+
+            if(p < end && charClasses[(unsigned char)*p] == CHAR_LETTER)
+            {
+                endChunk(chunk, 1);
+                break;
+            }
+
+            if(p - start > MAX_NUMBER_LENGTH)
+            {
+                endChunk(chunk, 2);
+                break;
+            }
+
+            addChunkToken(chunk, numbersym, start, p - start);
+            break;
+
+        case CHAR_SLASH:
+            if(hasNext && p[1] == '*')
+            {
+                p += 2;
+                lexer->inComment = 1;
+                break;
+            }
+
+            addChunkToken(chunk, slashsym, p++, 1);
+            break;
+
+        case CHAR_COLON:
+            if(hasNext && p[1] == '=')
+            {
+                addChunkToken(chunk, becomessym, p, 2);
+                p += 2;
+                break;
+            }
+
+            endChunk(chunk, 4);
+            break;
+
+        case CHAR_LESS:
+            if(hasNext && (p[1] == '=' || p[1] == '>'))
+            {
+                addChunkToken(chunk, p[1] == '=' ? leqsym : neqsym, p, 2);
+                p += 2;
+                break;
+            }
+
+            addChunkToken(chunk, lessym, p++, 1);
+            break;
+
+        case CHAR_GREATER:
+            if(hasNext && p[1] == '=')
+            {
+                addChunkToken(chunk, geqsym, p, 2);
+                p += 2;
+                break;
+            }
+
+            addChunkToken(chunk, gtrsym, p++, 1);
+            break;
+
+        case CHAR_SYMBOL:
+            addChunkToken(chunk, symbolTokens[(unsigned char)*p], p, 1);
+            p++;
+            break;
+
+        default:
+            endChunk(chunk, 4);
+            break;
+        }
+    }
+
+    return p - source;
+}
+
+int lexSource(const char* source, size_t length, TokenList* tokenList)
+{
+    TokenChunk* chunk = arenaRealloc(tokenList->arena, NULL, 0, sizeof(TokenChunk));
+    if(!chunk) return LEXER_MEMORY_ERROR;
+
+    // Each token takes at least a character, and most are followed by a
+    // .. separator, so half of the length is a good first guess
+    reserveTokenList(tokenList, (int)(length / 2) + 1);
+
+    Lexer lexer;
+    initLexer(&lexer);
+
+    chunk->end = 0;
+    chunk->err = 0;
+
+    while(!chunk->end)
+    {
+        chunk->numberOfTokens = 0;
+
+        size_t consumed = lexChunk(&lexer, source, length, 1, chunk);
+
+        source += consumed;
+        length -= consumed;
+
+        addTokenChunk(tokenList, chunk);
+    }
+
+    int err = chunk->err;
+
+    arenaFree(tokenList->arena, chunk);
+
+    return err;
+}
+
+TokenList readSourceTokenList(FILE* in, Arena* arena, int* err)
+{
+    TokenList tokenList;
+
+    initTokenListInArena(&tokenList, arena);
+
+    *err = 0;
+
+    if(!in) return tokenList;
+
+    // Regular files are lexed right from the memory mapped file
+    struct stat st;
+
+    long start = ftell(in);
+
+    if(start >= 0 && fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode))
+    {
+        if(st.st_size <= start)
+            return tokenList;
+
+        size_t size = (size_t)st.st_size;
+
+        char* base = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+
+        if(base != MAP_FAILED)
+        {
+            *err = lexSource(base + start, size - start, &tokenList);
+
+            fseek(in, 0, SEEK_END);
+
+            munmap(base, size);
+
+            return tokenList;
+        }
+    }
+
+    // Other streams are read till the end first
+    char* source = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+
+    for(;;)
+    {
+        if(capacity - length < SOURCE_READ_SIZE)
+        {
+            size_t newCapacity = capacity ? capacity * 2 : SOURCE_READ_SIZE;
+
+            char* newSource = arenaRealloc(arena, source, capacity, newCapacity);
+            if(!newSource)
+            {
+                arenaFree(arena, source);
+                *err = LEXER_MEMORY_ERROR;
+                return tokenList;
+            }
+
+            source = newSource;
+            capacity = newCapacity;
+        }
+
+        size_t read = fread(source + length, 1, capacity - length, in);
+
+        if(read == 0) break;
+
+        length += read;
+    }
+
+    *err = lexSource(source, length, &tokenList);
+
+    arenaFree(arena, source);
+
+    return tokenList;
+}
+
+int isPL0Source(FILE* in)
+{
+    if(!in) return 0;
+
+    long start = ftell(in);
+
+    if(start < 0) return 0;
+
+    char header[sizeof(TOKEN_LIST_HEADER) - 1];
+
+    size_t read = fread(header, 1, sizeof(header), in);
+
+    fseek(in, start, SEEK_SET);
+
+    // Empty files are left to the token list reader, which reads no tokens
+    if(read == 0) return 0;
+
+    return read < sizeof(header) || memcmp(header, TOKEN_LIST_HEADER, sizeof(header)) != 0;
+}
+
+void printLexerErrToSink(int errCode, Sink* sink)
+{
+    if(!sink || !errCode) return;
+
+    printfSink(sink, "\nLEXER ERROR[%d]: %s.\n", errCode, lexerErrorMsg[errCode]);
+}
@@ -0,0 +1,73 @@
+#ifndef __LEXER_H__
+#define __LEXER_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include "token.h"
+#include "arena.h"
+#include "sink.h"
+
+// Numbers and identifiers longer than these are lexer errors
+#define MAX_NUMBER_LENGTH 5
+#define MAX_IDENTIFIER_LENGTH MAX_LEXEME_LENGTH
+
+// Lexer error code of source that could not be lexed for want of memory
+#define LEXER_MEMORY_ERROR 6
+
+/**
+ * State of a lexer that is given the source piece by piece
+ * inComment : not 0 if the last piece ended inside a comment
+ * */
+typedef struct {
+    int inComment;
+} Lexer;
+
+/**
+ * Initializes the given lexer to lex from the beginning of some source
+ * */
+void initLexer(Lexer*);
+
+/**
+ * Lexes the given number of characters, which is the next piece of the source
+ * .. of the given lexer, into the given chunk. Stops when the chunk is full or
+ * .. a token may continue after the given characters, unless atEnd is not 0,
+ * .. in which case the given characters are the last ones.
+ * Ends the chunk at the end of the source or at a lexer error, whose code is
+ * .. stored in err of the chunk.
+ * Returns the number of the characters consumed.
+ * */
+size_t lexChunk(Lexer*, const char*, size_t, int atEnd, TokenChunk*);
+
+/**
+ * Lexes the given number of characters of PL/0 source and adds the tokens to
+ * .. the given TokenList, which should not be read only.
+ * Comments, which are written as in C, and whitespace are skipped.
+ * Returns 0 on success. Otherwise, returns a non-zero lexer error code and
+ * .. the list holds the tokens before the error, if any. LEXER_MEMORY_ERROR
+ * .. is returned if the source could not be lexed at all.
+ * */
+int lexSource(const char* source, size_t length, TokenList*);
+
+/**
+ * Reads PL/0 source from the given file, starting from its current
+ * .. position, and lexes it into a token list allocated from the given arena.
+ * The lexer error code, which is 0 on success, is stored in err.
+ * Regular files are memory mapped, other streams are read till the end.
+ * */
+TokenList readSourceTokenList(FILE*, Arena*, int* err);
+
+/**
+ * Checks whether the given file, starting from its current position, is PL/0
+ * .. source rather than a token list, which starts with the header that
+ * .. printTokenList() writes. The position of the file is not changed.
+ * Streams that cannot seek, such as pipes, are never considered source.
+ * */
+int isPL0Source(FILE*);
+
+/**
+ * Given the lexer error code, writes the error message on the given sink by
+ * .. applying the same formatting as printParserErr().
+ * */
+void printLexerErrToSink(int errCode, Sink*);
+
+#endif
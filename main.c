@@ -1,64 +1,253 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include "token.h"
+#include "arena.h"
 #include "parser.h"
+#include "batch.h"
+#include "cache.h"
+#include "server.h"
 
 int main(int argc, char **argv)
 {
-    FILE *inp, *outp;
-
     /**********************************/
     /* Parsing Command Line Arguments */
     /**********************************/
-    if(argc != 3)
+    // Optional flags come before the paths
+    ParseOptions options;
+    options.mode = PARSER_TRACE;
+    options.toBinary = 0;
+    options.stream = 0;
+    options.streamMode = TOKEN_STREAM_INLINE;
+    options.ast = 0;
+    options.fold = 0;
+    options.code = 0;
+    options.run = 0;
+    options.recover = 0;
+    options.iterative = 0;
+    options.maxDepth = 0;
+    options.maxStackSize = 0;
+    options.stats = 0;
+    options.parallel = 0;
+    options.symbolFormat = SYMBOL_TABLE_TEXT;
+    options.exportSymbols = 0;
+    options.cache = NULL;
+
+    const char* cacheDir = NULL;
+    size_t cacheSize = 0;
+
+    const char* manifestPath = NULL;
+    const char* serveSocket = NULL;
+    const char* connectSocket = NULL;
+    int numberOfWorkers = 0;
+
+    int argInd = 1;
+    int usageErr = 0;
+
+    for(; argInd < argc && argv[argInd][0] == '-'; argInd++)
     {
-        fprintf(stderr, "Usage: parser.out (pl0_lexer_out) (parser_output_file)\n");
+        if(strcmp(argv[argInd], "--to-binary") == 0)
+            options.toBinary = 1;
+        else if(strcmp(argv[argInd], "-q") == 0 || strcmp(argv[argInd], "--quiet") == 0)
+            options.mode = PARSER_QUIET;
+        else if(strcmp(argv[argInd], "--stream") == 0)
+            options.stream = 1;
+        else if(strcmp(argv[argInd], "--stream-threaded") == 0)
+        {
+            options.stream = 1;
+            options.streamMode = TOKEN_STREAM_THREADED;
+        }
+        else if(strcmp(argv[argInd], "--ast") == 0)
+        {
+            // The tree takes the place of the parsing history
+            options.ast = 1;
+            options.mode = PARSER_QUIET;
+        }
+        else if(strcmp(argv[argInd], "--fold") == 0)
+            options.fold = 1;
+        else if(strcmp(argv[argInd], "--code") == 0)
+            options.code = 1;
+        else if(strcmp(argv[argInd], "--run") == 0)
+            options.run = 1;
+        else if(strcmp(argv[argInd], "--recover") == 0)
+            options.recover = 1;
+        else if(strcmp(argv[argInd], "--iterative") == 0)
+            options.iterative = 1;
+        else if(strcmp(argv[argInd], "--max-depth") == 0 && argInd + 1 < argc)
+        {
+            char* end;
+            long maxDepth = strtol(argv[++argInd], &end, 10);
+            if(*end || maxDepth <= 0 || maxDepth > INT_MAX) usageErr = 1;
 
-        fprintf(stderr, "\n       pl0_lexer_out: The path to the file containing the lexer out for the programming language PL/0.\n");
+            options.iterative = 1;
+            options.maxDepth = (int)maxDepth;
+        }
+        else if(strcmp(argv[argInd], "--max-stack") == 0 && argInd + 1 < argc)
+        {
+            char* end;
+            unsigned long long maxStackSize = strtoull(argv[++argInd], &end, 10);
+            if(*end || maxStackSize == 0 || argv[argInd][0] == '-') usageErr = 1;
 
-        fprintf(stderr, "\n       parser_output_file: The path to the file to write the parser output, which contains the parsing history, the symbol table and the error message if applicable.\n");
-        return -1;
+            options.iterative = 1;
+            options.maxStackSize = (size_t)maxStackSize;
+        }
+        else if(strcmp(argv[argInd], "--stats") == 0)
+            options.stats = 1;
+        else if(strcmp(argv[argInd], "--parallel") == 0 && argInd + 1 < argc)
+        {
+            char* end;
+            long threads = strtol(argv[++argInd], &end, 10);
+            if(*end || threads <= 0 || threads > 1024) usageErr = 1;
+
+            options.parallel = (int)threads;
+        }
+        else if(strcmp(argv[argInd], "--symbols") == 0 && argInd + 1 < argc)
+        {
+            const char* format = argv[++argInd];
+
+            if(strcmp(format, "text") == 0)     options.symbolFormat = SYMBOL_TABLE_TEXT;
+            else if(strcmp(format, "tsv") == 0) options.symbolFormat = SYMBOL_TABLE_TSV;
+            else if(strcmp(format, "csv") == 0) options.symbolFormat = SYMBOL_TABLE_CSV;
+            else usageErr = 1;
+        }
+        else if(strcmp(argv[argInd], "--export-symbols") == 0)
+            options.exportSymbols = 1;
+        else if(strcmp(argv[argInd], "--cache") == 0 && argInd + 1 < argc)
+            cacheDir = argv[++argInd];
+        else if(strcmp(argv[argInd], "--cache-size") == 0 && argInd + 1 < argc)
+        {
+            char* end;
+            unsigned long long maxCacheSize = strtoull(argv[++argInd], &end, 10);
+            if(*end || maxCacheSize == 0 || argv[argInd][0] == '-') usageErr = 1;
+
+            cacheSize = (size_t)maxCacheSize;
+        }
+        else if(strcmp(argv[argInd], "--batch") == 0 && argInd + 1 < argc)
+            manifestPath = argv[++argInd];
+        else if(strcmp(argv[argInd], "--serve") == 0 && argInd + 1 < argc)
+            serveSocket = argv[++argInd];
+        else if(strcmp(argv[argInd], "--connect") == 0 && argInd + 1 < argc)
+            connectSocket = argv[++argInd];
+        else if(strcmp(argv[argInd], "-j") == 0 && argInd + 1 < argc)
+        {
+            char* end;
+            numberOfWorkers = (int)strtol(argv[++argInd], &end, 10);
+            if(*end || numberOfWorkers <= 0) usageErr = 1;
+        }
+        else
+            break;
     }
 
-    // open the input file for reading
-    if( !(inp = fopen(argv[1], "r")) )
+    // The batch mode takes its paths from the manifest
+    // The server takes its inputs from its clients, which cannot run the code,
+    // .. stream the tokens or export the symbols
+    int pathsGiven = manifestPath || serveSocket ? 0 : 2;
+
+    if((serveSocket || connectSocket) &&
+       (options.run || options.stream || options.exportSymbols || manifestPath || (serveSocket && connectSocket)))
+        usageErr = 1;
+
+    if(usageErr || argc - argInd != pathsGiven)
     {
-        fprintf(stderr, "Could not open \"%s\"\n", argv[1]);
+        fprintf(stderr, "Usage: parser.out [--to-binary] [-q|--quiet] [--recover] [--iterative [--max-depth (frames)] [--max-stack (bytes)]] [--ast] [--fold] [--code] [--run] [--stream|--stream-threaded] [--parallel (threads)] [--symbols (text|tsv|csv)] [--export-symbols] [--stats] [--cache (dir) [--cache-size (bytes)]] (pl0_lexer_out) (parser_output_file)\n");
+        fprintf(stderr, "       parser.out [--to-binary] [-q|--quiet] [--recover] [--iterative [--max-depth (frames)] [--max-stack (bytes)]] [--ast] [--fold] [--code] [--run] [--stream|--stream-threaded] [--parallel (threads)] [--symbols (text|tsv|csv)] [--export-symbols] [--stats] [--cache (dir) [--cache-size (bytes)]] --batch (manifest) [-j (workers)]\n");
+        fprintf(stderr, "       parser.out [--iterative [--max-depth (frames)] [--max-stack (bytes)]] [--parallel (threads)] [--stats] [--cache (dir) [--cache-size (bytes)]] --serve (socket) [-j (workers)]\n");
+        fprintf(stderr, "       parser.out [--to-binary] [-q|--quiet] [--recover] [--iterative] [--ast] [--fold] [--code] [--symbols (text|tsv|csv)] --connect (socket) (pl0_lexer_out) (parser_output_file)\n");
+
+        fprintf(stderr, "\n       pl0_lexer_out: The path to the file containing the lexer out for the programming language PL/0, either as text or in the binary token list format. Files that do not start with the token list header are lexed as PL/0 source.\n");
+
+        fprintf(stderr, "\n       parser_output_file: The path to the file to write the parser output, which contains the parsing history, the symbol table and the error message if applicable.\n");
+
+        fprintf(stderr, "\n       --to-binary: Instead of parsing, writes the token list to parser_output_file in the binary token list format.\n");
+
+        fprintf(stderr, "\n       -q, --quiet: Writes only the error message, or the success message, to parser_output_file.\n");
+
+        fprintf(stderr, "\n       --recover: Goes on parsing after a syntax error, and writes every error found, with the index of its token, instead of the first one.\n");
+
+        fprintf(stderr, "\n       --iterative: Parses on a stack of its own on the heap instead of recursing, so that deeply nested programs do not overflow the thread stack. The output is the same.\n");
+
+        fprintf(stderr, "\n       --max-depth, --max-stack: The most non-terminals --iterative may be in at once, and the most bytes its stack may take. Programs nested deeper fail with a parsing error. Both imply --iterative, and there is no limit by default.\n");
+
+        fprintf(stderr, "\n       --ast: Writes the abstract syntax tree of the program, instead of the parsing history, before the success message.\n");
+
+        fprintf(stderr, "\n       --fold: Folds the constant expressions and conditions of the tree of --ast and of the code, and prunes the branches they decide.\n");
+
+        fprintf(stderr, "\n       --code: Writes the P-machine code of the program after the success message.\n");
+
+        fprintf(stderr, "\n       --run: Runs the program after the success message, reading its input from stdin and writing its output to parser_output_file.\n");
+
+        fprintf(stderr, "\n       --stream: Streams the tokens to the parser in chunks instead of reading all of them first, so that the memory used does not grow with the input. Pipes of PL/0 source are recognized too.\n");
+
+        fprintf(stderr, "\n       --stream-threaded: Same as --stream, except that the tokens are produced on a separate thread, while parsing.\n");
+
+        fprintf(stderr, "\n       --parallel: Parses the top-level procedures of large programs on the given number of threads, and writes the same output as a serial parse. Only the parsing history and -q parses are parallel, without --recover, --iterative or --stream.\n");
+
+        fprintf(stderr, "\n       --symbols: The format of the symbol table. text, the default, is a block of lines per symbol. tsv and csv are a line of tab or comma separated \"index type name value level\" fields per symbol, after a line of the field names, where the value is empty unless the symbol is a CONST.\n");
+
+        fprintf(stderr, "\n       --export-symbols: Also writes the symbol table of a successful parse to parser_output_file" SYMBOL_TABLE_EXTENSION ", in the binary symbol table format of symbol.h that tools can memory map, and removes that file if the parse fails.\n");
+
+        fprintf(stderr, "\n       --stats: Writes the times of loading, parsing and writing each file, and its counters, as a line of JSON to stderr. The counters of the calls, the depth and the allocations are only there in builds with make STATS=1.\n");
+
+        fprintf(stderr, "\n       --cache: Keeps the output of each parse in the given directory, keyed by a hash of the tokens and the options, and writes it from there instead of parsing the same tokens again. Runs that stream the tokens, run the code or export the symbols are not cached.\n");
+
+        fprintf(stderr, "\n       --cache-size: The most bytes the entries of --cache may take, 256 MiB by default. The least recently used entries are removed once there are more.\n");
+
+        fprintf(stderr, "\n       --batch: Runs the parser on each \"pl0_lexer_out parser_output_file\" line of manifest, in the same format as test/tests.txt.\n");
+
+        fprintf(stderr, "\n       --serve: Serves the clients of the Unix socket at the given path till SIGINT or SIGTERM, each worker with a parser of its own that is kept across requests, so that each file is parsed without starting a process. The options of each request are the ones it was sent with, and the limits, --stats and --cache are the ones of the server. See server.h for the protocol.\n");
+
+        fprintf(stderr, "\n       --connect: Sends pl0_lexer_out to the server on the Unix socket at the given path, with the given options, and writes the output it sends back to parser_output_file.\n");
+
+        fprintf(stderr, "\n       -j: The number of worker threads of --batch or --serve. Defaults to the number of CPUs.\n");
         return -1;
     }
 
-    // open the output file for writing
-    if( !(outp = fopen(argv[2], "w")) )
+    // The cache is shared by all the files of the run
+    ParseCache cache;
+
+    if(cacheDir)
     {
-        fprintf(stderr, "Could not open \"%s\"\n", argv[2]);
+        if(openParseCache(&cache, cacheDir, cacheSize) != 0)
+        {
+            fprintf(stderr, "Could not open the cache \"%s\"\n", cacheDir);
+            return -1;
+        }
 
-        // Before terminating, close the input file
-        fclose(inp);
+        options.cache = &cache;
+    }
 
-        return -1;
-    }              
+    int ret;
 
-    /**********************************/
-    /**** Call to parser ****/
-    /**********************************/
-    // Read the token list
-    TokenList tokenList = readTokenList(inp);
-    
-    // Run parser
-    int err = parser(tokenList, outp);
+    if(manifestPath)
+    {
+        // Every file is parsed independently, failures are reported per file
+        ret = runBatch(manifestPath, numberOfWorkers, options) == 0 ? 0 : -1;
+    }
+    else if(serveSocket)
+        ret = runServer(serveSocket, numberOfWorkers, options);
+    else if(connectSocket)
+        ret = runClient(connectSocket, argv[argInd], argv[argInd + 1], options);
+    else
+    {
+        /**********************************/
+        /**** Call to parser ****/
+        /**********************************/
+        // Everything allocated for the parse comes from this arena and is
+        // .. freed at once after the parse
+        Arena arena;
+        initArena(&arena, 0);
 
-    // Print error - if there exists any
-    printParserErr(err, outp);
+        ParserContext ctx;
+        initParserContext(&ctx, options.mode);
 
-    // Delete token list created by readTokenList()
-    deleteTokenList(&tokenList);
+        ret = parseFile(argv[argInd], argv[argInd + 1], options, &arena, &ctx);
 
-    /**********************************/
-    /* Closing input and output files */
-    /**********************************/
+        deleteParserContext(&ctx);
+        deleteArena(&arena);
+    }
 
-    // close the input and the output file stream
-    if(inp) fclose(inp);
-    if(outp) fclose(outp);
+    if(options.cache) closeParseCache(options.cache);
 
-    return 0;
+    return ret;
 }
@@ -1,675 +1,2046 @@
 #include "token.h"
 #include "data.h"
 #include "symbol.h"
+#include "sink.h"
+#include "parser.h"
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
 
 /**
- * This pointer is set when by parser() func and used by printParsedToken() func.
+ * All the state of a parse lives in the ParserContext given to parser_ctx(),
+ * .. which is passed to every function below as ctx.
  * 
- * You are not required to use it anywhere. The implemented part of the skeleton
- * handles the printing. Instead, You could use the supplied helper functions to
- * manipulate the output file.
+ * It is better to use the given helper functions to make use of the token
+ * list iterator and the output sink of the context.
  * */
-FILE* _out;
 
 /**
- * Token list iterator used by the parser. It will be set once entered to parser()
- * and reset before exiting parser().
- * 
- * It is better to use the given helper functions to make use of token list iterator.
+ * Precomputed beginnings of the parsing history lines, which are built once
+ * .. per process by initHistoryLines(). A token line starts with
+ * .. "TOKEN  : <name, '" and a non-terminal line is the whole
+ * .. "NONTERM: NAME\n". They are only read once built, so all the parses
+ * .. share them.
  * */
-TokenListIterator _token_list_it;
+#define MAX_TOKEN_ID elsesym
+#define MAX_HISTORY_LINE_LENGTH 32
+
+typedef struct {
+    char text[MAX_HISTORY_LINE_LENGTH];
+    size_t length;
+} HistoryLine;
+
+HistoryLine tokenLinePrefixes[MAX_TOKEN_ID + 1];
+HistoryLine nonTerminalLines[FACTOR + 1];
+pthread_once_t historyLinesOnce = PTHREAD_ONCE_INIT;
 
 /**
- * Current level.
+ * Returns the current token using the token list iterator.
+ * If it is the end of tokens, returns token with id nulsym.
  * */
-unsigned int currentLevel;
+Token getCurrentToken(ParserContext* ctx);
 
 /**
- * Symbol table.
+ * Returns the type of the current token. Returns nulsym if it is the end of tokens.
+ * Peeks the id array of the token list, without copying the token.
  * */
-SymbolTable symbolTable;
+static inline int getCurrentTokenType(ParserContext* ctx);
 
 /**
- * Returns the current token using the token list iterator.
- * If it is the end of tokens, returns token with id nulsym.
+ * Returns the lexeme id of the current token, which should not be the end
+ * of tokens.
  * */
-Token getCurrentToken();
+static inline int getCurrentLexemeId(ParserContext* ctx);
 
 /**
- * Returns the type of the current token. Returns nulsym if it is the end of tokens.
+ * Returns the lexeme of the current token. Returns an empty string if it is
+ * the end of tokens.
+ * */
+const char* getCurrentLexeme(ParserContext* ctx);
+
+/**
+ * Prints the given token on the output sink by applying required formatting.
  * */
-int getCurrentTokenType();
+static inline void printCurrentToken(ParserContext* ctx);
 
 /**
- * Prints the given token on _out by applying required formatting.
+ * Builds the precomputed parsing history lines. Called once through
+ * historyLinesOnce.
  * */
-void printCurrentToken();
+void initHistoryLines();
 
 /**
  * Advances the position of TokenListIterator by incrementing the current token
  * index by one.
  * */
-void nextToken();
+static inline void nextToken(ParserContext* ctx);
 
 /**
  * Given an entry from non-terminal enumaration, prints it.
  * */
-void printNonTerminal(NonTerminal nonTerminal);
+static inline void printNonTerminal(ParserContext* ctx, NonTerminal nonTerminal);
 
 /**
- * Functions used for non-terminals of the grammar
+ * Counts a call of the function of the given non-terminal, and keeps track
+ * .. of the depth of the parse till the function returns. Compiled in only
+ * .. with PARSER_STATS, see stats.h, as the depth is kept by a cleanup
+ * .. function of the compiler.
  * */
-int program();
-int block();
-int const_declaration();
-int var_declaration();
-int proc_declaration();
-int statement();
-int condition();
-int relop();
-int expression();
-int term();
-int factor();
+#if PARSER_STATS_ENABLED
 
-Token getCurrentToken()
+static inline ParserContext* enterNonTerminal(ParserContext* ctx, NonTerminal nonTerminal)
 {
-    return getCurrentTokenFromIterator(_token_list_it);
+    ctx->stats.calls[nonTerminal]++;
+
+    if(++ctx->stats.depth > ctx->stats.maxDepth)
+        ctx->stats.maxDepth = ctx->stats.depth;
+
+    return ctx;
 }
 
-int getCurrentTokenType()
+static inline void leaveNonTerminal(ParserContext** ctx)
 {
-    return getCurrentToken().id;
+    (*ctx)->stats.depth--;
 }
 
-void printCurrentToken()
+#define STATS_ENTER(ctx, nonTerminal) \
+    ParserContext* statsScope __attribute__((cleanup(leaveNonTerminal))) = enterNonTerminal(ctx, nonTerminal)
+
+#else
+
+#define STATS_ENTER(ctx, nonTerminal) ((void)0)
+
+#endif
+
+/**
+ * Same as STATS_ENTER() for the frames of an iterative parse, which count
+ * .. the call of a non-terminal as it begins, and set the depth as they are
+ * .. pushed and popped.
+ * */
+#define STATS_CALL(ctx, nonTerminal) STATS_COUNT((ctx)->stats.calls[nonTerminal]++)
+#define STATS_DEPTH(ctx, newDepth) STATS_COUNT( \
+        if(((ctx)->stats.depth = (newDepth)) > (ctx)->stats.maxDepth) (ctx)->stats.maxDepth = (ctx)->stats.depth)
+
+/**
+ * Functions used for non-terminals of the grammar
+ * */
+/**
+ * Adds a node to the tree of the context at the current level, if a tree is
+ * .. built. Returns the index of the node, -1 if there is none.
+ * */
+static inline int addNode(ParserContext* ctx, AstKind kind, int op, int value, int symbol);
+
+/**
+ * Appends the given node to the given children, if a tree is built.
+ * */
+static inline void appendChild(ParserContext* ctx, AstChildren* children, int child);
+
+/**
+ * Adds the given symbol to the symbol table and, if a tree is built, a node
+ * .. of the given kind that declares it. Returns the node.
+ * */
+static inline int addDeclaredNode(ParserContext* ctx, AstKind kind, Symbol symbol);
+
+/**
+ * Adds an IDENTIFIER node for the current token, which refers to the symbol
+ * .. the name resolves to in the open scopes. Returns the node.
+ * */
+static inline int addReferenceNode(ParserContext* ctx);
+
+/**
+ * Adds an operator node with the given operands, where rhs is -2 for the
+ * .. operators with a single operand. Returns the node.
+ * */
+static inline int addOperatorNode(ParserContext* ctx, AstKind kind, int op, int lhs, int rhs);
+
+/**
+ * Sets the tokens of the given node, which run from the given token to the
+ * .. current one
+ * */
+static inline void setNodeTokens(ParserContext* ctx, int node, int firstToken);
+
+/**
+ * Sets of the tokens that a recovering parse resumes at after an error in a
+ * .. statement, a condition and a declaration, as bit masks of token ids.
+ * */
+#define TOKEN_BIT(id) (1ull << (id))
+
+#define STATEMENT_FOLLOW (TOKEN_BIT(semicolonsym) | TOKEN_BIT(endsym) | TOKEN_BIT(periodsym) | TOKEN_BIT(elsesym))
+#define CONDITION_FOLLOW (STATEMENT_FOLLOW | TOKEN_BIT(thensym) | TOKEN_BIT(dosym))
+#define DECLARATION_FOLLOW (TOKEN_BIT(semicolonsym) | TOKEN_BIT(periodsym) | TOKEN_BIT(varsym) | \
+                            TOKEN_BIT(procsym) | TOKEN_BIT(beginsym))
+
+/**
+ * Sets of the tokens that may follow the statement of a block, and that a
+ * .. recovering parse resumes at after a token that cannot.
+ * */
+#define BLOCK_FOLLOW (TOKEN_BIT(semicolonsym) | TOKEN_BIT(periodsym))
+#define BLOCK_RESUME (BLOCK_FOLLOW | BLOCK_START)
+
+/**
+ * Sets of the tokens that begin a statement, other than the empty one, a
+ * .. declaration and a block.
+ * */
+#define STATEMENT_START (TOKEN_BIT(identsym) | TOKEN_BIT(callsym) | TOKEN_BIT(beginsym) | TOKEN_BIT(ifsym) | \
+                         TOKEN_BIT(whilesym) | TOKEN_BIT(readsym) | TOKEN_BIT(writesym))
+#define DECLARATION_START (TOKEN_BIT(constsym) | TOKEN_BIT(varsym) | TOKEN_BIT(procsym))
+#define BLOCK_START (STATEMENT_START | DECLARATION_START)
+
+/**
+ * Sets of the operators that relop(), expression() and term() take.
+ * */
+#define RELATION_OPERATORS (TOKEN_BIT(eqsym) | TOKEN_BIT(neqsym) | TOKEN_BIT(lessym) | TOKEN_BIT(leqsym) | \
+                            TOKEN_BIT(gtrsym) | TOKEN_BIT(geqsym))
+#define ADDING_OPERATORS (TOKEN_BIT(plussym) | TOKEN_BIT(minussym))
+#define MULTIPLYING_OPERATORS (TOKEN_BIT(multsym) | TOKEN_BIT(slashsym))
+
+/**
+ * Classes of a token, one for each of the sets above that it is in
+ * */
+typedef enum {
+    TC_STATEMENT_FOLLOW = 1 << 0,
+    TC_CONDITION_FOLLOW = 1 << 1,
+    TC_DECLARATION_FOLLOW = 1 << 2,
+    TC_STATEMENT_START = 1 << 3,
+    TC_BLOCK_START = 1 << 4,
+    TC_RELATION = 1 << 5,
+    TC_ADDING = 1 << 6,
+    TC_MULTIPLYING = 1 << 7,
+    TC_DECLARATION_START = 1 << 8,
+    TC_BLOCK_FOLLOW = 1 << 9,
+    TC_BLOCK_RESUME = 1 << 10
+} TokenClass;
+
+/**
+ * What the parser decides on a token: its classes, and the statement that
+ * .. it begins, which is AST_EMPTY for the tokens that begin none.
+ * */
+typedef struct {
+    unsigned short classes;
+    unsigned char statement;
+} TokenInfo;
+
+#define TOKEN_CLASS(id, set, tokenClass) ((((set) >> (id)) & 1) ? (tokenClass) : 0)
+
+#define TOKEN_INFO(id, statement) [id] = { \
+    TOKEN_CLASS(id, STATEMENT_FOLLOW, TC_STATEMENT_FOLLOW) | \
+    TOKEN_CLASS(id, CONDITION_FOLLOW, TC_CONDITION_FOLLOW) | \
+    TOKEN_CLASS(id, DECLARATION_FOLLOW, TC_DECLARATION_FOLLOW) | \
+    TOKEN_CLASS(id, STATEMENT_START, TC_STATEMENT_START) | \
+    TOKEN_CLASS(id, BLOCK_START, TC_BLOCK_START) | \
+    TOKEN_CLASS(id, RELATION_OPERATORS, TC_RELATION) | \
+    TOKEN_CLASS(id, ADDING_OPERATORS, TC_ADDING) | \
+    TOKEN_CLASS(id, MULTIPLYING_OPERATORS, TC_MULTIPLYING) | \
+    TOKEN_CLASS(id, DECLARATION_START, TC_DECLARATION_START) | \
+    TOKEN_CLASS(id, BLOCK_FOLLOW, TC_BLOCK_FOLLOW) | \
+    TOKEN_CLASS(id, BLOCK_RESUME, TC_BLOCK_RESUME), \
+    statement }
+
+/**
+ * The info of each token id, computed at compile time from the sets above.
+ * It covers every value of a byte, so that the id of any token, including
+ * .. the end marker and INVALID_TOKEN_ID, is looked up without a check.
+ * */
+static const TokenInfo tokenInfos[256] = {
+    TOKEN_INFO(0, AST_EMPTY),
+    TOKEN_INFO(nulsym, AST_EMPTY),
+    TOKEN_INFO(identsym, AST_ASSIGN),
+    TOKEN_INFO(numbersym, AST_EMPTY),
+    TOKEN_INFO(plussym, AST_EMPTY),
+    TOKEN_INFO(minussym, AST_EMPTY),
+    TOKEN_INFO(multsym, AST_EMPTY),
+    TOKEN_INFO(slashsym, AST_EMPTY),
+    TOKEN_INFO(oddsym, AST_EMPTY),
+    TOKEN_INFO(eqsym, AST_EMPTY),
+    TOKEN_INFO(neqsym, AST_EMPTY),
+    TOKEN_INFO(lessym, AST_EMPTY),
+    TOKEN_INFO(leqsym, AST_EMPTY),
+    TOKEN_INFO(gtrsym, AST_EMPTY),
+    TOKEN_INFO(geqsym, AST_EMPTY),
+    TOKEN_INFO(lparentsym, AST_EMPTY),
+    TOKEN_INFO(rparentsym, AST_EMPTY),
+    TOKEN_INFO(commasym, AST_EMPTY),
+    TOKEN_INFO(semicolonsym, AST_EMPTY),
+    TOKEN_INFO(periodsym, AST_EMPTY),
+    TOKEN_INFO(becomessym, AST_EMPTY),
+    TOKEN_INFO(beginsym, AST_BEGIN),
+    TOKEN_INFO(endsym, AST_EMPTY),
+    TOKEN_INFO(ifsym, AST_IF),
+    TOKEN_INFO(thensym, AST_EMPTY),
+    TOKEN_INFO(whilesym, AST_WHILE),
+    TOKEN_INFO(dosym, AST_EMPTY),
+    TOKEN_INFO(callsym, AST_CALL),
+    TOKEN_INFO(constsym, AST_EMPTY),
+    TOKEN_INFO(varsym, AST_EMPTY),
+    TOKEN_INFO(procsym, AST_EMPTY),
+    TOKEN_INFO(writesym, AST_WRITE),
+    TOKEN_INFO(readsym, AST_READ),
+    TOKEN_INFO(elsesym, AST_EMPTY)
+};
+
+/**
+ * Returns the classes of the given token id that are among the given ones,
+ * .. 0 if none of them
+ * */
+static inline int isTokenInClass(int type, int tokenClasses)
 {
-    fprintf(_out, "%8s <%s, '%s'>\n", "TOKEN  :", tokenNames[getCurrentToken().id], getCurrentToken().lexeme);
+    return tokenInfos[type].classes & tokenClasses;
 }
 
-void nextToken()
+/**
+ * Records the given error at the current token, unless the latest error is
+ * .. at the same token already, as one error often causes others right
+ * .. after it. Returns 0 if there is no room for it, 1 otherwise.
+ * */
+static int recordError(ParserContext* ctx, int err);
+
+/**
+ * In a recovering parse, records the given error and skips the tokens till
+ * .. one in the given set, or the end. Returns 0 if the parse goes on from
+ * .. there, or the error if it stops, which it does unless it is recovering
+ * .. and there is room for the error. It always stops at PARSER_MEMORY_ERROR.
+ * */
+static int recoverFromError(ParserContext* ctx, int err, int followClass);
+
+/**
+ * Same as recoverFromError() for the errors of declarations, after which the
+ * .. semicolon that ends the declaration is skipped too.
+ * */
+static int recoverFromDeclarationError(ParserContext* ctx, int err);
+
+/**
+ * In a recovering parse, checks whether the current token is in the given
+ * .. set of the tokens that may follow a missing semicolon. If so, records
+ * .. the given error for the semicolon, so that the rest is parsed as if it
+ * .. was there.
+ * */
+static inline int isMissingSemicolon(ParserContext* ctx, int err, int startClass);
+
+/**
+ * In a recovering parse, checks whether a block goes back into its
+ * .. declarations after its statement, which began at the given token if it
+ * .. came right after a constant declaration, -1 otherwise. It does
+ * .. - after a statement whose ':=' is missing right after its identifier,
+ * ..   and which ends at a ';', as 'b = 2;' in 'const a = 1; b = 2;'. It is
+ * ..   taken as a constant that the ';' cut off from its declaration, and
+ * ..   the ';' is skipped.
+ * .. - at a token that cannot follow the statement. The error that the
+ * ..   enclosing procedure or program would find there is recorded, and the
+ * ..   tokens till the next declaration or statement are skipped.
+ * Returns 1 if so, 0 if the block ends at the current token.
+ * */
+static int resumeBlockDeclarations(ParserContext* ctx, int statementToken);
+
+/**
+ * Parallel parse of the top-level procedures, see ParserContext.
+ * startParallelParse() finds the procedures of the given token list and
+ * .. starts parsing them on the threads of the context, if it is worth it.
+ * takeParsedProcedures() takes the next procedures that a thread parsed, if
+ * .. the current token begins them, as if they were parsed right here.
+ * Returns 1 if it took them, 0 if the current token should be parsed as
+ * .. usual. If their scopes cannot be allocated, it sets err to
+ * .. PARSER_MEMORY_ERROR and returns 1 as well. finishParallelParse() stops
+ * .. the threads and frees the rest.
+ * */
+static void startParallelParse(ParserContext* ctx, TokenList* tokenList);
+static int takeParsedProcedures(ParserContext* ctx, int* err);
+static void finishParallelParse(ParserContext* ctx);
+
+/**
+ * Parses the given one of PROGRAM, BLOCK and STATEMENT with the variant of
+ * .. the grammar for the context or, if the context is iterative, with
+ * .. parseOnStack().
+ * */
+static int parseNonTerminal(ParserContext* ctx, NonTerminal nonTerminal, int* node);
+
+/**
+ * Same as program(), block() and statement(), which it starts with the given
+ * .. one of, except that the non-terminals that they parse in turn are
+ * .. pushed on the stack of the context instead of being called. Returns
+ * .. PARSER_STACK_ERROR once the stack cannot grow any more.
+ * */
+static int parseOnStack(ParserContext* ctx, NonTerminal nonTerminal, int* node);
+
+Token getCurrentToken(ParserContext* ctx)
 {
-    _token_list_it.currentTokenInd++;
+    return getCurrentTokenFromIterator(ctx->it);
 }
 
-void printNonTerminal(NonTerminal nonTerminal)
+static inline int getCurrentTokenType(ParserContext* ctx)
 {
-    fprintf(_out, "%8s %s\n", "NONTERM:", nonTerminalNames[nonTerminal]);
+    return peekTokenType(&ctx->it);
 }
 
-/**
- * Given the parser error code, prints error message on file by applying
- * required formatting.
- * */
-void printParserErr(int errCode, FILE* fp)
+static inline int getCurrentLexemeId(ParserContext* ctx)
 {
-    if(!fp) return;
+    return peekTokenLexeme(&ctx->it);
+}
 
-    if(!errCode)
-        fprintf(fp, "\nPARSING WAS SUCCESSFUL.\n");
-    else
-        fprintf(fp, "\nPARSING ERROR[%d]: %s.\n", errCode, parserErrorMsg[errCode]);
+const char* getCurrentLexeme(ParserContext* ctx)
+{
+    return getCurrentLexemeFromIterator(ctx->it);
 }
 
 /**
- * Advertised parser function. Given token list, which is possibly the output of 
- * the lexer, parses the tokens. If encountered, return the error code.
- * 
- * Returning 0 signals successful parsing.
- * Otherwise, returns a non-zero parser error code.
+ * The print helpers are only reached from the trace variants of grammar.h
+ * .. and from the iterative parser, which is the same for every kind of
+ * .. parse, so they return right away if nothing is written.
  * */
-int parser(TokenList tokenList, FILE* out)
+static inline void printCurrentToken(ParserContext* ctx)
 {
-    // Set output file pointer
-    _out = out;
+    if(!ctx->out) return;
 
-    /**
-     * Create a token list iterator, which helps to keep track of the current
-     * token being parsed.
-     * */
-    _token_list_it = getTokenListIterator(&tokenList);
+    int id = getCurrentTokenType(ctx);
 
-    // Initialize current level to 0, which is the global level
-    currentLevel = 0;
+    const InternPool* lexemes = &ctx->it.tokenList->lexemes;
 
-    // Initialize symbol table
-    initSymbolTable(&symbolTable);
+    // Ids without a name are printed the way printf prints a NULL string
+    const HistoryLine* prefix = &tokenLinePrefixes[id <= MAX_TOKEN_ID ? id : 0];
 
-    // Write parsing history header
-    fprintf(_out, "Parsing History\n===============\n");
+    writeSink(ctx->out, prefix->text, prefix->length);
 
-    // Start parsing by parsing program as the grammar suggests.
-    int err = program();
+    // The end of tokens has an empty lexeme
+    int lexeme = id ? getCurrentLexemeId(ctx) : -1;
 
-    // Print symbol table - if no error occured
-    if(!err)
+    if(lexeme >= 0)
+        writeSink(ctx->out, getInternedString(lexemes, lexeme), getInternedStringLength(lexemes, lexeme));
+
+    writeSink(ctx->out, "'>\n", 3);
+}
+
+void initHistoryLines()
+{
+    for(int id = 0; id <= MAX_TOKEN_ID; id++)
     {
-        fprintf(_out, "\n\n");
-        printSymbolTable(&symbolTable, _out);
+        const char* name = tokenNames[id] ? tokenNames[id] : "(null)";
+
+        tokenLinePrefixes[id].length = snprintf(tokenLinePrefixes[id].text, MAX_HISTORY_LINE_LENGTH,
+                                                "%8s <%s, '", "TOKEN  :", name);
     }
 
-    // Reset output file pointer
-    _out = NULL;
+    for(int nonTerminal = PROGRAM; nonTerminal <= FACTOR; nonTerminal++)
+    {
+        nonTerminalLines[nonTerminal].length = snprintf(nonTerminalLines[nonTerminal].text, MAX_HISTORY_LINE_LENGTH,
+                                                        "%8s %s\n", "NONTERM:", nonTerminalNames[nonTerminal]);
+    }
+}
 
-    // Reset the global TokenListIterator
-    _token_list_it.currentTokenInd = 0;
-    _token_list_it.tokenList = NULL;
+static inline void nextToken(ParserContext* ctx)
+{
+    stepTokenListIterator(&ctx->it);
+}
 
-    // Delete symbol table
-    deleteSymbolTable(&symbolTable);
+static inline void printNonTerminal(ParserContext* ctx, NonTerminal nonTerminal)
+{
+    if(!ctx->out) return;
 
-    // Return err code - which is 0 if parsing was successful
-    return err;
+    writeSink(ctx->out, nonTerminalLines[nonTerminal].text, nonTerminalLines[nonTerminal].length);
 }
 
-int program()
-{
-    printNonTerminal(PROGRAM);
-	
-	// Error variable to track errors.
-	int err = 0;
-	
-	// Pass to block and check error code returned.
-	err = block();
-	if(err != 0)
-		return err;
-	
-	// Check if the last symbol is a period, otherwise return
-	// error 6 for "period expected".
-	if(getCurrentTokenType() != periodsym)
-		return 6;
-	
-	// Print period.
-	printCurrentToken();
+static inline int addNode(ParserContext* ctx, AstKind kind, int op, int value, int symbol)
+{
+    if(!ctx->ast) return -1;
 
-    return 0;
+    return addAstNode(ctx->ast, kind, op, ctx->currentLevel, value, symbol);
 }
 
-int block()
-{
-    printNonTerminal(BLOCK);
-	
-	// Error variable to track errors.
-	int err = 0;
-	
-	// Check if current token is a constant and pass to constant
-	// declaration.
-	printNonTerminal(CONST_DECLARATION);
-    if(getCurrentTokenType() == constsym && err == 0)
-		err = const_declaration();
-	// Error check
-	if(err != 0)
-		return err;
-	
-	// Check if current token is a variable and pass to variable
-	// declaration.
-	printNonTerminal(VAR_DECLARATION);
-    if(getCurrentTokenType() == varsym && err == 0)
-		err = var_declaration();
-	// Error check
-	if(err != 0)
-		return err;
-	
-	// Check if current token is a procedure and pass to 
-	// procedure declaration.
-	printNonTerminal(PROC_DECLARATION);
-	if(getCurrentTokenType() == procsym && err == 0)
-		err = proc_declaration();
-	// Error check
-	if(err != 0)
-		return err;
-	
-	err = statement();
-	
-    return err;
+static inline void appendChild(ParserContext* ctx, AstChildren* children, int child)
+{
+    if(ctx->ast) appendAstChild(ctx->ast, children, child);
 }
 
-int const_declaration()
-{
-	// Do while loop parses constant declaration. Goes until a 
-	// comma isn't found.
-    do
-	{
-		// Declare a new Symbol and set its type and level 
-		// values.
-		Symbol newSym;
-		newSym.type = CONST;
-		newSym.level = currentLevel;
-		
-		// Get next token and check that it is an identifier.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != identsym)
-			return 3;
-		// Update the symbol's name.
-		strcpy(newSym.name, getCurrentToken().lexeme);
-		
-		// Get next token and check that it is an equal sign.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != eqsym)
-			return 2;
-		
-		// Get the next token and check that it is a number.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != numbersym)
-			return 1;
-		// Update the symbol's value.
-		newSym.value = atoi(getCurrentToken().lexeme);
-		
-		// Add the new symbol to the table.
-		addSymbol(&symbolTable, newSym);
-		
-		// Get next token.
-		printCurrentToken();
-		nextToken();
-	} while(getCurrentTokenType() == commasym);
-	
-	// Check for semicolon and get the next token.
-	if(getCurrentTokenType() != semicolonsym)
-		return 5;
-	printCurrentToken();
-	nextToken();
-
-    // Successful parsing.
-    return 0;
+static inline int addDeclaredNode(ParserContext* ctx, AstKind kind, Symbol symbol)
+{
+    int added = addSymbol(&ctx->symbolTable, symbol) ? ctx->symbolTable.numberOfSymbols - 1 : -1;
+
+    return addNode(ctx, kind, 0, symbol.name, added);
 }
 
-int var_declaration()
-{
-    do
-	{
-		// Declare a new symbol and set its type and level
-		// values.
-		Symbol newSym;
-		newSym.type = VAR;
-		newSym.level = currentLevel;
-		
-		// Get next token and check that it is an identifier.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != identsym)
-			return 3;
-		// Update the symbol's name.
-		strcpy(newSym.name, getCurrentToken().lexeme);
-		
-		// Get the next token.
-		printCurrentToken();
-		nextToken();
-		
-		// Add the new symbol to the table.
-		addSymbol(&symbolTable, newSym);
-	} while(getCurrentTokenType() == commasym);
-	
-	// Check for semicolon and get the next token.
-	if(getCurrentTokenType() != semicolonsym)
-		return 4;
-	printCurrentToken();
-	nextToken();
+static inline int addReferenceNode(ParserContext* ctx)
+{
+    if(!ctx->ast) return -1;
 
-    return 0;
+    int name = getCurrentLexemeId(ctx);
+
+    Symbol* symbol = lookupSymbol(&ctx->symbolTable, name);
+
+    return addNode(ctx, AST_IDENTIFIER, 0, name, symbol ? (int)(symbol - ctx->symbolTable.symbols) : -1);
 }
 
-int proc_declaration()
-{
-	// Error variable for tracking error codes.
-	int err = 0;
-	
-	// While loop parses procedure declaration.
-    while(getCurrentTokenType() == procsym)
-	{
-		// Declare a new symbol and set its type and level
-		// values.
-		Symbol newSym;
-		newSym.type = PROC;
-		newSym.level = currentLevel;
-		
-		// Get next token and check that it is an identifier.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != identsym)
-			return 3;
-		// Update the symbol's name.
-		strcpy(newSym.name, getCurrentToken().lexeme);
-		
-		// Add the new symbol to the table.
-		addSymbol(&symbolTable, newSym);
-		
-		// Get next token and check that it is a semicolon.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != semicolonsym)
-			return 5;
-		
-		// Get next token.
-		printCurrentToken();
-		nextToken();
-		
-		// Increment the current level for the next block and
-		// decrement it after the block is finished.
-		currentLevel++;
-		err = block();
-		currentLevel--;
-		
-		// If error is found return immediately.
-		if(err != 0)
-			return err;
-		
-		// Check for semicolon after new block.
-		if(getCurrentTokenType() != semicolonsym)
-			return 5;
-		
-		// Get next token.
-		printCurrentToken();
-		nextToken();
-	}
+static inline int addOperatorNode(ParserContext* ctx, AstKind kind, int op, int lhs, int rhs)
+{
+    if(!ctx->ast) return -1;
 
-    return err;
+    int node = addNode(ctx, kind, op, -1, -1);
+
+    AstChildren children = getAstChildren(node);
+    appendChild(ctx, &children, lhs);
+
+    if(rhs != -2)
+        appendChild(ctx, &children, rhs);
+
+    return node;
 }
 
-int statement()
-{
-    printNonTerminal(STATEMENT);
-	
-	// Error variable for tracking error codes.
-	int err = 0;
-	
-	// Statement that begins with an identifier symbol.
-    if(getCurrentTokenType() == identsym)
-	{
-		// Get next token and check if it is a become symbol.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != becomessym)
-			return 7;
-		
-		// Get next token and pass to expression.
-		printCurrentToken();
-		nextToken();
-		err = expression();
-	}
-	// Statement that begins with a call symbol.
-	else if(getCurrentTokenType() == callsym)
-	{
-		// Get next token and check if it is an identifier.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != identsym)
-			return 8;
-		
-		// Get next token.
-		printCurrentToken();
-		nextToken();
-	}
-	// Statement that begins with begin symbol.
-	else if(getCurrentTokenType() == beginsym)
-	{
-		// Get next token and pass to statement.
-		printCurrentToken();
-		nextToken();
-		err = statement();
-		
-		while (getCurrentTokenType() == semicolonsym)
-		{
-			// Get next token and pass to statement.
-			printCurrentToken();
-			nextToken();
-			err = statement();
-		}
-		
-		// Check for end symbol and get the next token.
-		if(getCurrentTokenType() != endsym)
-			return 10;
-		printCurrentToken();
-		nextToken();
-	}
-	// Statement that begins with if symbol.
-	else if(getCurrentTokenType() == ifsym)
-	{
-		// Get next token and pass to condition.
-		printCurrentToken();
-		nextToken();
-		err = condition();
-		
-		// Check the token is a then symbol.
-		if(getCurrentTokenType() != thensym)
-			return 9;
-		
-		// Get next token and pass to statement.
-		printCurrentToken();
-		nextToken();
-		err = statement();
-		
-		// Check for else statement. Get the next token and pass
-		// to statement if an else token is the current token.
-		if(getCurrentTokenType() == elsesym)
-		{
-			printCurrentToken();
-			nextToken();
-			err = statement();
-		}
-	}
-	// Statement that begins with while symbol.
-	else if(getCurrentTokenType() == whilesym)
-	{
-		// Get next token and pass to condition.
-		printCurrentToken();
-		nextToken();
-		err = condition();
-		
-		// Check the token is a do symbol.
-		if(getCurrentTokenType() != dosym)
-			return 11;
-		
-		// Get next token and pass to statement.
-		printCurrentToken();
-		nextToken();
-		err = statement();
-	}
-	// Statement that begins with write symbol.
-	else if(getCurrentTokenType() == writesym)
-	{
-		// Get next token and check if its an identifier.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != identsym)
-			return 3;
-		
-		// Get next token.
-		printCurrentToken();
-		nextToken();
-	}
-	// Statement that begins with read symbol.
-	else if(getCurrentTokenType() == readsym)
-	{
-		// Get next token and check if its an identifier.
-		printCurrentToken();
-		nextToken();
-		if(getCurrentTokenType() != identsym)
-			return 3;
-		
-		// Get next token.
-		printCurrentToken();
-		nextToken();
-	}
+static inline void setNodeTokens(ParserContext* ctx, int node, int firstToken)
+{
+    if(!ctx->ast || node < 0) return;
 
-    return err;
+    ctx->ast->nodes[node].firstToken = firstToken;
+    ctx->ast->nodes[node].endToken = getTokenListIteratorIndex(&ctx->it);
 }
 
-int condition()
-{
-    printNonTerminal(CONDITION);
-	
-	// Error variable for tracking errors.
-	int err = 0;
-	
-	// Check if the condition begins with an odd symbol.
-    if(getCurrentTokenType() == oddsym)
-	{
-		// Get next token and pass to expression.
-		printCurrentToken();
-		nextToken();
-		err = expression();
-	}
-	else
-	{
-		err = expression();
-		
-		// Check if the current token is a relation symbol.
-		if(getCurrentTokenType() != relop())
-			return 12;
-		
-		// Get next token and pass to expression.
-		printCurrentToken();
-		nextToken();
-		err = expression();
-	}
+static int recordError(ParserContext* ctx, int err)
+{
+    int tokenIndex = getTokenListIteratorIndex(&ctx->it);
+
+    if(ctx->numberOfErrors > 0 && ctx->errors[ctx->numberOfErrors - 1].tokenIndex == tokenIndex)
+        return 1;
 
-    return err;
+    if(ctx->numberOfErrors == MAX_PARSER_ERRORS)
+        return 0;
+
+    ParserError* error = &ctx->errors[ctx->numberOfErrors++];
+
+    error->code = err;
+    error->tokenIndex = tokenIndex;
+    error->lexeme = getCurrentTokenType(ctx) ? getCurrentLexemeId(ctx) : -1;
+
+    return 1;
 }
 
-int relop()
+static int recoverFromError(ParserContext* ctx, int err, int followClass)
 {
-    printNonTerminal(REL_OP);
+    if(!ctx->recover || err == PARSER_MEMORY_ERROR || !recordError(ctx, err))
+        return err;
+
+    int type;
+
+    while((type = getCurrentTokenType(ctx)) != 0 && !isTokenInClass(type, followClass))
+        nextToken(ctx);
 
-	// Compare the current token with all of the relation ops.
-    if(getCurrentTokenType() == eqsym || 
-	   getCurrentTokenType() == neqsym ||
-	   getCurrentTokenType() == lessym ||
-	   getCurrentTokenType() == leqsym ||
-	   getCurrentTokenType() == gtrsym ||
-	   getCurrentTokenType() == geqsym)
-	   return getCurrentTokenType();
-	
-	// Failure to find relation operator.
     return 0;
 }
 
-int expression()
-{
-    printNonTerminal(EXPRESSION);
-
-	// Error variable for tracking error codes.
-	int err = 0;
-	
-	// Get the next token if the current is a plus or minus sign.
-    if(getCurrentTokenType() == plussym || 
-	   getCurrentTokenType() == minussym)
-	{
-		printCurrentToken();
-		nextToken();
-	}
-	
-	err = term();
-	
-	// Continue parsing until the end of the expression.
-	while(getCurrentTokenType() == plussym || 
-	      getCurrentTokenType() == minussym)
-	{
-		printCurrentToken();
-		nextToken();
-		err = term();
-	}
+static int recoverFromDeclarationError(ParserContext* ctx, int err)
+{
+    err = recoverFromError(ctx, err, TC_DECLARATION_FOLLOW);
+
+    if(err == 0 && getCurrentTokenType(ctx) == semicolonsym)
+        nextToken(ctx);
 
     return err;
 }
 
-int term()
+static inline int isMissingSemicolon(ParserContext* ctx, int err, int startClass)
 {
-    printNonTerminal(TERM);
+    if(!ctx->recover) return 0;
 
-	// Error variable for tracking errors.
-	int err = 0;
-	
-    err = factor();
-	
-	// Continue parsing until the end of the term expression.
-	while(getCurrentTokenType() == multsym || 
-	      getCurrentTokenType() == slashsym)
-	{
-		printCurrentToken();
-		nextToken();
-		err = factor();
-	}
+    if(!isTokenInClass(getCurrentTokenType(ctx), startClass))
+        return 0;
 
-    return 0;
+    return recordError(ctx, err);
 }
 
-/**
- * The below function is left fully-implemented as a hint.
- * */
-int factor()
+static int resumeBlockDeclarations(ParserContext* ctx, int statementToken)
 {
-    printNonTerminal(FACTOR);
+    if(!ctx->recover) return 0;
 
-    /**
-     * There are three possibilities for factor:
-     * 1) ident
-     * 2) number
-     * 3) '(' expression ')'
-     * */
+    int type = getCurrentTokenType(ctx);
 
-    // Is the current token a identsym?
-    if(getCurrentTokenType() == identsym)
+    if(type == semicolonsym && statementToken >= 0 && ctx->numberOfErrors > 0)
     {
-        // Consume identsym
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
+        const ParserError* error = &ctx->errors[ctx->numberOfErrors - 1];
 
-        // Success
-        return 0;
+        if(error->code == 7 && error->tokenIndex == statementToken + 1)
+        {
+            nextToken(ctx);
+            return 1;
+        }
     }
-    // Is that a numbersym?
-    else if(getCurrentTokenType() == numbersym)
-    {
-        // Consume numbersym
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
 
-        // Success
+    if(type == 0 || isTokenInClass(type, TC_BLOCK_FOLLOW))
         return 0;
-    }
-    // Is that a lparentsym?
-    else if(getCurrentTokenType() == lparentsym)
+
+    if(recoverFromError(ctx, ctx->currentLevel > 0 ? 5 : 6, TC_BLOCK_RESUME) != 0)
+        return 0;
+
+    return isTokenInClass(getCurrentTokenType(ctx), TC_BLOCK_START) != 0;
+}
+
+/**
+ * Given the parser error code, prints error message on file by applying
+ * required formatting.
+ * */
+void printParserErr(int errCode, FILE* fp)
+{
+    if(!fp) return;
+
+    if(!errCode)
+        fprintf(fp, "\nPARSING WAS SUCCESSFUL.\n");
+    else
+        fprintf(fp, "\nPARSING ERROR[%d]: %s.\n", errCode, parserErrorMsg[errCode]);
+}
+
+void printParserErrToSink(int errCode, Sink* sink)
+{
+    if(!sink) return;
+
+    if(!errCode)
+        writeSinkString(sink, "\nPARSING WAS SUCCESSFUL.\n");
+    else
+        printfSink(sink, "\nPARSING ERROR[%d]: %s.\n", errCode, parserErrorMsg[errCode]);
+}
+
+void printParserErrorsToSink(const ParserContext* ctx, const InternPool* lexemes, Sink* sink)
+{
+    if(!sink) return;
+
+    if(ctx->numberOfErrors == 0)
+        printParserErrToSink(0, sink);
+
+    for(int i = 0; i < ctx->numberOfErrors; i++)
     {
-        // Consume lparentsym
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
-
-        // Continue by parsing expression.
-        int err = expression();
-
-        /**
-         * If parsing of expression was not successful, immediately stop parsing
-         * and propagate the same error code by returning it.
-         * */
-        
-        if(err) return err;
-
-        // After expression, right-parenthesis should come
-        if(getCurrentTokenType() != rparentsym)
+        const ParserError* error = &ctx->errors[i];
+
+        printfSink(sink, "\nPARSING ERROR[%d] at token %d", error->code, error->tokenIndex);
+
+        if(error->lexeme >= 0 && lexemes)
         {
-            /**
-             * Error code 13: Right parenthesis missing.
-             * Stop parsing and return error code 13.
-             * */
-            return 13;
+            writeSinkString(sink, " '");
+            writeSink(sink, getInternedString(lexemes, error->lexeme), getInternedStringLength(lexemes, error->lexeme));
+            writeSinkString(sink, "'");
         }
+        else
+            writeSinkString(sink, ", at the end");
 
-        // It was a rparentsym. Consume rparentsym.
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
+        printfSink(sink, ": %s.\n", parserErrorMsg[error->code]);
     }
-    else
+
+    if(ctx->numberOfErrors == MAX_PARSER_ERRORS)
+        printfSink(sink, "\nPARSING STOPPED AFTER %d ERRORS.\n", MAX_PARSER_ERRORS);
+}
+
+void initParserContext(ParserContext* ctx, ParserMode mode)
+{
+    ctx->mode = mode;
+    ctx->out = NULL;
+    ctx->symbolFormat = SYMBOL_TABLE_TEXT;
+    ctx->it = getTokenListIterator(NULL);
+    ctx->currentLevel = 0;
+
+    initSymbolTable(&ctx->symbolTable, NULL, NULL);
+
+    ctx->ast = NULL;
+
+    ctx->recover = 0;
+    ctx->numberOfErrors = 0;
+
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+
+    ctx->iterative = 0;
+    ctx->maxDepth = 0;
+    ctx->maxStackSize = 0;
+
+    ctx->stack.frames = NULL;
+    ctx->stack.depth = 0;
+    ctx->stack.capacity = 0;
+    ctx->stack.limit = 0;
+
+    ctx->parallel = 0;
+    ctx->parallelParse = NULL;
+}
+
+void deleteParserContext(ParserContext* ctx)
+{
+    if(!ctx) return;
+
+    deleteSymbolTable(&ctx->symbolTable);
+
+    free(ctx->stack.frames);
+    ctx->stack.frames = NULL;
+    ctx->stack.capacity = 0;
+
+    ctx->out = NULL;
+    ctx->symbolFormat = SYMBOL_TABLE_TEXT;
+    ctx->it = getTokenListIterator(NULL);
+}
+
+int parser_ctx(ParserContext* ctx, TokenList* tokenList, Sink* out)
+{
+    // Set the sink the parsing history is written to, if any
+    ctx->out = ctx->mode == PARSER_TRACE ? out : NULL;
+
+    if(ctx->out)
+        pthread_once(&historyLinesOnce, initHistoryLines);
+
+    /**
+     * Create a token list iterator, which helps to keep track of the current
+     * token being parsed.
+     * */
+    ctx->it = getTokenListIterator(tokenList);
+
+    // Initialize current level to 0, which is the global level
+    ctx->currentLevel = 0;
+
+    // Initialize symbol table, which allocates from the same arena as the
+    // token list, so it is freed along with the rest of the parse
+    deleteSymbolTable(&ctx->symbolTable);
+    initSymbolTable(&ctx->symbolTable, &tokenList->lexemes, tokenList->arena);
+
+    // Write parsing history header
+    if(ctx->out)
+        writeSinkString(ctx->out, "Parsing History\n===============\n");
+
+    // Start the tree over, if one is built
+    if(ctx->ast)
+        clearAst(ctx->ast);
+
+    ctx->numberOfErrors = 0;
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+
+    // Parse the top-level procedures on the threads of the context, if
+    // .. there are enough of them
+    if(ctx->parallel > 1)
+        startParallelParse(ctx, tokenList);
+
+    // Start parsing by parsing program as the grammar suggests.
+    int programNode;
+    int err = parseNonTerminal(ctx, PROGRAM, &programNode);
+
+    if(ctx->parallelParse)
+        finishParallelParse(ctx);
+
+    if(ctx->ast)
+        ctx->ast->root = programNode;
+
+    // A recovering parse gets here with the errors it could not recover
+    // from, and fails with its first error
+    if(ctx->recover)
     {
-        /**
-          * Error code 24: The preceding factor cannot begin with this symbol.
-          * Stop parsing and return error code 24.
-          * */
-        return 14;
+        if(err) recordError(ctx, err);
+
+        err = ctx->numberOfErrors ? ctx->errors[0].code : 0;
     }
 
-    return 0;
+    // Print symbol table - if no error occured
+    if(ctx->out && !err)
+    {
+        writeSink(ctx->out, "\n\n", 2);
+        printSymbolTableInFormat(&ctx->symbolTable, ctx->symbolFormat, ctx->out);
+    }
+
+    ctx->stats.tokens = getTokenListIteratorIndex(&ctx->it);
+
+    // Reset the output sink and the token list iterator
+    ctx->out = NULL;
+    ctx->symbolFormat = SYMBOL_TABLE_TEXT;
+    ctx->it = getTokenListIterator(NULL);
+
+    // Return err code - which is 0 if parsing was successful
+    return err;
+}
+
+int reparse_ctx(ParserContext* ctx, TokenList* tokenList, int firstToken, AstKind kind, int* node)
+{
+    *node = -1;
+
+    if(!tokenList || tokenList->refill || firstToken < 0 || firstToken > tokenList->numberOfTokens)
+        return -1;
+
+    // A fragment is parsed quietly and stops at its first error
+    int recover = ctx->recover;
+
+    ctx->out = NULL;
+    ctx->recover = 0;
+    ctx->numberOfErrors = 0;
+
+    ctx->it = getTokenListIterator(tokenList);
+    ctx->it.currentTokenInd = firstToken;
+
+    int err = parseNonTerminal(ctx, kind == AST_BLOCK ? BLOCK : STATEMENT, node);
+
+    ctx->recover = recover;
+    ctx->it = getTokenListIterator(NULL);
+
+    return err;
+}
+
+/**
+ * Advertised parser function. Given token list, which is possibly the output of 
+ * the lexer, parses the tokens. If encountered, return the error code.
+ * In PARSER_QUIET mode, neither the parsing history nor the symbol table is
+ * written to the given file.
+ * 
+ * Returning 0 signals successful parsing.
+ * Otherwise, returns a non-zero parser error code.
+ * */
+int parser(TokenList tokenList, FILE* out, ParserMode mode)
+{
+    ParserContext ctx;
+    initParserContext(&ctx, mode);
+
+    // Buffer the output of the parse, and write it before returning
+    Sink sink;
+    initSink(&sink, out);
+
+    int err = parser_ctx(&ctx, &tokenList, &sink);
+
+    deleteSink(&sink);
+    deleteParserContext(&ctx);
+
+    return err;
+}
+
+/**
+ * The variants of the functions of the grammar, see grammar.h. Each one
+ * .. only does the work of the parses it is for:
+ * _trace     : PARSER_TRACE, which writes the parsing history
+ * _quiet     : PARSER_QUIET, which only validates
+ * _ast       : PARSER_QUIET with a tree, as --ast builds
+ * _trace_ast : PARSER_TRACE with a tree, as --code and --run build
+ * */
+#define PARSER_VARIANT(name) name##_trace
+#define VARIANT_TRACES 1
+#define VARIANT_BUILDS_AST 0
+#include "grammar.h"
+
+#define PARSER_VARIANT(name) name##_quiet
+#define VARIANT_TRACES 0
+#define VARIANT_BUILDS_AST 0
+#include "grammar.h"
+
+#define PARSER_VARIANT(name) name##_ast
+#define VARIANT_TRACES 0
+#define VARIANT_BUILDS_AST 1
+#include "grammar.h"
+
+#define PARSER_VARIANT(name) name##_trace_ast
+#define VARIANT_TRACES 1
+#define VARIANT_BUILDS_AST 1
+#include "grammar.h"
+
+/**
+ * The entry points of a variant of the grammar
+ * */
+typedef struct {
+    int (*program)(ParserContext*, int*);
+    int (*block)(ParserContext*, int*);
+    int (*statement)(ParserContext*, int*);
+    int (*procedure)(ParserContext*, AstChildren*);
+    int (*constDeclaration)(ParserContext*, int*);
+    int (*varDeclaration)(ParserContext*, int*);
+    int (*relop)(ParserContext*);
+} ParserVariant;
+
+#define PARSER_VARIANT_ENTRIES(suffix) { program##suffix, block##suffix, statement##suffix, parseProcedure##suffix, \
+                                         const_declaration##suffix, var_declaration##suffix, relop##suffix }
+
+/**
+ * The variants, by whether the parse writes the parsing history and whether
+ * .. it builds a tree
+ * */
+static const ParserVariant parserVariants[2][2] = {
+    { PARSER_VARIANT_ENTRIES(_quiet), PARSER_VARIANT_ENTRIES(_ast) },
+    { PARSER_VARIANT_ENTRIES(_trace), PARSER_VARIANT_ENTRIES(_trace_ast) }
+};
+
+/**
+ * Returns the variant of the grammar for the given context
+ * */
+static inline const ParserVariant* getParserVariant(const ParserContext* ctx)
+{
+    return &parserVariants[ctx->out != NULL][ctx->ast != NULL];
+}
+
+static int parseNonTerminal(ParserContext* ctx, NonTerminal nonTerminal, int* node)
+{
+    if(ctx->iterative)
+        return parseOnStack(ctx, nonTerminal, node);
+
+    const ParserVariant* variant = getParserVariant(ctx);
+
+    switch(nonTerminal)
+    {
+    case PROGRAM:
+        return variant->program(ctx, node);
+    case BLOCK:
+        return variant->block(ctx, node);
+    default:
+        return variant->statement(ctx, node);
+    }
+}
+
+/**
+ * Places, in the functions of the non-terminals, that an iterative parse
+ * .. goes on from. The first place of each non-terminal is where it begins,
+ * .. and each of the others is right after a non-terminal that it parses in
+ * .. turn, which is named after it.
+ * */
+typedef enum {
+    PS_PROGRAM,
+    PS_PROGRAM_BLOCK,
+
+    PS_BLOCK,
+    PS_BLOCK_PROCEDURE,
+    PS_BLOCK_STATEMENT,
+
+    PS_PROCEDURE,
+    PS_PROCEDURE_BLOCK,
+
+    PS_STATEMENT,
+    PS_ASSIGN_EXPRESSION,
+    PS_BEGIN_STATEMENT,
+    PS_IF_CONDITION,
+    PS_IF_THEN_STATEMENT,
+    PS_IF_ELSE_STATEMENT,
+    PS_WHILE_CONDITION,
+    PS_WHILE_STATEMENT,
+
+    PS_CONDITION,
+    PS_ODD_EXPRESSION,
+    PS_RELATION_LHS,
+    PS_RELATION_RHS,
+
+    PS_EXPRESSION,
+    PS_EXPRESSION_FIRST_TERM,
+    PS_EXPRESSION_TERM,
+
+    PS_TERM,
+    PS_TERM_FIRST_FACTOR,
+    PS_TERM_FACTOR,
+
+    PS_FACTOR,
+    PS_FACTOR_EXPRESSION
+} ParseState;
+
+/**
+ * Frame of a non-terminal on the stack of an iterative parse, which holds
+ * .. the locals of its function that outlive the non-terminals it parses in
+ * .. turn.
+ * state      : the place that the non-terminal goes on from
+ * self       : node of the non-terminal
+ * children   : children of the node
+ * firstToken : first token of the non-terminal
+ * op         : operator of the node, the sign of an expression, or what
+ *              the block uses it for
+ * */
+struct ParseFrame {
+    int state;
+    int self;
+    AstChildren children;
+    int firstToken;
+    int op;
+};
+
+typedef struct ParseFrame ParseFrame;
+
+/**
+ * Least number of frames allocated for a parse stack
+ * */
+#define MIN_PARSE_STACK_CAPACITY 64
+
+/**
+ * Pushes a frame that begins at the given place on the stack of the given
+ * .. context, doubling the stack if it is full. Returns 0 if the stack is at
+ * .. its limit or cannot grow, 1 otherwise.
+ * */
+static int pushParseFrame(ParserContext* ctx, ParseState state)
+{
+    ParseStack* stack = &ctx->stack;
+
+    if(stack->depth == stack->limit)
+        return 0;
+
+    if(stack->depth == stack->capacity)
+    {
+        int capacity = MIN_PARSE_STACK_CAPACITY;
+
+        if(stack->capacity)
+            capacity = stack->capacity > stack->limit / 2 ? stack->limit : stack->capacity * 2;
+
+        if(capacity > stack->limit)
+            capacity = stack->limit;
+
+        ParseFrame* frames = realloc(stack->frames, (size_t)capacity * sizeof(ParseFrame));
+
+        if(!frames)
+            return 0;
+
+        STATS_REALLOCATION();
+
+        stack->frames = frames;
+        stack->capacity = capacity;
+    }
+
+    stack->frames[stack->depth++].state = state;
+    STATS_DEPTH(ctx, stack->depth);
+
+    return 1;
+}
+
+/**
+ * Sets the limit of the stack of the given context from its limits
+ * */
+static void setParseStackLimit(ParserContext* ctx)
+{
+    size_t limit = INT_MAX;
+
+    if(ctx->maxDepth > 0 && (size_t)ctx->maxDepth < limit)
+        limit = ctx->maxDepth;
+
+    if(ctx->maxStackSize > 0 && ctx->maxStackSize / sizeof(ParseFrame) < limit)
+        limit = ctx->maxStackSize / sizeof(ParseFrame);
+
+    ctx->stack.limit = (int)limit;
+}
+
+/**
+ * Moves on to the given place of the current frame, which is where the
+ * .. given non-terminal returns to, and begins the non-terminal
+ * */
+#define PARSE_CALL(begin, resume) do { \
+        frame->state = (resume); \
+        if(!pushParseFrame(ctx, (begin))) goto overflow; \
+        goto dispatch; \
+    } while(0)
+
+/**
+ * Pops the current frame, which returns the given error code and node to the
+ * .. frame below it
+ * */
+#define PARSE_RETURN(code, returnedNode) do { \
+        err = (code); \
+        result = (returnedNode); \
+        goto leave; \
+    } while(0)
+
+/**
+ * The code of each non-terminal is the same as the code of its function
+ * .. in grammar.h, in the same order. A call of a non-terminal that may
+ * .. recurse is a PARSE_CALL() instead, after which the function goes on from
+ * .. a place of its own, with the error code and the node of the call in err
+ * .. and result. Calls of const_declaration(), var_declaration() and relop(),
+ * .. which do not recurse, are calls of the variant of the context.
+ * */
+static int parseOnStack(ParserContext* ctx, NonTerminal nonTerminal, int* node)
+{
+    ParseStack* stack = &ctx->stack;
+    ParseFrame* frame;
+
+    const ParserVariant* variant = getParserVariant(ctx);
+
+    // Error code and node that the latest non-terminal returned
+    int err = 0;
+    int result = -1;
+
+    // Whether the statement of the current block comes right after a
+    // .. constant declaration, as in block()
+    int afterConst = 0;
+
+    *node = -1;
+
+    setParseStackLimit(ctx);
+    stack->depth = 0;
+
+    if(!pushParseFrame(ctx, nonTerminal == PROGRAM ? PS_PROGRAM : nonTerminal == BLOCK ? PS_BLOCK : PS_STATEMENT))
+        return PARSER_STACK_ERROR;
+
+dispatch:
+    frame = &stack->frames[stack->depth - 1];
+
+    switch(frame->state)
+    {
+    // program
+    case PS_PROGRAM:
+        STATS_CALL(ctx, PROGRAM);
+        printNonTerminal(ctx, PROGRAM);
+        PARSE_CALL(PS_BLOCK, PS_PROGRAM_BLOCK);
+
+    case PS_PROGRAM_BLOCK:
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        if(getCurrentTokenType(ctx) != periodsym)
+            PARSE_RETURN(6, -1);
+
+        printCurrentToken(ctx);
+
+        frame->self = addNode(ctx, AST_PROGRAM, 0, -1, -1);
+        frame->children = getAstChildren(frame->self);
+        appendChild(ctx, &frame->children, result);
+        setNodeTokens(ctx, frame->self, 0);
+        PARSE_RETURN(0, frame->self);
+
+    // block
+    case PS_BLOCK:
+        STATS_CALL(ctx, BLOCK);
+        printNonTerminal(ctx, BLOCK);
+
+        err = 0;
+        frame->firstToken = getTokenListIteratorIndex(&ctx->it);
+        frame->self = addNode(ctx, AST_BLOCK, 0, -1, -1);
+        frame->children = getAstChildren(frame->self);
+        afterConst = 0;
+
+    blockDeclarations:
+        // The op of the frame is the number of errors before the
+        // .. declarations, till the statement
+        frame->op = ctx->numberOfErrors;
+
+        printNonTerminal(ctx, CONST_DECLARATION);
+        if(getCurrentTokenType(ctx) == constsym)
+        {
+            err = variant->constDeclaration(ctx, &result);
+            if(err != 0)
+                err = recoverFromDeclarationError(ctx, err);
+            appendChild(ctx, &frame->children, result);
+            afterConst = 1;
+        }
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        printNonTerminal(ctx, VAR_DECLARATION);
+        if(getCurrentTokenType(ctx) == varsym)
+        {
+            err = variant->varDeclaration(ctx, &result);
+            if(err != 0)
+                err = recoverFromDeclarationError(ctx, err);
+            appendChild(ctx, &frame->children, result);
+            afterConst = 0;
+        }
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        printNonTerminal(ctx, PROC_DECLARATION);
+        goto blockProcedures;
+
+    case PS_BLOCK_PROCEDURE:
+        if(err != 0)
+            err = recoverFromDeclarationError(ctx, err);
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+        afterConst = 0;
+
+    blockProcedures:
+        if(getCurrentTokenType(ctx) == procsym)
+        {
+            // The frame of proc_declaration() parses all the procedures
+            // .. that follow each other, as the function does
+            STATS_CALL(ctx, PROC_DECLARATION);
+            PARSE_CALL(PS_PROCEDURE, PS_BLOCK_PROCEDURE);
+        }
+
+        if(ctx->numberOfErrors > frame->op &&
+           isTokenInClass(getCurrentTokenType(ctx), TC_DECLARATION_START))
+            goto blockDeclarations;
+
+        // From here on, it is the first token of the statement if it comes
+        // .. right after a constant declaration, -1 otherwise
+        frame->op = afterConst ? getTokenListIteratorIndex(&ctx->it) : -1;
+        PARSE_CALL(PS_STATEMENT, PS_BLOCK_STATEMENT);
+
+    case PS_BLOCK_STATEMENT:
+        appendChild(ctx, &frame->children, result);
+
+        if(err == 0 && resumeBlockDeclarations(ctx, frame->op))
+        {
+            afterConst = frame->op >= 0;
+            goto blockDeclarations;
+        }
+
+        setNodeTokens(ctx, frame->self, frame->firstToken);
+        PARSE_RETURN(err, err ? -1 : frame->self);
+
+    // proc_declaration, whose procedures are children of the block below it
+    case PS_PROCEDURE_BLOCK:
+        exitScope(&ctx->symbolTable);
+        ctx->currentLevel--;
+
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        appendChild(ctx, &frame->children, result);
+        appendChild(ctx, &frame[-1].children, frame->self);
+
+        if(getCurrentTokenType(ctx) != semicolonsym)
+            PARSE_RETURN(5, -1);
+
+        printCurrentToken(ctx);
+        nextToken(ctx);
+        setNodeTokens(ctx, frame->self, frame->firstToken);
+
+        // On to the next procedure, if any
+        // Falls through
+    case PS_PROCEDURE:
+    {
+        if(getCurrentTokenType(ctx) != procsym)
+            PARSE_RETURN(0, -1);
+
+        frame->firstToken = getTokenListIteratorIndex(&ctx->it);
+        Symbol newSym;
+        newSym.type = PROC;
+        newSym.level = ctx->currentLevel;
+
+        printCurrentToken(ctx);
+        nextToken(ctx);
+        if(getCurrentTokenType(ctx) != identsym)
+            PARSE_RETURN(3, -1);
+        newSym.name = getCurrentLexemeId(ctx);
+
+        frame->self = addDeclaredNode(ctx, AST_PROC_DECLARATION, newSym);
+        frame->children = getAstChildren(frame->self);
+
+        printCurrentToken(ctx);
+        nextToken(ctx);
+        if(getCurrentTokenType(ctx) != semicolonsym &&
+           !isMissingSemicolon(ctx, 5, TC_BLOCK_START))
+            PARSE_RETURN(5, -1);
+
+        if(getCurrentTokenType(ctx) == semicolonsym)
+        {
+            printCurrentToken(ctx);
+            nextToken(ctx);
+        }
+
+        if(enterScope(&ctx->symbolTable) != 0)
+            PARSE_RETURN(PARSER_MEMORY_ERROR, -1);
+
+        ctx->currentLevel++;
+        PARSE_CALL(PS_BLOCK, PS_PROCEDURE_BLOCK);
+    }
+
+    // statement, which finishes at finishStatement
+    case PS_STATEMENT:
+        STATS_CALL(ctx, STATEMENT);
+        frame->firstToken = getTokenListIteratorIndex(&ctx->it);
+
+        printNonTerminal(ctx, STATEMENT);
+
+        switch(tokenInfos[getCurrentTokenType(ctx)].statement)
+        {
+        case AST_ASSIGN:
+            frame->self = addNode(ctx, AST_ASSIGN, 0, -1, -1);
+            frame->children = getAstChildren(frame->self);
+            appendChild(ctx, &frame->children, addReferenceNode(ctx));
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            if(getCurrentTokenType(ctx) != becomessym)
+            {
+                err = 7;
+                goto finishStatement;
+            }
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_EXPRESSION, PS_ASSIGN_EXPRESSION);
+
+        case AST_CALL:
+        case AST_WRITE:
+        case AST_READ:
+        {
+            int kind = tokenInfos[getCurrentTokenType(ctx)].statement;
+
+            frame->self = addNode(ctx, kind, 0, -1, -1);
+            frame->children = getAstChildren(frame->self);
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            if(getCurrentTokenType(ctx) != identsym)
+            {
+                err = kind == AST_CALL ? 8 : 3;
+                goto finishStatement;
+            }
+            appendChild(ctx, &frame->children, addReferenceNode(ctx));
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            err = 0;
+            goto finishStatement;
+        }
+
+        case AST_BEGIN:
+            frame->self = addNode(ctx, AST_BEGIN, 0, -1, -1);
+            frame->children = getAstChildren(frame->self);
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_STATEMENT, PS_BEGIN_STATEMENT);
+
+        case AST_IF:
+            frame->self = addNode(ctx, AST_IF, 0, -1, -1);
+            frame->children = getAstChildren(frame->self);
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_CONDITION, PS_IF_CONDITION);
+
+        case AST_WHILE:
+            frame->self = addNode(ctx, AST_WHILE, 0, -1, -1);
+            frame->children = getAstChildren(frame->self);
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_CONDITION, PS_WHILE_CONDITION);
+
+        default:
+            frame->self = addNode(ctx, AST_EMPTY, 0, -1, -1);
+            err = 0;
+            goto finishStatement;
+        }
+
+    case PS_ASSIGN_EXPRESSION:
+        appendChild(ctx, &frame->children, result);
+        goto finishStatement;
+
+    case PS_BEGIN_STATEMENT:
+        if(err != 0)
+            goto finishStatement;
+        appendChild(ctx, &frame->children, result);
+
+        if(getCurrentTokenType(ctx) == semicolonsym || isMissingSemicolon(ctx, 10, TC_STATEMENT_START))
+        {
+            if(getCurrentTokenType(ctx) == semicolonsym)
+            {
+                printCurrentToken(ctx);
+                nextToken(ctx);
+            }
+            PARSE_CALL(PS_STATEMENT, PS_BEGIN_STATEMENT);
+        }
+
+        err = getCurrentTokenType(ctx) != endsym ? 10 : 0;
+        if(err == 0)
+        {
+            printCurrentToken(ctx);
+            nextToken(ctx);
+        }
+        goto finishStatement;
+
+    case PS_IF_CONDITION:
+        if(err != 0)
+            goto finishStatement;
+        appendChild(ctx, &frame->children, result);
+
+        if(getCurrentTokenType(ctx) != thensym)
+        {
+            err = 9;
+            goto finishStatement;
+        }
+
+        printCurrentToken(ctx);
+        nextToken(ctx);
+        PARSE_CALL(PS_STATEMENT, PS_IF_THEN_STATEMENT);
+
+    case PS_IF_THEN_STATEMENT:
+        if(err != 0)
+            goto finishStatement;
+        appendChild(ctx, &frame->children, result);
+
+        if(getCurrentTokenType(ctx) == elsesym)
+        {
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_STATEMENT, PS_IF_ELSE_STATEMENT);
+        }
+        goto finishStatement;
+
+    case PS_IF_ELSE_STATEMENT:
+    case PS_WHILE_STATEMENT:
+        appendChild(ctx, &frame->children, result);
+        goto finishStatement;
+
+    case PS_WHILE_CONDITION:
+        if(err != 0)
+            goto finishStatement;
+        appendChild(ctx, &frame->children, result);
+
+        if(getCurrentTokenType(ctx) != dosym)
+        {
+            err = 11;
+            goto finishStatement;
+        }
+
+        printCurrentToken(ctx);
+        nextToken(ctx);
+        PARSE_CALL(PS_STATEMENT, PS_WHILE_STATEMENT);
+
+    finishStatement:
+        result = err ? -1 : frame->self;
+        setNodeTokens(ctx, result, frame->firstToken);
+
+        if(err != 0)
+            err = recoverFromError(ctx, err, TC_STATEMENT_FOLLOW);
+        PARSE_RETURN(err, result);
+
+    // condition, which finishes at finishCondition
+    case PS_CONDITION:
+        STATS_CALL(ctx, CONDITION);
+        printNonTerminal(ctx, CONDITION);
+
+        if(getCurrentTokenType(ctx) == oddsym)
+        {
+            frame->self = addNode(ctx, AST_ODD, 0, -1, -1);
+            frame->children = getAstChildren(frame->self);
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_EXPRESSION, PS_ODD_EXPRESSION);
+        }
+
+        PARSE_CALL(PS_EXPRESSION, PS_RELATION_LHS);
+
+    case PS_RELATION_LHS:
+    {
+        if(err != 0)
+            goto finishCondition;
+
+        int op = variant->relop(ctx);
+        if(getCurrentTokenType(ctx) != op)
+        {
+            err = 12;
+            goto finishCondition;
+        }
+
+        frame->self = addNode(ctx, AST_RELATION, op, -1, -1);
+        frame->children = getAstChildren(frame->self);
+        appendChild(ctx, &frame->children, result);
+
+        printCurrentToken(ctx);
+        nextToken(ctx);
+        PARSE_CALL(PS_EXPRESSION, PS_RELATION_RHS);
+    }
+
+    case PS_ODD_EXPRESSION:
+    case PS_RELATION_RHS:
+        appendChild(ctx, &frame->children, result);
+
+    finishCondition:
+        result = err ? -1 : frame->self;
+
+        if(err != 0)
+            err = recoverFromError(ctx, err, TC_CONDITION_FOLLOW);
+        PARSE_RETURN(err, result);
+
+    // expression
+    case PS_EXPRESSION:
+        STATS_CALL(ctx, EXPRESSION);
+        printNonTerminal(ctx, EXPRESSION);
+
+        frame->op = getCurrentTokenType(ctx);
+        if(isTokenInClass(frame->op, TC_ADDING))
+        {
+            printCurrentToken(ctx);
+            nextToken(ctx);
+        }
+        else
+            frame->op = 0;
+
+        PARSE_CALL(PS_TERM, PS_EXPRESSION_FIRST_TERM);
+
+    case PS_EXPRESSION_FIRST_TERM:
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        frame->self = result;
+        if(frame->op == minussym)
+            frame->self = addOperatorNode(ctx, AST_NEGATE, minussym, frame->self, -2);
+        goto expressionTerms;
+
+    case PS_EXPRESSION_TERM:
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        frame->self = addOperatorNode(ctx, AST_BINARY, frame->op, frame->self, result);
+
+    expressionTerms:
+        if(isTokenInClass(frame->op = getCurrentTokenType(ctx), TC_ADDING))
+        {
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_TERM, PS_EXPRESSION_TERM);
+        }
+        PARSE_RETURN(0, frame->self);
+
+    // term
+    case PS_TERM:
+        STATS_CALL(ctx, TERM);
+        printNonTerminal(ctx, TERM);
+        PARSE_CALL(PS_FACTOR, PS_TERM_FIRST_FACTOR);
+
+    case PS_TERM_FIRST_FACTOR:
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        frame->self = result;
+        goto termFactors;
+
+    case PS_TERM_FACTOR:
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        frame->self = addOperatorNode(ctx, AST_BINARY, frame->op, frame->self, result);
+
+    termFactors:
+        if(isTokenInClass(frame->op = getCurrentTokenType(ctx), TC_MULTIPLYING))
+        {
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_FACTOR, PS_TERM_FACTOR);
+        }
+        PARSE_RETURN(0, frame->self);
+
+    // factor
+    case PS_FACTOR:
+        STATS_CALL(ctx, FACTOR);
+        printNonTerminal(ctx, FACTOR);
+
+        if(getCurrentTokenType(ctx) == identsym)
+        {
+            result = addReferenceNode(ctx);
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_RETURN(0, result);
+        }
+        else if(getCurrentTokenType(ctx) == numbersym)
+        {
+            result = ctx->ast ? addNode(ctx, AST_NUMBER, 0, atoi(getCurrentLexeme(ctx)), -1) : -1;
+
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_RETURN(0, result);
+        }
+        else if(getCurrentTokenType(ctx) == lparentsym)
+        {
+            printCurrentToken(ctx);
+            nextToken(ctx);
+            PARSE_CALL(PS_EXPRESSION, PS_FACTOR_EXPRESSION);
+        }
+        PARSE_RETURN(14, -1);
+
+    case PS_FACTOR_EXPRESSION:
+        if(err != 0)
+            PARSE_RETURN(err, -1);
+
+        if(getCurrentTokenType(ctx) != rparentsym)
+            PARSE_RETURN(13, -1);
+
+        printCurrentToken(ctx);
+        nextToken(ctx);
+        PARSE_RETURN(0, result);
+    }
+
+leave:
+    // Return to the frame below, if any
+    STATS_DEPTH(ctx, stack->depth - 1);
+
+    if(--stack->depth > 0)
+        goto dispatch;
+
+    *node = result;
+    return err;
+
+overflow:
+    // Leave the scopes of the procedures that the parse is in, as their
+    // .. blocks would on returning
+    for(int i = 0; i < stack->depth; i++)
+    {
+        if(stack->frames[i].state == PS_PROCEDURE_BLOCK)
+        {
+            exitScope(&ctx->symbolTable);
+            ctx->currentLevel--;
+        }
+    }
+
+    stack->depth = 0;
+    return PARSER_STACK_ERROR;
+}
+
+/**
+ * Least number of tokens that a program needs to be parsed in parallel, and
+ * .. about as many tokens of procedures as each job of a parallel parse takes
+ * */
+#define PARALLEL_MIN_TOKENS (1 << 16)
+#define PARALLEL_JOB_TOKENS (1 << 13)
+
+/**
+ * Bytes of parsing history that a job of a parallel parse is expected to
+ * .. write for each of its tokens, for the first size of its buffer
+ * */
+#define PARALLEL_HISTORY_PER_TOKEN 32
+
+typedef enum {
+    JOB_PENDING,
+    JOB_RUNNING,
+    JOB_DONE
+} ParallelJobState;
+
+/**
+ * A run of consecutive top-level procedures that a thread parses at once.
+ * start      : first token of the first procedure, which is a procsym
+ * count      : number of the procedures
+ * end        : the token the parse of the procedures stopped at
+ * err        : the error code of the parse of the procedures
+ * history    : the parsing history of the procedures, historySize bytes
+ * symbols    : the symbols they declared, in order, numberOfSymbols of them
+ * stats      : the counters of the parse
+ * The results are written by the thread that runs the job before it is
+ * .. JOB_DONE, and read by the parse after that, both under the lock.
+ * */
+typedef struct {
+    int start;
+    int count;
+    ParallelJobState state;
+
+    int end;
+    int err;
+    char* history;
+    size_t historySize;
+    Symbol* symbols;
+    int numberOfSymbols;
+    ParserStats stats;
+} ParallelJob;
+
+/**
+ * A parallel parse.
+ * jobs      : the jobs, in the order of their tokens, numberOfJobs of them
+ * nextJob   : the first job that may still be pending. Jobs are claimed in
+ *             order, so that they are done about in the order the parse
+ *             takes them
+ * taken     : the first job that the parse did not get to yet
+ * stopping  : set once the parse ends, after which no more jobs are run
+ * lock      : guards the states of the jobs and the fields above
+ * done      : signaled whenever a job is done
+ * threads   : the threads that run the jobs, numberOfThreads of them
+ * helper    : context in which the parse itself runs jobs, while it waits
+ *             for one
+ * */
+struct ParallelParse {
+    TokenList* tokenList;
+    ParserMode mode;
+
+    ParallelJob* jobs;
+    int numberOfJobs;
+    int nextJob;
+    int taken;
+    int stopping;
+
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+
+    pthread_t* threads;
+    int numberOfThreads;
+
+    ParserContext helper;
+};
+
+/**
+ * Finds the first token of each top-level procedure of the given tokens,
+ * .. by matching each procsym with the semicolon that ends its block, and
+ * .. stores them in a new array.
+ * It only looks at the token ids, skipping declarations to their semicolon
+ * .. and statements to the semicolon or period after them, outside of any
+ * .. begin and end. Statements other than begin have no semicolons in them,
+ * .. so each block ends there. The scan stops early at tokens that are not
+ * .. where this expects, which gives fewer procedures, never wrong ones: the
+ * .. parse only takes the jobs that begin where it is.
+ * Returns the number of the procedures found, -1 if the allocation failed.
+ * */
+static int findTopLevelProcedures(const TokenList* tokenList, int** starts)
+{
+    const unsigned char* ids = tokenList->ids;
+    int n = tokenList->numberOfTokens;
+
+    int count = 0;
+    int capacity = 0;
+    *starts = NULL;
+
+    // Procedures the scan is in, and whether it is at the beginning of a
+    // .. block, where the declarations are
+    int open = 0;
+    int blockStart = 1;
+    int i = 0;
+
+    while(i < n)
+    {
+        if(blockStart)
+        {
+            if(ids[i] == constsym)
+            {
+                while(i < n && ids[i] != semicolonsym) i++;
+                if(i < n) i++;
+            }
+
+            if(ids[i] == varsym)
+            {
+                while(i < n && ids[i] != semicolonsym) i++;
+                if(i < n) i++;
+            }
+
+            blockStart = 0;
+        }
+
+        if(ids[i] == procsym)
+        {
+            if(ids[i + 1] != identsym || ids[i + 2] != semicolonsym)
+                break;
+
+            if(open == 0)
+            {
+                if(count == capacity)
+                {
+                    capacity = capacity ? capacity * 2 : 1024;
+                    int* grown = realloc(*starts, capacity * sizeof(int));
+
+                    if(!grown)
+                    {
+                        free(*starts);
+                        *starts = NULL;
+                        return -1;
+                    }
+
+                    *starts = grown;
+                }
+
+                (*starts)[count++] = i;
+            }
+
+            open++;
+            blockStart = 1;
+            i += 3;
+            continue;
+        }
+
+        // The statement of a block
+        int depth = 0;
+
+        for(; i < n; i++)
+        {
+            int type = ids[i];
+
+            if(type == beginsym)
+                depth++;
+            else if(type == endsym && depth > 0)
+                depth--;
+            else if(depth == 0 && (type == semicolonsym || type == periodsym || type == endsym))
+                break;
+        }
+
+        // The main block ends the program, and the block of a procedure
+        // .. ends with the semicolon of the procedure
+        if(open == 0 || i == n || ids[i] != semicolonsym)
+            break;
+
+        i++;
+        open--;
+    }
+
+    // A procedure that the scan did not get to the end of is left out
+    if(open > 0 && count > 0)
+        count--;
+
+    return count;
+}
+
+/**
+ * Parses the procedures of the given job in the given context, as
+ * .. proc_declaration() would at the global level, and stores the results.
+ * */
+static void runParallelJob(ParallelParse* parallelParse, ParallelJob* job, ParserContext* ctx)
+{
+    TokenList* tokenList = parallelParse->tokenList;
+
+    Sink history;
+    int trace = parallelParse->mode == PARSER_TRACE;
+
+    if(trace)
+        initMemorySink(&history, (size_t)PARALLEL_HISTORY_PER_TOKEN * PARALLEL_JOB_TOKENS);
+
+    ctx->out = trace ? &history : NULL;
+    ctx->it = getTokenListIterator(tokenList);
+    ctx->it.currentTokenInd = job->start;
+    ctx->currentLevel = 0;
+
+    deleteSymbolTable(&ctx->symbolTable);
+    initSymbolTable(&ctx->symbolTable, &tokenList->lexemes, NULL);
+
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+
+    // A tree is not built, so the procedures are appended to nothing
+    AstChildren children = getAstChildren(-1);
+    int err = 0;
+
+    const ParserVariant* variant = getParserVariant(ctx);
+
+    // The procedures follow each other if the pre-scan got them right
+    for(int i = 0; i < job->count && err == 0; i++)
+        err = getCurrentTokenType(ctx) == procsym ? variant->procedure(ctx, &children) : -1;
+
+    job->end = getTokenListIteratorIndex(&ctx->it);
+    job->err = err;
+    job->stats = ctx->stats;
+
+    job->history = trace ? history.buffer : NULL;
+    job->historySize = trace ? history.length : 0;
+
+    job->numberOfSymbols = ctx->symbolTable.numberOfSymbols;
+    job->symbols = malloc((job->numberOfSymbols + 1) * sizeof(Symbol));
+
+    if(job->symbols)
+        memcpy(job->symbols, ctx->symbolTable.symbols, job->numberOfSymbols * sizeof(Symbol));
+    else
+        job->err = -1;
+
+    ctx->out = NULL;
+    ctx->it = getTokenListIterator(NULL);
+}
+
+/**
+ * Claims the next pending job of the given parse, under its lock. Returns
+ * .. NULL if there is none.
+ * */
+static ParallelJob* claimParallelJob(ParallelParse* parallelParse)
+{
+    if(parallelParse->stopping) return NULL;
+
+    while(parallelParse->nextJob < parallelParse->numberOfJobs)
+    {
+        ParallelJob* job = &parallelParse->jobs[parallelParse->nextJob++];
+
+        if(job->state == JOB_PENDING)
+        {
+            job->state = JOB_RUNNING;
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Runs the given claimed job in the given context, and marks it done. Called
+ * .. and returns with the lock of the given parse held.
+ * */
+static void completeParallelJob(ParallelParse* parallelParse, ParallelJob* job, ParserContext* ctx)
+{
+    pthread_mutex_unlock(&parallelParse->lock);
+
+    runParallelJob(parallelParse, job, ctx);
+
+    pthread_mutex_lock(&parallelParse->lock);
+
+    job->state = JOB_DONE;
+    pthread_cond_broadcast(&parallelParse->done);
+}
+
+static void* runParallelThread(void* arg)
+{
+    ParallelParse* parallelParse = arg;
+
+    ParserContext ctx;
+    initParserContext(&ctx, parallelParse->mode);
+
+    pthread_mutex_lock(&parallelParse->lock);
+
+    ParallelJob* job;
+
+    while((job = claimParallelJob(parallelParse)))
+        completeParallelJob(parallelParse, job, &ctx);
+
+    pthread_mutex_unlock(&parallelParse->lock);
+
+    deleteParserContext(&ctx);
+
+    return NULL;
+}
+
+static void startParallelParse(ParserContext* ctx, TokenList* tokenList)
+{
+    // A tree, the errors of a recovering parse and the stack of an iterative
+    // .. one all depend on what came before each procedure
+    if(ctx->ast || ctx->recover || ctx->iterative || tokenList->refill ||
+       tokenList->numberOfTokens < PARALLEL_MIN_TOKENS)
+        return;
+
+    int* starts;
+    int numberOfProcedures = findTopLevelProcedures(tokenList, &starts);
+
+    if(numberOfProcedures < 2)
+    {
+        free(starts);
+        return;
+    }
+
+    ParallelParse* parallelParse = calloc(1, sizeof(ParallelParse));
+    ParallelJob* jobs = calloc(numberOfProcedures, sizeof(ParallelJob));
+    pthread_t* threads = calloc(ctx->parallel - 1, sizeof(pthread_t));
+
+    if(!parallelParse || !jobs || !threads)
+    {
+        free(parallelParse);
+        free(jobs);
+        free(threads);
+        free(starts);
+        return;
+    }
+
+    // Runs of procedures of about PARALLEL_JOB_TOKENS tokens, or of a single
+    // .. larger procedure
+    int numberOfJobs = 0;
+
+    for(int first = 0; first < numberOfProcedures; numberOfJobs++)
+    {
+        int last = first + 1;
+
+        while(last < numberOfProcedures && starts[last] - starts[first] < PARALLEL_JOB_TOKENS)
+            last++;
+
+        jobs[numberOfJobs].start = starts[first];
+        jobs[numberOfJobs].count = last - first;
+        jobs[numberOfJobs].state = JOB_PENDING;
+
+        first = last;
+    }
+
+    free(starts);
+
+    parallelParse->tokenList = tokenList;
+    parallelParse->mode = ctx->mode;
+    parallelParse->jobs = jobs;
+    parallelParse->numberOfJobs = numberOfJobs;
+    parallelParse->threads = threads;
+
+    pthread_mutex_init(&parallelParse->lock, NULL);
+    pthread_cond_init(&parallelParse->done, NULL);
+
+    initParserContext(&parallelParse->helper, ctx->mode);
+
+    // The parse itself runs jobs too while it waits, so it takes one thread
+    // .. less. A thread that cannot be started leaves its jobs to the others.
+    for(int i = 0; i < ctx->parallel - 1 && i < numberOfJobs; i++)
+    {
+        if(pthread_create(&threads[parallelParse->numberOfThreads], NULL, runParallelThread, parallelParse) == 0)
+            parallelParse->numberOfThreads++;
+    }
+
+    ctx->parallelParse = parallelParse;
+}
+
+static int takeParsedProcedures(ParserContext* ctx, int* err)
+{
+    ParallelParse* parallelParse = ctx->parallelParse;
+
+    if(ctx->currentLevel != 0) return 0;
+
+    int index = getTokenListIteratorIndex(&ctx->it);
+
+    pthread_mutex_lock(&parallelParse->lock);
+
+    // The jobs that the parse passed are not needed any more, and neither is
+    // .. one at the current token that no thread got to yet, whose
+    // .. procedures are parsed right here instead
+    ParallelJob* job = NULL;
+
+    while(parallelParse->taken < parallelParse->numberOfJobs && parallelParse->jobs[parallelParse->taken].start <= index)
+    {
+        job = &parallelParse->jobs[parallelParse->taken++];
+
+        if(job->state == JOB_PENDING)
+        {
+            job->state = JOB_DONE;
+            job->err = -1;
+        }
+    }
+
+    if(job && job->start != index)
+        job = NULL;
+
+    // Run other jobs rather than just wait for this one
+    while(job && job->state != JOB_DONE)
+    {
+        ParallelJob* other = claimParallelJob(parallelParse);
+
+        if(other)
+            completeParallelJob(parallelParse, other, &parallelParse->helper);
+        else
+            pthread_cond_wait(&parallelParse->done, &parallelParse->lock);
+    }
+
+    pthread_mutex_unlock(&parallelParse->lock);
+
+    if(!job || job->err != 0)
+        return 0;
+
+    // Stitch the results in as if the procedures were parsed here. The
+    // .. symbols of their blocks are in closed scopes.
+    if(ctx->out)
+        writeSink(ctx->out, job->history, job->historySize);
+
+    int inScope = 0;
+
+    for(int i = 0; i < job->numberOfSymbols; i++)
+    {
+        Symbol* symbol = &job->symbols[i];
+
+        if(symbol->level > 0 && !inScope)
+        {
+            if(enterScope(&ctx->symbolTable) != 0)
+            {
+                *err = PARSER_MEMORY_ERROR;
+                return 1;
+            }
+        }
+        else if(symbol->level == 0 && inScope)
+            exitScope(&ctx->symbolTable);
+
+        inScope = symbol->level > 0;
+
+        addSymbol(&ctx->symbolTable, *symbol);
+    }
+
+    if(inScope)
+        exitScope(&ctx->symbolTable);
+
+#if PARSER_STATS_ENABLED
+    for(int i = 0; i <= FACTOR; i++)
+        ctx->stats.calls[i] += job->stats.calls[i];
+
+    if(ctx->stats.depth + job->stats.maxDepth > ctx->stats.maxDepth)
+        ctx->stats.maxDepth = ctx->stats.depth + job->stats.maxDepth;
+#endif
+
+    ctx->it.currentTokenInd = job->end;
+
+    return 1;
+}
+
+static void finishParallelParse(ParserContext* ctx)
+{
+    ParallelParse* parallelParse = ctx->parallelParse;
+
+    pthread_mutex_lock(&parallelParse->lock);
+    parallelParse->stopping = 1;
+    pthread_mutex_unlock(&parallelParse->lock);
+
+    for(int i = 0; i < parallelParse->numberOfThreads; i++)
+        pthread_join(parallelParse->threads[i], NULL);
+
+    for(int i = 0; i < parallelParse->numberOfJobs; i++)
+    {
+        free(parallelParse->jobs[i].history);
+        free(parallelParse->jobs[i].symbols);
+    }
+
+    deleteParserContext(&parallelParse->helper);
+
+    pthread_mutex_destroy(&parallelParse->lock);
+    pthread_cond_destroy(&parallelParse->done);
+
+    free(parallelParse->jobs);
+    free(parallelParse->threads);
+    free(parallelParse);
+
+    ctx->parallelParse = NULL;
 }
@@ -2,9 +2,195 @@
 #define __PARSER_H__
 
 #include "token.h"
+#include "symbol.h"
+#include "sink.h"
+#include "ast.h"
+#include "stats.h"
 
-int parser(TokenList, FILE*);
+/**
+ * Modes that parser() can run in.
+ * PARSER_TRACE : writes the parsing history and the symbol table
+ * PARSER_QUIET : only parses, nothing is written. The returned error code
+ *                is the same as in PARSER_TRACE mode.
+ * */
+typedef enum {
+    PARSER_TRACE,
+    PARSER_QUIET
+} ParserMode;
+
+/**
+ * Most errors a recovering parse collects, after which it stops
+ * */
+#define MAX_PARSER_ERRORS 64
+
+/**
+ * Error code of an iterative parse that needs more of its parse stack than
+ * .. its limits allow, or than can be allocated, see ParserContext. The parse
+ * .. stops there, even if it is recovering.
+ * */
+#define PARSER_STACK_ERROR 15
+
+/**
+ * Error code of a parse that could not allocate the scope of a procedure. The
+ * .. parse stops there, even if it is recovering.
+ * */
+#define PARSER_MEMORY_ERROR 16
+
+/**
+ * Stack of the non-terminals that an iterative parse is in, from the
+ * .. outermost one on. Its frames are defined in parser.c. It is kept across
+ * .. the parses of a context, so it is only allocated once it grows.
+ * frames   : the frames, capacity of them, depth of which are in use
+ * limit    : most frames the latest parse may push, from the limits of its
+ *            context
+ * */
+typedef struct {
+    struct ParseFrame* frames;
+    int depth;
+    int capacity;
+    int limit;
+} ParseStack;
+
+/**
+ * Parallel parse of the top-level procedures of a program, which is defined
+ * .. in parser.c
+ * */
+typedef struct ParallelParse ParallelParse;
+
+/**
+ * A syntax error that a recovering parse found.
+ * code       : the parser error code
+ * tokenIndex : index of the token the error is found at, counting from 0
+ * lexeme     : lexeme id of the token, -1 if the tokens had ended
+ * */
+typedef struct {
+    int code;
+    int tokenIndex;
+    int lexeme;
+} ParserError;
+
+/**
+ * The whole state of a parse. Parses with different contexts share nothing
+ * .. that is written, so they can run concurrently on different threads.
+ *
+ * out          : sink that the parsing history and the symbol table are
+ *                written to, NULL if nothing is written
+ * symbolFormat : format the symbol table is written in, SYMBOL_TABLE_TEXT
+ *                unless the host sets another one
+ * it           : token list iterator, which keeps track of the current
+ *                token being parsed
+ * currentLevel : current level, 0 being the global level
+ * symbolTable  : symbol table of the latest parse. It is kept after the
+ *                parse and deleted by the next parse or deleteParserContext()
+ * ast          : tree that the parse builds, NULL if no tree is built. It is
+ *                owned by the host, which sets it before the parse. The tree
+ *                is valid if the parse succeeds and it is not incomplete
+ * recover      : if not 0, the parse goes on after a syntax error, from the
+ *                next token that may follow the part with the error, such
+ *                as ';', 'end', '.', 'then' and 'do'. The host sets it before
+ *                the parse
+ * errors       : the errors a recovering parse found, numberOfErrors of
+ *                them, in the order of their tokens
+ * iterative    : if not 0, the non-terminals are parsed on a stack of
+ *                frames on the heap instead of recursing on the C stack, so
+ *                nesting is only bound by the limits below. The parsing
+ *                history, the tree and the error codes are the same. The
+ *                host sets it and the limits before the parse
+ * maxDepth     : most non-terminals an iterative parse may be in at once,
+ *                0 for no limit
+ * maxStackSize : most bytes the stack of an iterative parse may take, 0 for
+ *                no limit
+ * stack        : stack of the latest iterative parse
+ * stats        : counters of the latest parse, see stats.h
+ * parallel     : number of threads that the top-level procedures of a
+ *                large program may be parsed on, 0 or 1 for none. A
+ *                pre-scan of the token ids finds where the procedures
+ *                begin and end, and the threads parse runs of them, each
+ *                with a context, a symbol table and a parsing history of
+ *                its own, which the parse takes in the order of the
+ *                tokens as it gets to them. So the output is the same as
+ *                a serial one. A procedure that the pre-scan got wrong, or
+ *                that has an error, is parsed again serially. Procedures
+ *                are only parsed in parallel in parses that neither build
+ *                a tree, recover, run iteratively nor stream their tokens.
+ *                The host sets it before the parse
+ * parallelParse : the parallel parse in progress, NULL if there is none
+ * */
+typedef struct {
+    ParserMode mode;
+    Sink* out;
+    SymbolTableFormat symbolFormat;
+    TokenListIterator it;
+    unsigned int currentLevel;
+    SymbolTable symbolTable;
+    Ast* ast;
+
+    int recover;
+    ParserError errors[MAX_PARSER_ERRORS];
+    int numberOfErrors;
+
+    int iterative;
+    int maxDepth;
+    size_t maxStackSize;
+    ParseStack stack;
+
+    ParserStats stats;
+
+    int parallel;
+    ParallelParse* parallelParse;
+} ParserContext;
+
+/**
+ * Initializes the given parser context to parse in the given mode.
+ * */
+void initParserContext(ParserContext*, ParserMode);
+
+/**
+ * Makes the necessary deallocations on the given parser context.
+ * */
+void deleteParserContext(ParserContext*);
+
+/**
+ * Reentrant parser function. Parses the given token list using the given
+ * .. context and, in PARSER_TRACE mode, writes the parsing history and the
+ * .. symbol table to the given sink. The sink is not flushed.
+ * Returns the same error code as parser(). A recovering parse returns the
+ * .. code of its first error, and the symbol table is only written if it
+ * .. finds none.
+ * */
+int parser_ctx(ParserContext*, TokenList*, Sink*);
+
+/**
+ * Parses a single statement, or a block if the given kind is AST_BLOCK, of
+ * .. the given token list from the given token on, and adds it to the tree
+ * .. of the given context, setting the given node to its root. This is how
+ * .. the incremental parser parses a part of a program again, see reparse.h.
+ * Nothing is written, and the parse does not recover from errors.
+ * The host sets up the context beforehand: its symbol table should hold the
+ * .. symbols visible at the token, in their scopes, and currentLevel should
+ * .. be the level of the statement or the block.
+ * Returns the parser error code, or -1 if the list is streamed or the token
+ * .. is not in it. The tokens the fragment takes are the ones between the
+ * .. firstToken and endToken of its root.
+ * */
+int reparse_ctx(ParserContext*, TokenList*, int firstToken, AstKind, int*);
+
+int parser(TokenList, FILE*, ParserMode);
 
 void printParserErr(int errCode, FILE*);
 
-#endif
\ No newline at end of file
+/**
+ * Same as printParserErr(), except that the message is written to the given
+ * .. sink.
+ * */
+void printParserErrToSink(int errCode, Sink*);
+
+/**
+ * Writes the errors of the latest recovering parse of the given context to
+ * .. the given sink, one message per error with the index and the lexeme of
+ * .. its token, which is looked up in the given pool. Writes the success
+ * .. message if there are none.
+ * */
+void printParserErrorsToSink(const ParserContext*, const InternPool*, Sink*);
+
+#endif
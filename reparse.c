@@ -0,0 +1,491 @@
+#include "reparse.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Capacity of the first allocations of the path and the symbol map
+#define REPARSE_MIN_CAPACITY 16
+
+static inline int isStatement(int kind)
+{
+    return kind >= AST_ASSIGN && kind <= AST_EMPTY;
+}
+
+/**
+ * Makes sure the given array holds at least the given number of integers.
+ * Returns 0 if the allocation failed.
+ * */
+static int reserveInts(int** array, int* capacity, int size)
+{
+    if(size <= *capacity) return 1;
+
+    int newCapacity = *capacity ? *capacity * 2 : REPARSE_MIN_CAPACITY;
+
+    if(newCapacity < size) newCapacity = size;
+
+    int* newArray = realloc(*array, newCapacity * sizeof(int));
+    if(!newArray) return 0;
+
+    *array = newArray;
+    *capacity = newCapacity;
+
+    return 1;
+}
+
+void initIncrementalParser(IncrementalParser* parser)
+{
+    initTokenList(&parser->tokens);
+    initAst(&parser->ast, NULL);
+
+    initParserContext(&parser->ctx, PARSER_QUIET);
+    parser->ctx.ast = &parser->ast;
+
+    parser->err = 0;
+    parser->reparsedNode = -1;
+    parser->reparsedTokens = 0;
+    parser->garbageNodes = 0;
+
+    parser->path = NULL;
+    parser->pathTokens = NULL;
+    parser->pathCapacity = 0;
+    parser->pathTokensCapacity = 0;
+    parser->symbolMap = NULL;
+    parser->symbolMapCapacity = 0;
+    parser->lexemeMap = NULL;
+    parser->lexemeMapCapacity = 0;
+}
+
+void deleteIncrementalParser(IncrementalParser* parser)
+{
+    if(!parser) return;
+
+    deleteParserContext(&parser->ctx);
+    deleteAst(&parser->ast);
+    deleteTokenList(&parser->tokens);
+
+    free(parser->path);
+    free(parser->pathTokens);
+    free(parser->symbolMap);
+    free(parser->lexemeMap);
+
+    initIncrementalParser(parser);
+}
+
+/**
+ * Makes the tokens of the subtree of the given node, whose parent begins at
+ * .. the given token, relative, see reparse.h
+ * */
+static void makeTokensRelative(Ast* ast, int node, int parentFirst)
+{
+    AstNode* nodes = ast->nodes;
+
+    // Only the nodes with tokens have children with tokens
+    int first = nodes[node].firstToken;
+
+    if(first < 0) return;
+
+    nodes[node].firstToken = first - parentFirst;
+    nodes[node].endToken -= first;
+
+    for(int child = nodes[node].firstChild; child >= 0; child = nodes[child].nextSibling)
+        makeTokensRelative(ast, child, first);
+}
+
+/**
+ * Parses all the tokens of the given parser
+ * */
+static int parseWhole(IncrementalParser* parser)
+{
+    parser->err = parser_ctx(&parser->ctx, &parser->tokens, NULL);
+
+    // A tree that lacks nodes cannot be edited
+    if(!parser->err && parser->ast.incomplete)
+        parser->err = -1;
+
+    if(!parser->err)
+        makeTokensRelative(&parser->ast, parser->ast.root, 0);
+
+    parser->reparsedNode = parser->ast.root;
+    parser->reparsedTokens = parser->tokens.numberOfTokens;
+    parser->garbageNodes = 0;
+
+    return parser->err;
+}
+
+int parseIncremental(IncrementalParser* parser, const TokenList* tokens)
+{
+    if(replaceTokens(&parser->tokens, 0, parser->tokens.numberOfTokens, tokens, 0, tokens->numberOfTokens) != 0)
+    {
+        clearAst(&parser->ast);
+        return parser->err = -1;
+    }
+
+    return parseWhole(parser);
+}
+
+/**
+ * Adds the given symbol of the tree to the symbol table of a partial parse,
+ * .. and maps it back. Returns 0 if the allocation failed.
+ * */
+static int addVisibleSymbol(IncrementalParser* parser, SymbolTable* symbolTable, int symbol)
+{
+    // A name that could not be declared is not visible either
+    if(symbol < 0) return 1;
+
+    if(!addSymbol(symbolTable, parser->ctx.symbolTable.symbols[symbol]) ||
+       !reserveInts(&parser->symbolMap, &parser->symbolMapCapacity, symbolTable->numberOfSymbols))
+        return 0;
+
+    parser->symbolMap[symbolTable->numberOfSymbols - 1] = symbol;
+
+    return 1;
+}
+
+/**
+ * Declares the symbols that are visible at the node at the given depth of the
+ * .. path in the given symbol table, in the scopes they are declared in, the
+ * .. same way the parse of the whole program declared them till the node.
+ * Returns 0 if the allocation failed.
+ * */
+static int addVisibleSymbols(IncrementalParser* parser, SymbolTable* symbolTable, int depth)
+{
+    const AstNode* nodes = parser->ast.nodes;
+
+    // The path starts with PROGRAM and the main block
+    for(int i = 1; i < depth; i++)
+    {
+        int block = parser->path[i];
+
+        if(nodes[block].kind != AST_BLOCK) continue;
+
+        // The block of a procedure has a scope of its own
+        if(i > 1 && enterScope(symbolTable) != 0) return 0;
+
+        // The declarations before the path are the ones seen so far
+        for(int child = nodes[block].firstChild; child >= 0; child = nodes[child].nextSibling)
+        {
+            int onPath = child == parser->path[i + 1];
+
+            if(nodes[child].kind == AST_PROC_DECLARATION)
+            {
+                if(!addVisibleSymbol(parser, symbolTable, nodes[child].symbol)) return 0;
+            }
+            else if(nodes[child].kind == AST_CONST_DECLARATION || nodes[child].kind == AST_VAR_DECLARATION)
+            {
+                for(int name = nodes[child].firstChild; name >= 0; name = nodes[name].nextSibling)
+                {
+                    if(!addVisibleSymbol(parser, symbolTable, nodes[name].symbol)) return 0;
+                }
+            }
+
+            if(onPath) break;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Counts the nodes of the subtree of the given node, and the symbols that
+ * .. are declared in it
+ * */
+static void countSubtree(const Ast* ast, int node, int* numberOfNodes, int* numberOfSymbols)
+{
+    const AstNode* nodes = ast->nodes;
+
+    int kind = nodes[node].kind;
+    int isDeclaration = kind == AST_CONST_DECLARATION || kind == AST_VAR_DECLARATION;
+
+    (*numberOfNodes)++;
+
+    if(kind == AST_PROC_DECLARATION && nodes[node].symbol >= 0)
+        (*numberOfSymbols)++;
+
+    for(int child = nodes[node].firstChild; child >= 0; child = nodes[child].nextSibling)
+    {
+        // The children of a declaration are the declared names
+        if(isDeclaration && nodes[child].symbol >= 0)
+            (*numberOfSymbols)++;
+
+        countSubtree(ast, child, numberOfNodes, numberOfSymbols);
+    }
+}
+
+/**
+ * Splices the subtree at the given root, which is parsed from the nodes the
+ * .. pool had from mark on, in place of the node at the given depth of the
+ * .. path. The tokens after the old node moved by tokenDelta.
+ * firstSymbol is the first symbol of the parse that was declared by it, and
+ * .. the symbols that are declared are the ones of the procedure that is the
+ * .. parent of the node. Returns 0 if the symbols cannot be replaced.
+ * */
+static int spliceSubtree(IncrementalParser* parser, const SymbolTable* symbolTable, int depth, int root, int mark,
+                         int firstSymbol, int tokenDelta)
+{
+    Ast* ast = &parser->ast;
+    AstNode* nodes = ast->nodes;
+
+    int node = parser->path[depth];
+
+    int numberOfNodes = 0;
+    int numberOfSymbols = 0;
+    countSubtree(ast, node, &numberOfNodes, &numberOfSymbols);
+
+    // Symbols of the scope of the procedure, which a statement does not declare
+    int scopeStart = 0;
+    int symbolDelta = 0;
+
+    if(nodes[node].kind == AST_BLOCK)
+    {
+        scopeStart = nodes[parser->path[depth - 1]].symbol + 1;
+
+        int numberOfNewSymbols = symbolTable->numberOfSymbols - firstSymbol;
+
+        if(replaceSymbols(&parser->ctx.symbolTable, scopeStart, numberOfSymbols,
+                          &symbolTable->symbols[firstSymbol], numberOfNewSymbols) != 0)
+            return 0;
+
+        symbolDelta = numberOfNewSymbols - numberOfSymbols;
+    }
+
+    // Map the symbols of the new nodes to the ones of the tree
+    for(int i = mark; i < ast->numberOfNodes; i++)
+    {
+        int symbol = nodes[i].symbol;
+
+        if(symbol < 0)
+            continue;
+
+        nodes[i].symbol = symbol < firstSymbol ? parser->symbolMap[symbol] : scopeStart + symbol - firstSymbol;
+    }
+
+    makeTokensRelative(ast, root, parser->pathTokens[depth - 1]);
+
+    // The ancestors of the node hold the edit, so they get longer or shorter,
+    // .. and the nodes after them move
+    for(int i = 0; i <= depth; i++)
+    {
+        int ancestor = parser->path[i];
+
+        if(i < depth)
+            nodes[ancestor].endToken += tokenDelta;
+
+        for(int sibling = nodes[ancestor].nextSibling; sibling >= 0; sibling = nodes[sibling].nextSibling)
+        {
+            if(nodes[sibling].firstToken >= 0)
+                nodes[sibling].firstToken += tokenDelta;
+        }
+    }
+
+    // Renumber the symbols after the scope, if it changed in size
+    int scopeEnd = scopeStart + numberOfSymbols;
+
+    for(int i = 0; symbolDelta && i < mark; i++)
+    {
+        if(nodes[i].symbol >= scopeEnd)
+            nodes[i].symbol += symbolDelta;
+    }
+
+    // The old node keeps its place among its siblings, the rest of the old
+    // .. subtree and the slot of the new root are left behind
+    int nextSibling = nodes[node].nextSibling;
+
+    nodes[node] = nodes[root];
+    nodes[node].nextSibling = nextSibling;
+
+    parser->garbageNodes += numberOfNodes;
+
+    return 1;
+}
+
+/**
+ * Parses the node at the given depth of the path again, from its tokens after
+ * .. the edit, whose tokens moved by tokenDelta, and splices it into the tree.
+ * Returns 0 if the node cannot be parsed alone.
+ * */
+static int reparseNode(IncrementalParser* parser, int depth, int tokenDelta)
+{
+    Ast* ast = &parser->ast;
+
+    int node = parser->path[depth];
+    AstNode old = ast->nodes[node];
+
+    int firstToken = parser->pathTokens[depth];
+    int endToken = firstToken + old.endToken;
+
+    ParserContext fragment;
+    initParserContext(&fragment, PARSER_QUIET);
+    initSymbolTable(&fragment.symbolTable, &parser->tokens.lexemes, NULL);
+
+    fragment.ast = ast;
+    fragment.currentLevel = old.level;
+
+    // Fragments are parsed the same way as the whole program
+    fragment.iterative = parser->ctx.iterative;
+    fragment.maxDepth = parser->ctx.maxDepth;
+    fragment.maxStackSize = parser->ctx.maxStackSize;
+
+    int mark = ast->numberOfNodes;
+    int root = -1;
+
+    int spliced = 0;
+
+    // The block of a procedure declares its symbols in a scope of its own
+    if(addVisibleSymbols(parser, &fragment.symbolTable, depth) &&
+       (old.kind != AST_BLOCK || enterScope(&fragment.symbolTable) == 0))
+    {
+        int firstSymbol = fragment.symbolTable.numberOfSymbols;
+
+        int err = reparse_ctx(&fragment, &parser->tokens, firstToken, old.kind, &root);
+
+        if(!err && root >= 0 && !ast->incomplete && ast->nodes[root].endToken == endToken + tokenDelta)
+        {
+            parser->reparsedTokens = ast->nodes[root].endToken - firstToken;
+
+            spliced = spliceSubtree(parser, &fragment.symbolTable, depth, root, mark, firstSymbol, tokenDelta);
+        }
+    }
+
+    // Drop the nodes of a parse that is not kept
+    if(!spliced)
+    {
+        ast->numberOfNodes = mark;
+        ast->incomplete = 0;
+    }
+
+    deleteParserContext(&fragment);
+
+    return spliced;
+}
+
+/**
+ * Parses again the smallest statement or procedure block that holds the
+ * .. edited tokens, which are the ones from first up to end before the edit,
+ * .. after which the later tokens moved by tokenDelta.
+ * Returns 0 if there is no such node that can be parsed alone.
+ * */
+static int reparseEdit(IncrementalParser* parser, int first, int end, int tokenDelta)
+{
+    Ast* ast = &parser->ast;
+
+    if(parser->garbageNodes * 2 > ast->numberOfNodes && compactAst(ast))
+        parser->garbageNodes = 0;
+
+    // Go down the nodes that hold the edit. Of two adjacent nodes that
+    // .. both do, which only happens for tokens inserted between them, the
+    // .. later one is taken.
+    int depth = 0;
+    int nodeFirst = 0;
+
+    for(int node = ast->root; node >= 0; depth++)
+    {
+        if(!reserveInts(&parser->path, &parser->pathCapacity, depth + 1) ||
+           !reserveInts(&parser->pathTokens, &parser->pathTokensCapacity, depth + 1))
+            return 0;
+
+        nodeFirst += ast->nodes[node].firstToken;
+
+        parser->path[depth] = node;
+        parser->pathTokens[depth] = nodeFirst;
+
+        int next = -1;
+
+        for(int child = ast->nodes[node].firstChild; child >= 0; child = ast->nodes[child].nextSibling)
+        {
+            const AstNode* candidate = &ast->nodes[child];
+
+            int childFirst = nodeFirst + candidate->firstToken;
+
+            if(candidate->firstToken >= 0 && childFirst <= first && end <= childFirst + candidate->endToken)
+                next = child;
+        }
+
+        node = next;
+    }
+
+    // Try the deepest node first. The main block, and so the declarations of
+    // .. the main program, are left to a whole parse, see reparse.h
+    for(int i = depth - 1; i > 1; i--)
+    {
+        int kind = ast->nodes[parser->path[i]].kind;
+
+        const AstNode* parent = &ast->nodes[parser->path[i - 1]];
+
+        int isProcedureBlock = kind == AST_BLOCK && parent->kind == AST_PROC_DECLARATION && parent->symbol >= 0;
+
+        if((isStatement(kind) || isProcedureBlock) && reparseNode(parser, i, tokenDelta))
+        {
+            parser->reparsedNode = parser->path[i];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int editIncremental(IncrementalParser* parser, int first, int removed, const TokenList* source, int sourceFirst, int count)
+{
+    int hasTree = !parser->err && parser->ast.root >= 0;
+
+    if(replaceTokens(&parser->tokens, first, removed, source, sourceFirst, count) != 0)
+    {
+        parseWhole(parser);
+        return -1;
+    }
+
+    if(hasTree && reparseEdit(parser, first, first + removed, count - removed))
+        return parser->err;
+
+    return parseWhole(parser);
+}
+
+/**
+ * Returns 1 if the given token of the parser and the given token of the given
+ * .. list have the same id and lexeme. The lexemes are compared by their ids,
+ * .. through the map from the lexemes of the list to the ones of the parser.
+ * */
+static inline int isSameToken(const IncrementalParser* parser, int ind, const TokenList* tokens, int otherInd)
+{
+    const TokenList* old = &parser->tokens;
+
+    if(old->ids[ind] != tokens->ids[otherInd]) return 0;
+
+    int lexeme = tokens->lexemeIds[otherInd];
+
+    return lexeme < 0 ? old->lexemeIds[ind] < 0 : parser->lexemeMap[lexeme] == old->lexemeIds[ind];
+}
+
+int updateIncremental(IncrementalParser* parser, const TokenList* tokens)
+{
+    int n = parser->tokens.numberOfTokens;
+    int m = tokens->numberOfTokens;
+
+    int numberOfLexemes = tokens->lexemes.numberOfStrings;
+
+    if(!reserveInts(&parser->lexemeMap, &parser->lexemeMapCapacity, numberOfLexemes))
+        return parseIncremental(parser, tokens);
+
+    // A lexeme that the parser does not have matches no token
+    for(int i = 0; i < numberOfLexemes; i++)
+        parser->lexemeMap[i] = findInternedString(&parser->tokens.lexemes, getInternedString(&tokens->lexemes, i));
+
+    int prefix = 0;
+
+    while(prefix < n && prefix < m && isSameToken(parser, prefix, tokens, prefix))
+        prefix++;
+
+    int suffix = 0;
+
+    while(suffix < n - prefix && suffix < m - prefix && isSameToken(parser, n - 1 - suffix, tokens, m - 1 - suffix))
+        suffix++;
+
+    // Nothing to do for the same tokens, once they are parsed
+    if(prefix == n && n == m && parser->ast.root >= 0)
+    {
+        parser->reparsedNode = -1;
+        parser->reparsedTokens = 0;
+
+        return parser->err;
+    }
+
+    return editIncremental(parser, prefix, n - prefix - suffix, tokens, prefix, m - prefix - suffix);
+}
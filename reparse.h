@@ -0,0 +1,117 @@
+#ifndef __REPARSE_H__
+#define __REPARSE_H__
+
+#include "token.h"
+#include "parser.h"
+#include "ast.h"
+
+/**
+ * Incremental parser, which keeps the tokens, the tree and the symbol table
+ * .. of a program across edits of its tokens, as an editor makes them.
+ *
+ * Each statement, block and procedure of the tree knows the tokens it was
+ * .. parsed from (firstToken and endToken of its node). The tokens outside of
+ * .. an edit are not changed, so neither are the subtrees that do not hold
+ * .. the edit. An edit parses again only the smallest statement, or block of
+ * .. a procedure, that holds all the edited tokens, and splices the new
+ * .. subtree into the tree in place of the old one:
+ * - a statement declares nothing, so the symbol table is kept as it is, and
+ *   the names in the statement are looked up in the scopes around it
+ * - a block of a procedure replaces the symbols of the scope of the
+ *   procedure in the symbol table, and the symbols after them are
+ *   renumbered
+ * The main block is never parsed alone. Its symbols are the global scope,
+ * .. which is still open in the symbol table of the whole parse, and parsing
+ * .. it again takes about as long as parsing the whole program. So an edit
+ * .. that no statement or block of a procedure holds, such as one to the
+ * .. constants or variables of the main program or to the heading of one of
+ * .. its procedures, parses the whole program.
+ * In the tree of an incremental parser, firstToken of a node counts from the
+ * .. first token of its parent, and endToken from the first token of the
+ * .. node itself, which is the number of its tokens. So an edit only moves
+ * .. the nodes that hold it and the ones that follow them in their lists of
+ * .. children, rather than every node after it.
+ * A new subtree is kept only if it is parsed without errors from exactly the
+ * .. tokens in the place of the old one. Otherwise the enclosing statements
+ * .. and procedures are tried in turn, and at last the whole program, which
+ * .. is also how the errors are found.
+ *
+ * tokens         : the tokens of the program. Their lexemes are kept across
+ *                  edits, so the names in the tree and the symbol table
+ *                  stay valid
+ * ast            : the tree of the program, valid if err is 0, with relative
+ *                  tokens
+ * ctx            : context of the parses of the whole program, whose symbol
+ *                  table is the symbol table of the tree
+ * err            : error code of the latest parse, 0 if it succeeded
+ * reparsedNode   : root of the subtree that the latest edit parsed again,
+ *                  which is the root of the tree if the whole program was
+ *                  parsed, -1 if the edit did not change the tokens
+ * reparsedTokens : number of the tokens that the latest edit parsed again
+ * Everything is allocated from the heap.
+ * */
+typedef struct {
+    TokenList tokens;
+    Ast ast;
+    ParserContext ctx;
+    int err;
+
+    int reparsedNode;
+    int reparsedTokens;
+
+    // Nodes of the pool that are not in the tree any more, which are
+    // .. dropped once they are the most of the pool
+    int garbageNodes;
+
+    // Nodes from the root to the edited node and their first tokens, and
+    // .. the symbol of the tree that each symbol of a partial parse stands for
+    int* path;
+    int* pathTokens;
+    int pathCapacity;
+    int pathTokensCapacity;
+    int* symbolMap;
+    int symbolMapCapacity;
+
+    // The lexeme of the parser that each lexeme of the tokens given to
+    // .. updateIncremental() is, -1 if the parser has no such lexeme
+    int* lexemeMap;
+    int lexemeMapCapacity;
+} IncrementalParser;
+
+/**
+ * Initializes the given incremental parser, which has no program yet.
+ * */
+void initIncrementalParser(IncrementalParser*);
+
+/**
+ * Makes the necessary deallocations on the given incremental parser.
+ * */
+void deleteIncrementalParser(IncrementalParser*);
+
+/**
+ * Parses the whole of the given tokens, which replace the tokens of the
+ * .. given parser.
+ * Returns the parser error code, or -1 if the tokens cannot be copied.
+ * */
+int parseIncremental(IncrementalParser*, const TokenList*);
+
+/**
+ * Replaces the given number of tokens of the given parser from the given index
+ * .. on with the given number of tokens of the given list, from the given
+ * .. index of it on, and brings the tree and the symbol table up to date.
+ * Returns the parser error code of the program after the edit, or -1 if the
+ * .. tokens cannot be replaced.
+ * */
+int editIncremental(IncrementalParser*, int first, int removed, const TokenList*, int sourceFirst, int count);
+
+/**
+ * Same as editIncremental(), except that the given list holds all the tokens
+ * .. of the program after the edit. The edit is what is left between the
+ * .. tokens that both lists begin and end with, compared by their ids and
+ * .. lexemes. Each distinct lexeme of the given list is looked up once, and
+ * .. the tokens are compared by the ids of their lexemes. This takes a pass
+ * .. over the tokens, which editIncremental() does not need.
+ * */
+int updateIncremental(IncrementalParser*, const TokenList*);
+
+#endif
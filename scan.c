@@ -0,0 +1,294 @@
+#include "scan.h"
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define SCAN_ARM 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * Scalar kernels, which the vector kernels use for the last characters that
+ * .. do not fill a block. The identifier run is scanned by
+ * .. scanIdentifierRun(), which needs no dispatch.
+ * */
+static inline int isDigitChar(unsigned char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+static inline int isSpaceChar(unsigned char c)
+{
+    return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
+
+static size_t scanDigitScalar(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(p < end && isDigitChar((unsigned char)*p)) p++;
+
+    return p - start;
+}
+
+static size_t scanSpaceScalar(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(p < end && isSpaceChar((unsigned char)*p)) p++;
+
+    return p - start;
+}
+
+static const ScanKernels scalarKernels = {
+    "scalar", scanDigitScalar, scanSpaceScalar
+};
+
+#ifdef SCAN_X86
+
+/**
+ * Bytes of v in [lo, hi] are set. SSE2 only compares signed bytes, so the
+ * .. range is moved to start at -128.
+ * */
+#define SSE2_IN_RANGE(v, lo, hi) \
+    _mm_cmpgt_epi8(_mm_set1_epi8((char)((hi) - (lo) + 1 - 128)), _mm_add_epi8((v), _mm_set1_epi8((char)(-(lo) - 128))))
+
+static inline __m128i sse2SpaceMask(__m128i v)
+{
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), SSE2_IN_RANGE(v, '\t', '\r'));
+}
+
+/**
+ * Length of the run of the set bytes of the given mask of 16 bytes
+ * */
+static inline size_t sse2RunLength(__m128i mask)
+{
+    unsigned bits = ~(unsigned)_mm_movemask_epi8(mask) & 0xFFFF;
+
+    return bits ? (size_t)__builtin_ctz(bits) : 16;
+}
+
+static size_t scanDigitSSE2(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(end - p >= 16)
+    {
+        size_t run = sse2RunLength(SSE2_IN_RANGE(_mm_loadu_si128((const __m128i*)p), '0', '9'));
+
+        p += run;
+
+        if(run < 16) return p - start;
+    }
+
+    return (p - start) + scanDigitScalar(p, end);
+}
+
+static size_t scanSpaceSSE2(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(end - p >= 16)
+    {
+        size_t run = sse2RunLength(sse2SpaceMask(_mm_loadu_si128((const __m128i*)p)));
+
+        p += run;
+
+        if(run < 16) return p - start;
+    }
+
+    return (p - start) + scanSpaceScalar(p, end);
+}
+
+static const ScanKernels sse2Kernels = {
+    "sse2", scanDigitSSE2, scanSpaceSSE2
+};
+
+/**
+ * AVX2 kernels, which are compiled for AVX2 whatever the flags of the build
+ * .. are and only used if the CPU supports it
+ * */
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+#define AVX2_IN_RANGE(v, lo, hi) \
+    _mm256_cmpgt_epi8(_mm256_set1_epi8((char)((hi) - (lo) + 1 - 128)), _mm256_add_epi8((v), _mm256_set1_epi8((char)(-(lo) - 128))))
+
+AVX2_TARGET static inline size_t avx2RunLength(__m256i mask)
+{
+    unsigned bits = ~(unsigned)_mm256_movemask_epi8(mask);
+
+    return bits ? (size_t)__builtin_ctz(bits) : 32;
+}
+
+AVX2_TARGET static size_t scanDigitAVX2(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(end - p >= 32)
+    {
+        size_t run = avx2RunLength(AVX2_IN_RANGE(_mm256_loadu_si256((const __m256i*)p), '0', '9'));
+
+        p += run;
+
+        if(run < 32) return p - start;
+    }
+
+    return (p - start) + scanDigitSSE2(p, end);
+}
+
+AVX2_TARGET static size_t scanSpaceAVX2(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+
+        size_t run = avx2RunLength(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), AVX2_IN_RANGE(v, '\t', '\r')));
+
+        p += run;
+
+        if(run < 32) return p - start;
+    }
+
+    return (p - start) + scanSpaceSSE2(p, end);
+}
+
+static const ScanKernels avx2Kernels = {
+    "avx2", scanDigitAVX2, scanSpaceAVX2
+};
+
+#endif
+
+#ifdef SCAN_ARM
+
+/**
+ * Bytes of v in [lo, hi] are set, NEON compares unsigned bytes
+ * */
+#define NEON_IN_RANGE(v, lo, hi) vcltq_u8(vsubq_u8((v), vdupq_n_u8(lo)), vdupq_n_u8((hi) - (lo) + 1))
+
+/**
+ * Length of the run of the set bytes of the given mask of 16 bytes. NEON has
+ * .. no movemask, so each byte is narrowed to 4 bits of a 64-bit word.
+ * */
+static inline size_t neonRunLength(uint8x16_t mask)
+{
+    uint64_t bits = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+
+    return bits ? (size_t)(__builtin_ctzll(bits) >> 2) : 16;
+}
+
+static size_t scanDigitNEON(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(end - p >= 16)
+    {
+        size_t run = neonRunLength(NEON_IN_RANGE(vld1q_u8((const uint8_t*)p), '0', '9'));
+
+        p += run;
+
+        if(run < 16) return p - start;
+    }
+
+    return (p - start) + scanDigitScalar(p, end);
+}
+
+static size_t scanSpaceNEON(const char* p, const char* end)
+{
+    const char* start = p;
+
+    while(end - p >= 16)
+    {
+        uint8x16_t v = vld1q_u8((const uint8_t*)p);
+
+        size_t run = neonRunLength(vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), NEON_IN_RANGE(v, '\t', '\r')));
+
+        p += run;
+
+        if(run < 16) return p - start;
+    }
+
+    return (p - start) + scanSpaceScalar(p, end);
+}
+
+static const ScanKernels neonKernels = {
+    "neon", scanDigitNEON, scanSpaceNEON
+};
+
+#endif
+
+static const ScanKernels* scanKernels = NULL;
+static pthread_once_t scanKernelsOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Returns the given kernels if the CPU supports them, NULL otherwise
+ * */
+static const ScanKernels* findScanKernels(ScanKernel kernel)
+{
+    switch(kernel)
+    {
+    case SCAN_SCALAR:
+        return &scalarKernels;
+
+#ifdef SCAN_X86
+    case SCAN_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2") ? &sse2Kernels : NULL;
+
+    case SCAN_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? &avx2Kernels : NULL;
+#endif
+
+#ifdef SCAN_ARM
+    case SCAN_NEON:
+        return &neonKernels;
+#endif
+
+    case SCAN_BEST:
+    {
+        const ScanKernels* best = NULL;
+
+#ifdef SCAN_X86
+        if(!best) best = findScanKernels(SCAN_AVX2);
+        if(!best) best = findScanKernels(SCAN_SSE2);
+#endif
+
+#ifdef SCAN_ARM
+        if(!best) best = findScanKernels(SCAN_NEON);
+#endif
+
+        return best ? best : &scalarKernels;
+    }
+
+    default:
+        return NULL;
+    }
+}
+
+static void initScanKernels()
+{
+    if(!scanKernels) scanKernels = findScanKernels(SCAN_BEST);
+}
+
+const ScanKernels* getScanKernels()
+{
+    pthread_once(&scanKernelsOnce, initScanKernels);
+
+    return scanKernels;
+}
+
+int selectScanKernels(ScanKernel kernel)
+{
+    const ScanKernels* kernels = findScanKernels(kernel);
+
+    if(!kernels) return -1;
+
+    scanKernels = kernels;
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+#include <stddef.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Character class kernels of the lexer. Each one returns the length of the
+ * .. run of the characters of its class at the beginning of the given
+ * .. characters, scanning a whole block of 16 or 32 characters at a time
+ * .. where the CPU allows it.
+ *
+ * digit : digits
+ * space : ' ', '\t', '\n', '\v', '\f' and '\r'
+ * */
+typedef struct {
+    const char* name;
+    size_t (*digit)(const char*, const char*);
+    size_t (*space)(const char*, const char*);
+} ScanKernels;
+
+/**
+ * Kernels that can be selected
+ * */
+typedef enum {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+    SCAN_NEON,
+    SCAN_BEST
+} ScanKernel;
+
+/**
+ * Returns the kernels in use, which are the best ones the CPU supports
+ * .. unless selectScanKernels() is called before.
+ * */
+const ScanKernels* getScanKernels();
+
+/**
+ * Uses the given kernels from now on, for all the threads. Should be called
+ * .. before any lexing starts.
+ * Returns 0 on success, -1 if the CPU or the build does not support them.
+ * */
+int selectScanKernels(ScanKernel);
+
+/**
+ * Returns the length of the run of letters and digits at the beginning of the
+ * .. given characters, but not more than the given limit, which should be at
+ * .. most 16. Such a run always fits in a block of 16 characters, so it is
+ * .. classified at once, inline, with the vector instructions every CPU of
+ * .. the target has, and scalar code for the last characters.
+ * */
+static inline size_t scanIdentifierRun(const char* p, const char* end, size_t limit)
+{
+#if defined(__SSE2__)
+    if(end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+        // Bytes in ['a', 'z'] and ['0', '9'], moved to start at -128 for the
+        // .. signed compare
+        __m128i letters = _mm_cmpgt_epi8(_mm_set1_epi8(26 - 128), _mm_add_epi8(lower, _mm_set1_epi8((char)(-'a' - 128))));
+        __m128i digits = _mm_cmpgt_epi8(_mm_set1_epi8(10 - 128), _mm_add_epi8(v, _mm_set1_epi8((char)(-'0' - 128))));
+
+        unsigned bits = ~(unsigned)_mm_movemask_epi8(_mm_or_si128(letters, digits)) & 0xFFFF;
+        size_t run = bits ? (size_t)__builtin_ctz(bits) : 16;
+
+        return run < limit ? run : limit;
+    }
+#elif defined(__ARM_NEON)
+    if(end - p >= 16)
+    {
+        uint8x16_t v = vld1q_u8((const uint8_t*)p);
+        uint8x16_t lower = vorrq_u8(v, vdupq_n_u8(0x20));
+
+        uint8x16_t mask = vorrq_u8(vcltq_u8(vsubq_u8(lower, vdupq_n_u8('a')), vdupq_n_u8(26)),
+                                   vcltq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(10)));
+
+        // NEON has no movemask, so each byte is narrowed to 4 bits
+        uint64_t bits = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+        size_t run = bits ? (size_t)(__builtin_ctzll(bits) >> 2) : 16;
+
+        return run < limit ? run : limit;
+    }
+#endif
+
+    const char* start = p;
+
+    while(p < end && (size_t)(p - start) < limit &&
+          ((unsigned char)((*p | 0x20) - 'a') < 26 || (unsigned char)(*p - '0') < 10))
+        p++;
+
+    return p - start;
+}
+
+#endif
@@ -0,0 +1,634 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Size of the buffer a worker or a client moves inputs and outputs through
+#define SERVER_BUFFER_SIZE (1 << 16)
+
+/**
+ * State shared by the workers of a server.
+ * connections : the connection each worker serves, -1 if none
+ * active      : number of the requests being served
+ * stopping    : not 0 once the server stops, after which no request
+ *               is started
+ * lock guards the state below it, and idle is signalled once stopping and
+ * .. no request is active.
+ * */
+typedef struct {
+    int listenFd;
+    ParseOptions options;
+    int numberOfWorkers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    int* connections;
+    int active;
+    int stopping;
+} Server;
+
+/**
+ * A worker, and everything it keeps across its requests. The input of a
+ * .. request is written to input, and its output to output, which are
+ * .. temporary files, so that inputs are read the same way as the files of
+ * .. parseFile(), and mapped rather than copied.
+ * */
+typedef struct {
+    Server* server;
+    int index;
+
+    Arena arena;
+    ParserContext ctx;
+
+    FILE* input;
+    FILE* output;
+    char* buffer;
+} ServerWorker;
+
+/**
+ * Reads the given number of bytes from the given socket. Returns 1 once they
+ * .. are read, 0 if the connection was closed before the first one, and -1
+ * .. on failure or if it was closed in between.
+ * */
+static int receiveAll(int fd, void* data, size_t length)
+{
+    char* bytes = data;
+    size_t received = 0;
+
+    while(received < length)
+    {
+        ssize_t n = recv(fd, bytes + received, length - received, 0);
+
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return n == 0 && received == 0 ? 0 : -1;
+
+        received += n;
+    }
+
+    return 1;
+}
+
+/**
+ * Writes the given number of bytes to the given socket. Returns 0 on success.
+ * A closed connection is a failure, not a SIGPIPE.
+ * */
+static int sendAll(int fd, const void* data, size_t length)
+{
+    const char* bytes = data;
+
+    while(length > 0)
+    {
+        ssize_t n = send(fd, bytes, length, MSG_NOSIGNAL);
+
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return -1;
+
+        bytes += n;
+        length -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * Empties the given temporary file and moves to its start
+ * */
+static int truncateFile(FILE* file)
+{
+    rewind(file);
+
+    return ftruncate(fileno(file), 0);
+}
+
+/**
+ * Returns the options of a request with the given flags to a server with the
+ * .. given options
+ * */
+static ParseOptions getRequestOptions(ParseOptions options, uint32_t flags)
+{
+    options.mode = flags & (PARSE_REQUEST_QUIET | PARSE_REQUEST_AST) ? PARSER_QUIET : PARSER_TRACE;
+    options.recover = (flags & PARSE_REQUEST_RECOVER) != 0;
+    options.ast = (flags & PARSE_REQUEST_AST) != 0;
+    options.fold = (flags & PARSE_REQUEST_FOLD) != 0;
+    options.code = (flags & PARSE_REQUEST_CODE) != 0;
+    options.iterative = options.iterative || (flags & PARSE_REQUEST_ITERATIVE) != 0;
+    options.toBinary = (flags & PARSE_REQUEST_TO_BINARY) != 0;
+    options.symbolFormat = flags & PARSE_REQUEST_SYMBOLS_CSV ? SYMBOL_TABLE_CSV :
+                           flags & PARSE_REQUEST_SYMBOLS_TSV ? SYMBOL_TABLE_TSV : SYMBOL_TABLE_TEXT;
+
+    // Neither stdin nor the input file is there to read later, and the output
+    // .. has no path to export the symbols next to
+    options.run = 0;
+    options.stream = 0;
+    options.exportSymbols = 0;
+
+    return options;
+}
+
+/**
+ * Returns the flags of a request with the given options
+ * */
+static uint32_t getRequestFlags(ParseOptions options)
+{
+    uint32_t flags = 0;
+
+    if(options.mode == PARSER_QUIET) flags |= PARSE_REQUEST_QUIET;
+    if(options.recover)              flags |= PARSE_REQUEST_RECOVER;
+    if(options.ast)                  flags |= PARSE_REQUEST_AST;
+    if(options.fold)                 flags |= PARSE_REQUEST_FOLD;
+    if(options.code)                 flags |= PARSE_REQUEST_CODE;
+    if(options.iterative)            flags |= PARSE_REQUEST_ITERATIVE;
+    if(options.toBinary)             flags |= PARSE_REQUEST_TO_BINARY;
+
+    if(options.symbolFormat == SYMBOL_TABLE_TSV)      flags |= PARSE_REQUEST_SYMBOLS_TSV;
+    else if(options.symbolFormat == SYMBOL_TABLE_CSV) flags |= PARSE_REQUEST_SYMBOLS_CSV;
+
+    return flags;
+}
+
+/**
+ * Marks a request of the given server as started, unless it is stopping.
+ * Returns 0 if the request may go on.
+ * */
+static int beginRequest(Server* server)
+{
+    pthread_mutex_lock(&server->lock);
+
+    int stopping = server->stopping;
+    if(!stopping) server->active++;
+
+    pthread_mutex_unlock(&server->lock);
+
+    return stopping ? -1 : 0;
+}
+
+static void endRequest(Server* server)
+{
+    pthread_mutex_lock(&server->lock);
+
+    if(--server->active == 0 && server->stopping)
+        pthread_cond_broadcast(&server->idle);
+
+    pthread_mutex_unlock(&server->lock);
+}
+
+/**
+ * Serves the given request, whose header is read already, on the given
+ * .. connection. Returns 0 if the connection can go on with the next one.
+ * */
+static int serveRequest(ServerWorker* worker, int fd, const ParseRequestHeader* request)
+{
+    if(truncateFile(worker->input) != 0 || truncateFile(worker->output) != 0)
+        return -1;
+
+    for(uint64_t left = request->inputSize; left > 0; )
+    {
+        size_t length = left < SERVER_BUFFER_SIZE ? (size_t)left : SERVER_BUFFER_SIZE;
+
+        if(receiveAll(fd, worker->buffer, length) != 1 || fwrite(worker->buffer, 1, length, worker->input) != length)
+            return -1;
+
+        left -= length;
+    }
+
+    if(fflush(worker->input) != 0) return -1;
+    rewind(worker->input);
+
+    ParseOptions options = getRequestOptions(worker->server->options, request->flags);
+
+    int err = 0;
+    int ret = parseOpenFiles("request", "response", worker->input, worker->output, options,
+                             &worker->arena, &worker->ctx, &err);
+
+    long outputSize = fflush(worker->output) == 0 ? ftell(worker->output) : -1;
+
+    if(outputSize < 0) return -1;
+
+    ParseResponseHeader response;
+    memcpy(response.magic, PARSE_RESPONSE_MAGIC, 4);
+    response.err = ret == 0 ? err : -1;
+    response.outputSize = outputSize;
+
+    if(sendAll(fd, &response, sizeof(response)) != 0) return -1;
+
+    rewind(worker->output);
+
+    for(long left = outputSize; left > 0; )
+    {
+        size_t length = left < SERVER_BUFFER_SIZE ? (size_t)left : SERVER_BUFFER_SIZE;
+
+        if(fread(worker->buffer, 1, length, worker->output) != length || sendAll(fd, worker->buffer, length) != 0)
+            return -1;
+
+        left -= length;
+    }
+
+    return 0;
+}
+
+/**
+ * Serves the requests of the given connection till it is closed, fails or
+ * .. the server stops
+ * */
+static void serveConnection(ServerWorker* worker, int fd)
+{
+    ParseRequestHeader request;
+
+    while(receiveAll(fd, &request, sizeof(request)) == 1)
+    {
+        if(memcmp(request.magic, PARSE_REQUEST_MAGIC, 4) != 0 || request.inputSize > MAX_PARSE_REQUEST_SIZE)
+            break;
+
+        if(beginRequest(worker->server) != 0) break;
+
+        int ret = serveRequest(worker, fd, &request);
+
+        endRequest(worker->server);
+
+        if(ret != 0) break;
+    }
+}
+
+/**
+ * Sets the connection the given worker serves, -1 for none. Returns -1 if
+ * .. the server is stopping, in which case no connection is set.
+ * */
+static int setConnection(ServerWorker* worker, int fd)
+{
+    Server* server = worker->server;
+
+    pthread_mutex_lock(&server->lock);
+
+    int stopping = server->stopping && fd >= 0;
+    if(!stopping) server->connections[worker->index] = fd;
+
+    pthread_mutex_unlock(&server->lock);
+
+    return stopping ? -1 : 0;
+}
+
+static void* runServerWorker(void* arg)
+{
+    ServerWorker* worker = arg;
+    Server* server = worker->server;
+
+    for(;;)
+    {
+        int fd = accept(server->listenFd, NULL, NULL);
+
+        if(fd < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+
+            // The socket is shut down once the server stops
+            break;
+        }
+
+        if(setConnection(worker, fd) == 0)
+        {
+            serveConnection(worker, fd);
+            setConnection(worker, -1);
+        }
+
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/**
+ * Opens a socket that listens on the given path, replacing a socket file
+ * .. that nothing listens on. Returns the socket, or -1 on failure.
+ * */
+static int listenOnPath(const char* socketPath)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "The socket path \"%s\" is too long\n", socketPath);
+        return -1;
+    }
+
+    strcpy(address.sun_path, socketPath);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if(fd < 0)
+    {
+        fprintf(stderr, "Could not create a socket\n");
+        return -1;
+    }
+
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 && errno == EADDRINUSE)
+    {
+        // A socket file of a server that is gone is replaced
+        if(connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0)
+        {
+            fprintf(stderr, "A server already listens on \"%s\"\n", socketPath);
+            close(fd);
+            return -1;
+        }
+
+        close(fd);
+        unlink(socketPath);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if(fd >= 0 && bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if(fd < 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "Could not listen on \"%s\"\n", socketPath);
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int runServer(const char* socketPath, int numberOfWorkers, ParseOptions options)
+{
+    if(numberOfWorkers <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numberOfWorkers = cpus > 0 ? (int)cpus : 1;
+    }
+
+    // The signals that stop the server are only taken by sigwait(), which
+    // .. the workers inherit
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+
+    Server server;
+    server.listenFd = listenOnPath(socketPath);
+
+    if(server.listenFd < 0) return -1;
+
+    server.options = options;
+    server.numberOfWorkers = numberOfWorkers;
+    server.active = 0;
+    server.stopping = 0;
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.idle, NULL);
+
+    server.connections = malloc(numberOfWorkers * sizeof(int));
+    ServerWorker* workers = calloc(numberOfWorkers, sizeof(ServerWorker));
+    pthread_t* threads = malloc(numberOfWorkers * sizeof(pthread_t));
+
+    // Workers are initialized one by one, and started if they could be
+    int initialized = 0;
+    int started = 0;
+
+    if(server.connections && workers && threads)
+    {
+        for(; started < numberOfWorkers; started++)
+        {
+            ServerWorker* worker = &workers[started];
+
+            worker->server = &server;
+            worker->index = started;
+            worker->input = tmpfile();
+            worker->output = tmpfile();
+            worker->buffer = malloc(SERVER_BUFFER_SIZE);
+
+            server.connections[started] = -1;
+
+            initArena(&worker->arena, 0);
+            initParserContext(&worker->ctx, options.mode);
+            initialized++;
+
+            if(!worker->input || !worker->output || !worker->buffer ||
+               pthread_create(&threads[started], NULL, runServerWorker, worker) != 0)
+            {
+                // The workers that started serve the clients
+                break;
+            }
+        }
+    }
+
+    if(started == 0)
+        fprintf(stderr, "Could not start the workers of \"%s\"\n", socketPath);
+    else
+    {
+        int stopSignal;
+        sigwait(&stopSignals, &stopSignal);
+    }
+
+    // No request starts once stopping, and the ones being served are answered
+    pthread_mutex_lock(&server.lock);
+
+    server.stopping = 1;
+
+    while(server.active > 0)
+        pthread_cond_wait(&server.idle, &server.lock);
+
+    // Wakes the workers that wait for a request or a connection
+    for(int w = 0; w < started; w++)
+    {
+        if(server.connections[w] >= 0) shutdown(server.connections[w], SHUT_RDWR);
+    }
+
+    shutdown(server.listenFd, SHUT_RDWR);
+
+    pthread_mutex_unlock(&server.lock);
+
+    for(int w = 0; w < started; w++)
+        pthread_join(threads[w], NULL);
+
+    close(server.listenFd);
+    unlink(socketPath);
+
+    for(int w = 0; w < initialized; w++)
+    {
+        ServerWorker* worker = &workers[w];
+
+        if(worker->input) fclose(worker->input);
+        if(worker->output) fclose(worker->output);
+        free(worker->buffer);
+
+        deleteParserContext(&worker->ctx);
+        deleteArena(&worker->arena);
+    }
+
+    free(server.connections);
+    free(workers);
+    free(threads);
+
+    pthread_cond_destroy(&server.idle);
+    pthread_mutex_destroy(&server.lock);
+
+    return started > 0 ? 0 : -1;
+}
+
+/**
+ * Reads the whole given file into a buffer, which the caller frees. Returns
+ * .. NULL on failure.
+ * */
+static char* readWholeFile(FILE* in, size_t* length)
+{
+    char* data = NULL;
+    size_t capacity = 0;
+    *length = 0;
+
+    for(;;)
+    {
+        if(capacity - *length < SERVER_BUFFER_SIZE)
+        {
+            capacity = capacity ? capacity * 2 : SERVER_BUFFER_SIZE;
+
+            char* grown = realloc(data, capacity);
+
+            if(!grown)
+            {
+                free(data);
+                return NULL;
+            }
+
+            data = grown;
+        }
+
+        size_t n = fread(data + *length, 1, capacity - *length, in);
+        *length += n;
+
+        if(n == 0) break;
+    }
+
+    if(ferror(in))
+    {
+        free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+/**
+ * Opens a connection to the server on the given path. Returns the socket,
+ * .. or -1 on failure.
+ * */
+static int connectToPath(const char* socketPath)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(strlen(socketPath) >= sizeof(address.sun_path)) return -1;
+
+    strcpy(address.sun_path, socketPath);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if(fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Sends the given input as a request, and writes the output of its response
+ * .. to the given file. Returns 0 on success.
+ * */
+static int sendRequest(int fd, const char* input, size_t inputSize, ParseOptions options, FILE* outp)
+{
+    ParseRequestHeader request;
+    memcpy(request.magic, PARSE_REQUEST_MAGIC, 4);
+    request.flags = getRequestFlags(options);
+    request.inputSize = inputSize;
+
+    ParseResponseHeader response;
+
+    if(sendAll(fd, &request, sizeof(request)) != 0 || sendAll(fd, input, inputSize) != 0 ||
+       receiveAll(fd, &response, sizeof(response)) != 1 || memcmp(response.magic, PARSE_RESPONSE_MAGIC, 4) != 0)
+        return -1;
+
+    char buffer[SERVER_BUFFER_SIZE];
+
+    for(uint64_t left = response.outputSize; left > 0; )
+    {
+        size_t length = left < sizeof(buffer) ? (size_t)left : sizeof(buffer);
+
+        if(receiveAll(fd, buffer, length) != 1 || fwrite(buffer, 1, length, outp) != length)
+            return -1;
+
+        left -= length;
+    }
+
+    return response.err >= 0 ? 0 : -1;
+}
+
+int runClient(const char* socketPath, const char* inputPath, const char* outputPath, ParseOptions options)
+{
+    FILE* inp = fopen(inputPath, "rb");
+
+    if(!inp)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", inputPath);
+        return -1;
+    }
+
+    size_t inputSize;
+    char* input = readWholeFile(inp, &inputSize);
+
+    fclose(inp);
+
+    if(!input)
+    {
+        fprintf(stderr, "Could not read \"%s\"\n", inputPath);
+        return -1;
+    }
+
+    int fd = connectToPath(socketPath);
+
+    if(fd < 0)
+    {
+        fprintf(stderr, "Could not connect to \"%s\"\n", socketPath);
+        free(input);
+        return -1;
+    }
+
+    FILE* outp = fopen(outputPath, options.toBinary ? "wb" : "w");
+    int ret = -1;
+
+    if(!outp)
+        fprintf(stderr, "Could not open \"%s\"\n", outputPath);
+    else
+    {
+        ret = sendRequest(fd, input, inputSize, options, outp);
+
+        if(ret != 0)
+            fprintf(stderr, "The server on \"%s\" could not parse \"%s\"\n", socketPath, inputPath);
+
+        if(fclose(outp) != 0)
+        {
+            fprintf(stderr, "Could not write \"%s\"\n", outputPath);
+            ret = -1;
+        }
+    }
+
+    close(fd);
+    free(input);
+
+    return ret;
+}
@@ -0,0 +1,83 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <stdint.h>
+#include "batch.h"
+
+/**
+ * Parser daemon on a Unix socket, which parses the inputs that its clients
+ * .. send, so that a build that parses very many small files does not pay
+ * .. for starting a process and setting up a parser for each one.
+ *
+ * A client sends requests on its connection, one after another, and the
+ * .. server answers each one before reading the next one. All the integers
+ * .. are in host byte order.
+ * request  : magic "PL0Q", uint32 ParseRequestFlags, uint64 size of the
+ *            input, then the input, which is anything parser.out reads: a
+ *            token list as text or in the binary format, or PL/0 source
+ * response : magic "PL0A", int32 error code of the verdict, which is -1 if
+ *            the input could not be parsed, uint64 size of the output, then
+ *            the output, which is what parser.out would write to its output
+ *            file
+ * The server closes a connection that sends anything else.
+ *
+ * Each worker of the server serves one connection at a time, with a parser
+ * .. context, an arena and buffers of its own, which are kept across its
+ * .. requests and connections.
+ * */
+#define PARSE_REQUEST_MAGIC "PL0Q"
+#define PARSE_RESPONSE_MAGIC "PL0A"
+
+// Largest input a request may send
+#define MAX_PARSE_REQUEST_SIZE ((uint64_t)1 << 30)
+
+/**
+ * Options of a request, which are the flags of the same names. The symbol
+ * .. table is written as text unless SYMBOLS_TSV or SYMBOLS_CSV is set, and
+ * .. the symbols are never exported, as the server has no output path.
+ * */
+typedef enum {
+    PARSE_REQUEST_QUIET = 1 << 0,
+    PARSE_REQUEST_RECOVER = 1 << 1,
+    PARSE_REQUEST_AST = 1 << 2,
+    PARSE_REQUEST_FOLD = 1 << 3,
+    PARSE_REQUEST_CODE = 1 << 4,
+    PARSE_REQUEST_ITERATIVE = 1 << 5,
+    PARSE_REQUEST_TO_BINARY = 1 << 6,
+    PARSE_REQUEST_SYMBOLS_TSV = 1 << 7,
+    PARSE_REQUEST_SYMBOLS_CSV = 1 << 8
+} ParseRequestFlags;
+
+typedef struct {
+    char magic[4];
+    uint32_t flags;
+    uint64_t inputSize;
+} ParseRequestHeader;
+
+typedef struct {
+    char magic[4];
+    int32_t err;
+    uint64_t outputSize;
+} ParseResponseHeader;
+
+/**
+ * Serves the requests of the clients on the Unix socket at the given path,
+ * .. with the given number of workers, or one per online CPU if it is not
+ * .. positive, till SIGINT or SIGTERM. The requests are parsed with the given
+ * .. options, except for the ones the requests have flags for.
+ * A socket file that no server listens on any more is replaced.
+ * Returns 0 once stopped, after the requests being served are answered, or
+ * .. -1 if the socket cannot be listened on.
+ * */
+int runServer(const char* socketPath, int numberOfWorkers, ParseOptions);
+
+/**
+ * Sends the file at inputPath to the server on the Unix socket at the given
+ * .. path, with the flags of the given options, and writes the output to
+ * .. the file at outputPath.
+ * Returns 0 on success, -1 if the files cannot be opened or the server
+ * .. cannot be reached or fails.
+ * */
+int runClient(const char* socketPath, const char* inputPath, const char* outputPath, ParseOptions);
+
+#endif
@@ -0,0 +1,113 @@
+#include "sink.h"
+#include <stdlib.h>
+#include <stdarg.h>
+
+void initSink(Sink* sink, FILE* out)
+{
+    sink->out = out;
+    sink->length = 0;
+    sink->memory = 0;
+    sink->buffer = (char*)malloc(SINK_BUFFER_SIZE);
+
+    // Without a buffer, every write goes directly to the FILE
+    sink->capacity = sink->buffer ? SINK_BUFFER_SIZE : 0;
+}
+
+void initMemorySink(Sink* sink, size_t capacity)
+{
+    sink->out = NULL;
+    sink->length = 0;
+    sink->memory = 1;
+    sink->buffer = capacity ? (char*)malloc(capacity) : NULL;
+    sink->capacity = sink->buffer ? capacity : 0;
+}
+
+void deleteSink(Sink* sink)
+{
+    if(!sink) return;
+
+    flushSink(sink);
+
+    if(sink->buffer)
+        free(sink->buffer);
+
+    sink->buffer = NULL;
+    sink->capacity = 0;
+}
+
+void flushSink(Sink* sink)
+{
+    if(!sink || !sink->length || sink->memory) return;
+
+    if(sink->out)
+        fwrite(sink->buffer, 1, sink->length, sink->out);
+
+    sink->length = 0;
+}
+
+void writeSinkSlow(Sink* sink, const char* data, size_t length)
+{
+    if(sink->memory)
+    {
+        size_t capacity = sink->capacity ? sink->capacity : 256;
+
+        while(capacity - sink->length < length) capacity *= 2;
+
+        char* buffer = (char*)realloc(sink->buffer, capacity);
+
+        if(!buffer) return;
+
+        memcpy(buffer + sink->length, data, length);
+
+        sink->buffer = buffer;
+        sink->capacity = capacity;
+        sink->length += length;
+
+        return;
+    }
+
+    flushSink(sink);
+
+    // Buffer the data if it fits, otherwise write it through
+    if(length < sink->capacity)
+    {
+        memcpy(sink->buffer, data, length);
+        sink->length = length;
+    }
+    else if(sink->out)
+    {
+        fwrite(data, 1, length, sink->out);
+    }
+}
+
+void printfSink(Sink* sink, const char* format, ...)
+{
+    char buffer[256];
+
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if(length < 0) return;
+
+    if((size_t)length < sizeof(buffer))
+    {
+        writeSink(sink, buffer, length);
+        return;
+    }
+
+    // Format again into a buffer that is large enough
+    char* large = (char*)malloc(length + 1);
+
+    if(!large) return;
+
+    va_start(args, format);
+    vsnprintf(large, length + 1, format, args);
+    va_end(args);
+
+    writeSink(sink, large, length);
+
+    free(large);
+}
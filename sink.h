@@ -0,0 +1,82 @@
+#ifndef __SINK_H__
+#define __SINK_H__
+
+#include <stdio.h>
+#include <string.h>
+
+#define SINK_BUFFER_SIZE (1 << 16)
+
+/**
+ * Buffered output sink. Writes are appended to a large user-space buffer,
+ * .. which is written to the FILE in big blocks once it fills up.
+ * A memory sink has no FILE, and its buffer grows to hold all the writes
+ * .. instead, so that its length bytes are everything written to it.
+ * */
+typedef struct {
+    FILE* out;
+    char* buffer;
+    size_t length;
+    size_t capacity;
+    int memory;
+} Sink;
+
+/**
+ * Initializes the given sink to write to the given FILE
+ * */
+void initSink(Sink*, FILE*);
+
+/**
+ * Initializes the given sink as a memory sink whose buffer starts with the
+ * .. given capacity. Writes that cannot grow the buffer are dropped.
+ * */
+void initMemorySink(Sink*, size_t capacity);
+
+/**
+ * Flushes the given sink and makes the necessary deallocations on it
+ * */
+void deleteSink(Sink*);
+
+/**
+ * Writes the buffered content of the given sink to its FILE. Memory sinks
+ * .. keep their content.
+ * */
+void flushSink(Sink*);
+
+/**
+ * Writes the given data directly to the FILE of the given sink after
+ * .. flushing it, or grows the buffer of a memory sink to hold it. Used by
+ * .. writeSink() for large data or a full buffer.
+ * */
+void writeSinkSlow(Sink*, const char*, size_t);
+
+/**
+ * Appends the output of printf() with the given format and arguments to
+ * .. the sink.
+ * */
+void printfSink(Sink*, const char*, ...);
+
+/**
+ * Appends given number of characters from the given data to the sink
+ * */
+static inline void writeSink(Sink* sink, const char* data, size_t length)
+{
+    if(sink->capacity - sink->length >= length)
+    {
+        memcpy(sink->buffer + sink->length, data, length);
+        sink->length += length;
+    }
+    else
+    {
+        writeSinkSlow(sink, data, length);
+    }
+}
+
+/**
+ * Appends the given null terminated string to the sink
+ * */
+static inline void writeSinkString(Sink* sink, const char* str)
+{
+    writeSink(sink, str, strlen(str));
+}
+
+#endif
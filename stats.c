@@ -0,0 +1,113 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+#if PARSER_STATS_ENABLED
+__thread AllocationStats allocationStats;
+#endif
+
+/**
+ * Line of JSON being built, which is cut short rather than overflowing
+ * */
+#define MAX_STATS_LINE_LENGTH 2048
+
+typedef struct {
+    char text[MAX_STATS_LINE_LENGTH];
+    size_t length;
+} StatsLine;
+
+static void appendStats(StatsLine* line, const char* format, ...)
+{
+    if(line->length >= MAX_STATS_LINE_LENGTH) return;
+
+    va_list args;
+    va_start(args, format);
+
+    int length = vsnprintf(line->text + line->length, MAX_STATS_LINE_LENGTH - line->length, format, args);
+
+    va_end(args);
+
+    if(length > 0) line->length += (size_t)length;
+}
+
+/**
+ * Appends the given string as a JSON string
+ * */
+static void appendStatsString(StatsLine* line, const char* str)
+{
+    appendStats(line, "\"");
+
+    for(; *str; str++)
+    {
+        unsigned char c = (unsigned char)*str;
+
+        if(c == '"' || c == '\\') appendStats(line, "\\%c", c);
+        else if(c < 0x20)         appendStats(line, "\\u%04x", c);
+        else                      appendStats(line, "%c", c);
+    }
+
+    appendStats(line, "\"");
+}
+
+AllocationStats getAllocationStats()
+{
+#if PARSER_STATS_ENABLED
+    return allocationStats;
+#else
+    AllocationStats stats = { 0, 0 };
+    return stats;
+#endif
+}
+
+double getStatsSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void printRunStats(const RunStats* stats, FILE* out)
+{
+    StatsLine line;
+    line.length = 0;
+
+    appendStats(&line, "{\"input\": ");
+    appendStatsString(&line, stats->input);
+
+    appendStats(&line, ", \"error\": %d, \"tokens\": %ld, \"symbols\": %d, \"cached\": %s",
+                stats->err, stats->parser.tokens, stats->symbols, stats->cached ? "true" : "false");
+
+    appendStats(&line, ", \"phases\": {\"load_ms\": %.3f, \"parse_ms\": %.3f, \"emit_ms\": %.3f, \"code_ms\": %.3f}",
+                stats->loadSeconds * 1e3, stats->parseSeconds * 1e3, stats->emitSeconds * 1e3, stats->codeSeconds * 1e3);
+
+    if(PARSER_STATS_ENABLED)
+    {
+        appendStats(&line, ", \"counters\": {\"calls\": {");
+
+        for(int nonTerminal = PROGRAM; nonTerminal <= FACTOR; nonTerminal++)
+        {
+            appendStats(&line, "%s\"%s\": %ld", nonTerminal == PROGRAM ? "" : ", ",
+                        nonTerminalNames[nonTerminal], stats->parser.calls[nonTerminal]);
+        }
+
+        appendStats(&line, "}, \"max_depth\": %d, \"allocations\": %ld, \"reallocations\": %ld}",
+                    stats->parser.maxDepth, stats->allocations.allocations, stats->allocations.reallocations);
+    }
+    else
+        appendStats(&line, ", \"counters\": null");
+
+    appendStats(&line, "}\n");
+
+    // A line that did not fit is cut short, but still ends the line
+    if(line.length >= MAX_STATS_LINE_LENGTH)
+    {
+        line.length = MAX_STATS_LINE_LENGTH - 1;
+        line.text[line.length - 1] = '\n';
+    }
+
+    fwrite(line.text, 1, line.length, out);
+}
@@ -0,0 +1,115 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include "data.h"
+
+/**
+ * Instrumentation of a run of the parser on a file, which --stats writes as
+ * .. a line of JSON to stderr, see printRunStats().
+ *
+ * The times of the phases and the sizes of the parse are taken once per
+ * .. file, off the hot paths, so they are always there. The counters of the
+ * .. hot paths, which are the calls of the non-terminals, the depth of the
+ * .. parse and the allocations, are only compiled in if PARSER_STATS is
+ * .. defined, as `make STATS=1` does. Otherwise, the STATS_* macros below
+ * .. compile to nothing, and the counters are written as null.
+ * */
+#ifdef PARSER_STATS
+#define PARSER_STATS_ENABLED 1
+#else
+#define PARSER_STATS_ENABLED 0
+#endif
+
+/**
+ * Counters of a parse, which the ParserContext of the parse keeps.
+ * tokens   : the tokens the parse consumed, which is set once it ends
+ * calls    : the calls of the function of each non-terminal, or the frames
+ *            of each one that an iterative parse pushed
+ * depth    : the non-terminals the parse is in
+ * maxDepth : the most non-terminals the parse was in at once
+ * */
+typedef struct {
+    long tokens;
+    long calls[FACTOR + 1];
+    int depth;
+    int maxDepth;
+} ParserStats;
+
+/**
+ * Allocation counters of a thread.
+ * allocations   : blocks that arenas allocated from the heap, and tables
+ *                 that arenaRealloc() allocated from the heap
+ * reallocations : tables that arenaRealloc() resized, in an arena or in the
+ *                 heap, and parse stacks that grew
+ * */
+typedef struct {
+    long allocations;
+    long reallocations;
+} AllocationStats;
+
+#if PARSER_STATS_ENABLED
+
+// Each thread counts its own allocations, so no locks are taken
+extern __thread AllocationStats allocationStats;
+
+#define STATS_COUNT(statement) do { statement; } while(0)
+
+#else
+
+#define STATS_COUNT(statement) ((void)0)
+
+#endif
+
+#define STATS_ALLOCATION() STATS_COUNT(allocationStats.allocations++)
+#define STATS_REALLOCATION() STATS_COUNT(allocationStats.reallocations++)
+
+/**
+ * Returns the allocation counters of the calling thread, which are all 0 if
+ * .. they are not compiled in
+ * */
+AllocationStats getAllocationStats();
+
+/**
+ * What --stats writes about a file.
+ * input       : path of the file
+ * err         : the error code of the verdict, of the lexer or the parser
+ * symbols     : the symbols in the symbol table after the parse
+ * cached      : not 0 if the output was taken from the parse cache, in which
+ *               case nothing was parsed, and emit is the time of looking it
+ *               up and writing it
+ * *Seconds    : times of the phases. load is reading the tokens, or opening
+ *               the stream of a streamed parse, whose tokens are read while
+ *               parsing. parse is parser_ctx(), emit is writing the tree,
+ *               the verdict and the rest of the buffered output, and code is
+ *               generating and running the code
+ * parser      : counters of the parse
+ * allocations : allocations that the thread made during the run
+ * */
+typedef struct {
+    const char* input;
+    int err;
+    int symbols;
+    int cached;
+
+    double loadSeconds;
+    double parseSeconds;
+    double emitSeconds;
+    double codeSeconds;
+
+    ParserStats parser;
+    AllocationStats allocations;
+} RunStats;
+
+/**
+ * Returns the time of a monotonic clock in seconds
+ * */
+double getStatsSeconds();
+
+/**
+ * Writes the given stats as one line of JSON to the given file at once, so
+ * .. that the lines of concurrent runs do not mix.
+ * */
+void printRunStats(const RunStats*, FILE*);
+
+#endif
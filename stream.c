@@ -0,0 +1,303 @@
+#include "stream.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Reads more of the input into the buffer of the given stream, after moving
+ * .. the characters that are not consumed yet to its beginning.
+ * */
+static void fillStreamBuffer(TokenStream* stream)
+{
+    size_t remaining = stream->length - stream->start;
+
+    memmove(stream->buffer, stream->buffer + stream->start, remaining);
+
+    stream->start = 0;
+    stream->length = remaining;
+
+    while(!stream->atEnd && stream->length < TOKEN_STREAM_BUFFER_SIZE)
+    {
+        size_t read = fread(stream->buffer + stream->length, 1, TOKEN_STREAM_BUFFER_SIZE - stream->length, stream->in);
+
+        if(read == 0) stream->atEnd = 1;
+
+        stream->length += read;
+    }
+}
+
+/**
+ * Produces the next chunk of the given stream into the given chunk.
+ * Only called by the producer, which is the only one to touch the input.
+ * */
+static void produceTokenChunk(TokenStream* stream, TokenChunk* chunk)
+{
+    chunk->numberOfTokens = 0;
+    chunk->end = 0;
+    chunk->err = 0;
+
+    while(!chunk->end && chunk->numberOfTokens < TOKEN_CHUNK_SIZE)
+    {
+        // Keep at least half a buffer of the input ahead
+        if(!stream->atEnd && stream->length - stream->start < TOKEN_STREAM_BUFFER_SIZE / 2)
+            fillStreamBuffer(stream);
+
+        if(!stream->formatKnown)
+        {
+            size_t headerLength = sizeof(TOKEN_LIST_HEADER) - 1;
+
+            stream->isSource = stream->length >= headerLength ?
+                               memcmp(stream->buffer, TOKEN_LIST_HEADER, headerLength) != 0 :
+                               stream->length > 0;
+
+            // Skip the header of a token list
+            if(!stream->isSource)
+                stream->start = stream->length < TOKEN_LIST_HEADER_LENGTH ? stream->length : TOKEN_LIST_HEADER_LENGTH;
+
+            stream->formatKnown = 1;
+        }
+
+        const char* p = stream->buffer + stream->start;
+        size_t available = stream->length - stream->start;
+
+        size_t consumed = stream->isSource ?
+                          lexChunk(&stream->lexer, p, available, stream->atEnd, chunk) :
+                          scanTokenChunk(p, available, stream->atEnd, chunk);
+
+        stream->start += consumed;
+
+        // A token that does not fit in the buffer ends the input
+        if(!chunk->end && chunk->numberOfTokens < TOKEN_CHUNK_SIZE && consumed == 0 &&
+           available == TOKEN_STREAM_BUFFER_SIZE)
+        {
+            stream->atEnd = 1;
+        }
+    }
+}
+
+static void* runTokenStreamProducer(void* arg)
+{
+    TokenStream* stream = arg;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&stream->lock);
+
+        while(stream->count == TOKEN_STREAM_CHUNKS && !stream->stop)
+            pthread_cond_wait(&stream->notFull, &stream->lock);
+
+        if(stream->stop)
+        {
+            pthread_mutex_unlock(&stream->lock);
+            break;
+        }
+
+        // The parser never touches the chunks that are not produced yet
+        TokenChunk* chunk = &stream->chunks[(stream->head + stream->count) % TOKEN_STREAM_CHUNKS];
+
+        pthread_mutex_unlock(&stream->lock);
+
+        produceTokenChunk(stream, chunk);
+
+        pthread_mutex_lock(&stream->lock);
+
+        stream->count++;
+        pthread_cond_signal(&stream->notEmpty);
+
+        pthread_mutex_unlock(&stream->lock);
+
+        if(chunk->end) break;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+
+    stream->producerDone = 1;
+    pthread_cond_signal(&stream->notEmpty);
+
+    pthread_mutex_unlock(&stream->lock);
+
+    return NULL;
+}
+
+/**
+ * Returns the next chunk of the given stream, waiting for the producer if
+ * .. needed, or NULL if no chunk is left. The chunk stays valid until
+ * .. releaseTokenChunk().
+ * */
+static TokenChunk* takeTokenChunk(TokenStream* stream)
+{
+    if(!stream->hasProducer)
+    {
+        if(stream->producerDone) return NULL;
+
+        produceTokenChunk(stream, &stream->chunks[0]);
+
+        stream->producerDone = stream->chunks[0].end;
+
+        return &stream->chunks[0];
+    }
+
+    pthread_mutex_lock(&stream->lock);
+
+    while(stream->count == 0 && !stream->producerDone)
+        pthread_cond_wait(&stream->notEmpty, &stream->lock);
+
+    TokenChunk* chunk = stream->count ? &stream->chunks[stream->head] : NULL;
+
+    pthread_mutex_unlock(&stream->lock);
+
+    return chunk;
+}
+
+static void releaseTokenChunk(TokenStream* stream)
+{
+    if(!stream->hasProducer) return;
+
+    pthread_mutex_lock(&stream->lock);
+
+    stream->head = (stream->head + 1) % TOKEN_STREAM_CHUNKS;
+    stream->count--;
+    pthread_cond_signal(&stream->notFull);
+
+    pthread_mutex_unlock(&stream->lock);
+}
+
+/**
+ * Refill function of the token list of a stream
+ * */
+static int refillTokenStream(TokenList* tokenList)
+{
+    TokenStream* stream = tokenList->source;
+
+    tokenList->numberOfTokens = 0;
+    tokenList->ids[0] = 0;
+
+    TokenChunk* chunk = takeTokenChunk(stream);
+
+    if(!chunk) return 0;
+
+    addTokenChunk(tokenList, chunk);
+
+    int end = chunk->end;
+
+    if(end) stream->err = chunk->err;
+
+    releaseTokenChunk(stream);
+
+    return !end;
+}
+
+int openTokenStream(TokenStream* stream, FILE* in, Arena* arena, TokenStreamMode mode)
+{
+    stream->in = in;
+    stream->mode = mode;
+    stream->arena = arena;
+
+    stream->start = 0;
+    stream->length = 0;
+    stream->atEnd = !in;
+
+    stream->formatKnown = 0;
+    stream->isSource = 0;
+    initLexer(&stream->lexer);
+
+    stream->head = 0;
+    stream->count = 0;
+
+    stream->hasProducer = 0;
+    stream->producerDone = 0;
+    stream->stop = 0;
+
+    stream->err = 0;
+
+    // The parser only ever sees this list, which holds one chunk at a time
+    initTokenListInArena(&stream->tokenList, arena);
+    reserveTokenList(&stream->tokenList, TOKEN_CHUNK_SIZE);
+
+    stream->buffer = arenaRealloc(arena, NULL, 0, TOKEN_STREAM_BUFFER_SIZE);
+    stream->chunks = arenaRealloc(arena, NULL, 0, TOKEN_STREAM_CHUNKS * sizeof(TokenChunk));
+
+    if(!stream->buffer || !stream->chunks || stream->tokenList.capacity < TOKEN_CHUNK_SIZE)
+    {
+        closeTokenStream(stream);
+        return -1;
+    }
+
+    stream->tokenList.refill = refillTokenStream;
+    stream->tokenList.source = stream;
+    stream->tokenList.moreTokens = 1;
+
+    if(mode == TOKEN_STREAM_THREADED)
+    {
+        pthread_mutex_init(&stream->lock, NULL);
+        pthread_cond_init(&stream->notEmpty, NULL);
+        pthread_cond_init(&stream->notFull, NULL);
+
+        // Produce inline if no thread can be started
+        stream->hasProducer = pthread_create(&stream->producer, NULL, runTokenStreamProducer, stream) == 0;
+
+        if(!stream->hasProducer)
+        {
+            pthread_cond_destroy(&stream->notFull);
+            pthread_cond_destroy(&stream->notEmpty);
+            pthread_mutex_destroy(&stream->lock);
+        }
+    }
+
+    // Fill the first window
+    stream->tokenList.moreTokens = refillTokenStream(&stream->tokenList);
+
+    return 0;
+}
+
+int drainTokenStream(TokenStream* stream)
+{
+    // The window is not used after the parse, only the error is needed
+    TokenChunk* chunk;
+
+    while(stream->tokenList.moreTokens && (chunk = takeTokenChunk(stream)) != NULL)
+    {
+        if(chunk->end)
+        {
+            stream->err = chunk->err;
+            stream->tokenList.moreTokens = 0;
+        }
+
+        releaseTokenChunk(stream);
+    }
+
+    // No chunk is left once the producer is done
+    stream->tokenList.moreTokens = 0;
+
+    return stream->err;
+}
+
+void closeTokenStream(TokenStream* stream)
+{
+    if(!stream) return;
+
+    if(stream->hasProducer)
+    {
+        pthread_mutex_lock(&stream->lock);
+
+        stream->stop = 1;
+        pthread_cond_signal(&stream->notFull);
+
+        pthread_mutex_unlock(&stream->lock);
+
+        pthread_join(stream->producer, NULL);
+
+        pthread_cond_destroy(&stream->notFull);
+        pthread_cond_destroy(&stream->notEmpty);
+        pthread_mutex_destroy(&stream->lock);
+
+        stream->hasProducer = 0;
+    }
+
+    arenaFree(stream->arena, stream->chunks);
+    arenaFree(stream->arena, stream->buffer);
+
+    stream->chunks = NULL;
+    stream->buffer = NULL;
+
+    deleteTokenList(&stream->tokenList);
+}
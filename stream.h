@@ -0,0 +1,99 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <stdio.h>
+#include <pthread.h>
+#include "token.h"
+#include "lexer.h"
+#include "arena.h"
+
+// Number of the chunks in the ring of a stream
+#define TOKEN_STREAM_CHUNKS 4
+
+// Size of the input buffer of a stream
+#define TOKEN_STREAM_BUFFER_SIZE (64 * 1024)
+
+/**
+ * How the chunks of a stream are produced.
+ * TOKEN_STREAM_INLINE   : on the thread of the parser, whenever it runs out
+ *                         of tokens
+ * TOKEN_STREAM_THREADED : on a producer thread, which lexes ahead of the
+ *                         parser while the ring has room
+ * */
+typedef enum {
+    TOKEN_STREAM_INLINE,
+    TOKEN_STREAM_THREADED
+} TokenStreamMode;
+
+/**
+ * Streams the tokens of a file into a token list that only holds a window of
+ * .. TOKEN_CHUNK_SIZE tokens, see TokenList. The input is read through a
+ * .. fixed buffer and either lexed as PL/0 source or scanned as the output
+ * .. of printTokenList(), so the memory used does not grow with the input,
+ * .. except for the distinct lexemes.
+ *
+ * Chunks are handed from the producer to the parser through a ring of
+ * .. TOKEN_STREAM_CHUNKS chunks. Only the parser touches the token list, so
+ * .. the producer needs no lock on the lexemes.
+ *
+ * tokenList : the window, which is what the parser is given
+ * err       : lexer error code of the consumed tokens, 0 if none
+ * */
+typedef struct {
+    FILE* in;
+    TokenStreamMode mode;
+    Arena* arena;
+
+    // Input buffer, which holds length characters read from in, starting
+    // .. with start consumed ones
+    char* buffer;
+    size_t start;
+    size_t length;
+    int atEnd;
+
+    // Not 0 once it is known if the input is source, which is then lexed
+    int formatKnown;
+    int isSource;
+    Lexer lexer;
+
+    // Ring of the chunks, count of them starting from head are produced
+    TokenChunk* chunks;
+    int head;
+    int count;
+
+    // Producer thread, and the state shared with it under lock
+    pthread_t producer;
+    int hasProducer;
+    int producerDone;
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
+    TokenList tokenList;
+    int err;
+} TokenStream;
+
+/**
+ * Opens a stream on the given file, starting from its current position,
+ * .. which is PL/0 source or a token list in the format printTokenList()
+ * .. writes. Everything is allocated from the given arena, which may be NULL.
+ * The first window of the token list is filled before returning.
+ * Returns 0 on success, -1 if the stream cannot be allocated.
+ * */
+int openTokenStream(TokenStream*, FILE*, Arena*, TokenStreamMode);
+
+/**
+ * Reads the rest of the input of the given stream without keeping the
+ * .. tokens, and returns the lexer error code of the whole input, which is
+ * .. the same as the one readSourceTokenList() gives.
+ * */
+int drainTokenStream(TokenStream*);
+
+/**
+ * Stops the producer of the given stream and makes the necessary
+ * .. deallocations. The file is not closed.
+ * */
+void closeTokenStream(TokenStream*);
+
+#endif
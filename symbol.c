@@ -1,77 +1,532 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "symbol.h"
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Capacities of the first allocations made by the symbol table
+#define SYMBOL_TABLE_MIN_CAPACITY 16
+#define SYMBOL_TABLE_MIN_SLOTS 32
 
-void initSymbolTable(SymbolTable* symbolTable)
+void initSymbolTable(SymbolTable* symbolTable, const InternPool* names, Arena* arena)
 {
+    symbolTable->names = names;
+    symbolTable->arena = arena;
+
     symbolTable->symbols = NULL;
+    symbolTable->shadowed = NULL;
     symbolTable->numberOfSymbols = 0;
+    symbolTable->capacity = 0;
+
+    symbolTable->slots = NULL;
+    symbolTable->numberOfSlots = 0;
+    symbolTable->numberOfNames = 0;
+
+    symbolTable->scopeSymbols = NULL;
+    symbolTable->numberOfScopeSymbols = 0;
+
+    symbolTable->scopeStarts = NULL;
+    symbolTable->numberOfScopes = 0;
+    symbolTable->scopeCapacity = 0;
 }
 
 void deleteSymbolTable(SymbolTable* symbolTable)
 {
     if(!symbolTable) return;
 
-    if(symbolTable->symbols)
-        free(symbolTable->symbols);
+    arenaFree(symbolTable->arena, symbolTable->symbols);
+    arenaFree(symbolTable->arena, symbolTable->shadowed);
+    arenaFree(symbolTable->arena, symbolTable->slots);
+    arenaFree(symbolTable->arena, symbolTable->scopeSymbols);
+    arenaFree(symbolTable->arena, symbolTable->scopeStarts);
 
-    symbolTable->symbols = NULL;
-    symbolTable->numberOfSymbols = 0;
+    initSymbolTable(symbolTable, symbolTable->names, symbolTable->arena);
+}
+
+/**
+ * Multiplicative hash of the given name id.
+ * */
+static unsigned int hashName(int name)
+{
+    return (unsigned int)name * 2654435761u;
+}
+
+/**
+ * Returns the slot of the given name, which is either the slot the name is
+ * .. stored in or the empty slot it would be stored in. The table should
+ * .. have at least one empty slot.
+ * */
+static SymbolSlot* findSlot(SymbolTable* symbolTable, int name)
+{
+    unsigned int mask = symbolTable->numberOfSlots - 1;
+
+    for(unsigned int i = hashName(name) & mask; ; i = (i + 1) & mask)
+    {
+        SymbolSlot* slot = &symbolTable->slots[i];
+
+        if(slot->name < 0 || slot->name == name)
+            return slot;
+    }
+}
+
+/**
+ * Doubles the number of slots of the hash index and reinserts the names.
+ * Returns 0 if the allocation failed.
+ * */
+static int growSlots(SymbolTable* symbolTable)
+{
+    int numberOfSlots = symbolTable->numberOfSlots ? symbolTable->numberOfSlots * 2 : SYMBOL_TABLE_MIN_SLOTS;
+
+    SymbolSlot* slots = (SymbolSlot*)arenaRealloc(symbolTable->arena, NULL, 0, numberOfSlots * sizeof(SymbolSlot));
+
+    if(!slots) return 0;
+
+    for(int i = 0; i < numberOfSlots; i++)
+        slots[i].name = -1;
+
+    SymbolSlot* oldSlots = symbolTable->slots;
+    int oldNumberOfSlots = symbolTable->numberOfSlots;
+
+    symbolTable->slots = slots;
+    symbolTable->numberOfSlots = numberOfSlots;
+
+    for(int i = 0; i < oldNumberOfSlots; i++)
+    {
+        if(oldSlots[i].name < 0) continue;
+
+        *findSlot(symbolTable, oldSlots[i].name) = oldSlots[i];
+    }
+
+    arenaFree(symbolTable->arena, oldSlots);
+
+    return 1;
+}
+
+/**
+ * Makes sure the table can hold the given number of symbols.
+ * Returns 0 if the allocation failed.
+ * */
+static int reserveSymbols(SymbolTable* symbolTable, int numberOfSymbols)
+{
+    if(numberOfSymbols <= symbolTable->capacity)
+        return 1;
+
+    Arena* arena = symbolTable->arena;
+    int oldCapacity = symbolTable->capacity;
+    int capacity = oldCapacity ? oldCapacity * 2 : SYMBOL_TABLE_MIN_CAPACITY;
+
+    if(capacity < numberOfSymbols)
+        capacity = numberOfSymbols;
+
+    Symbol* symbols = (Symbol*)arenaRealloc(arena, symbolTable->symbols, oldCapacity * sizeof(Symbol), capacity * sizeof(Symbol));
+    if(!symbols) return 0;
+    symbolTable->symbols = symbols;
+
+    int* shadowed = (int*)arenaRealloc(arena, symbolTable->shadowed, oldCapacity * sizeof(int), capacity * sizeof(int));
+    if(!shadowed) return 0;
+    symbolTable->shadowed = shadowed;
+
+    // There cannot be more symbols in open scopes than symbols
+    int* scopeSymbols = (int*)arenaRealloc(arena, symbolTable->scopeSymbols, oldCapacity * sizeof(int), capacity * sizeof(int));
+    if(!scopeSymbols) return 0;
+    symbolTable->scopeSymbols = scopeSymbols;
+
+    symbolTable->capacity = capacity;
+
+    return 1;
+}
+
+/**
+ * Makes sure one more symbol can be added to the table.
+ * Returns 0 if the allocation failed.
+ * */
+static int reserveSymbol(SymbolTable* symbolTable)
+{
+    return reserveSymbols(symbolTable, symbolTable->numberOfSymbols + 1);
 }
 
 Symbol* addSymbol(SymbolTable* symbolTable, Symbol symbol)
 {
     if(!symbolTable) return NULL;
 
-    symbolTable->numberOfSymbols++;
+    // Keep the load factor of the hash index below 1/2
+    if(!reserveSymbol(symbolTable) ||
+       ((symbolTable->numberOfNames + 1) * 2 > symbolTable->numberOfSlots && !growSlots(symbolTable)))
+        return NULL;
+
+    int ind = symbolTable->numberOfSymbols++;
+
+    symbolTable->symbols[ind] = symbol;
+
+    symbolTable->scopeSymbols[symbolTable->numberOfScopeSymbols++] = ind;
 
-    symbolTable->symbols = (Symbol*)realloc(symbolTable->symbols, (symbolTable->numberOfSymbols) * sizeof(Symbol));
+    // A symbol without a name cannot be looked up
+    if(symbol.name < 0)
+    {
+        symbolTable->shadowed[ind] = -1;
+        return &symbolTable->symbols[ind];
+    }
+
+    // Make the name refer to the new symbol, hiding the previous declaration
+    SymbolSlot* slot = findSlot(symbolTable, symbol.name);
+
+    if(slot->name < 0)
+    {
+        slot->name = symbol.name;
+        slot->visible = -1;
+        symbolTable->numberOfNames++;
+    }
+
+    symbolTable->shadowed[ind] = slot->visible;
+    slot->visible = ind;
+
+    return &symbolTable->symbols[ind];
+}
+
+int replaceSymbols(SymbolTable* symbolTable, int first, int removed, const Symbol* symbols, int count)
+{
+    if(!symbolTable || first < 0 || removed < 0 || count < 0 || first + removed > symbolTable->numberOfSymbols)
+        return -1;
+
+    int end = first + removed;
+    int delta = count - removed;
+
+    if(!reserveSymbols(symbolTable, symbolTable->numberOfSymbols + delta))
+        return -1;
+
+    int moved = symbolTable->numberOfSymbols - end;
+
+    memmove(&symbolTable->symbols[first + count], &symbolTable->symbols[end], moved * sizeof(Symbol));
+    memmove(&symbolTable->shadowed[first + count], &symbolTable->shadowed[end], moved * sizeof(int));
+
+    // The new symbols are in a closed scope, so they hide nothing
+    for(int i = 0; i < count; i++)
+    {
+        symbolTable->symbols[first + i] = symbols[i];
+        symbolTable->shadowed[first + i] = -1;
+    }
+
+    symbolTable->numberOfSymbols += delta;
+
+    if(delta == 0) return 0;
+
+    // Renumber the references to the moved symbols
+    for(int i = 0; i < symbolTable->numberOfSymbols; i++)
+    {
+        if(symbolTable->shadowed[i] >= end)
+            symbolTable->shadowed[i] += delta;
+    }
 
-    symbolTable->symbols[symbolTable->numberOfSymbols - 1] = symbol;
+    for(int i = 0; i < symbolTable->numberOfScopeSymbols; i++)
+    {
+        if(symbolTable->scopeSymbols[i] >= end)
+            symbolTable->scopeSymbols[i] += delta;
+    }
+
+    for(int i = 0; i < symbolTable->numberOfSlots; i++)
+    {
+        if(symbolTable->slots[i].name >= 0 && symbolTable->slots[i].visible >= end)
+            symbolTable->slots[i].visible += delta;
+    }
+
+    return 0;
+}
+
+int enterScope(SymbolTable* symbolTable)
+{
+    if(!symbolTable) return -1;
+
+    if(symbolTable->numberOfScopes == symbolTable->scopeCapacity)
+    {
+        int capacity = symbolTable->scopeCapacity ? symbolTable->scopeCapacity * 2 : SYMBOL_TABLE_MIN_CAPACITY;
+
+        int* scopeStarts = (int*)arenaRealloc(symbolTable->arena, symbolTable->scopeStarts,
+                                              symbolTable->scopeCapacity * sizeof(int), capacity * sizeof(int));
 
-    return &symbolTable->symbols[symbolTable->numberOfSymbols - 1];
+        if(!scopeStarts) return -1;
+
+        symbolTable->scopeStarts = scopeStarts;
+        symbolTable->scopeCapacity = capacity;
+    }
+
+    symbolTable->scopeStarts[symbolTable->numberOfScopes++] = symbolTable->numberOfScopeSymbols;
+
+    return 0;
+}
+
+void exitScope(SymbolTable* symbolTable)
+{
+    if(!symbolTable || !symbolTable->numberOfScopes) return;
+
+    int start = symbolTable->scopeStarts[--symbolTable->numberOfScopes];
+
+    // Restore the hidden declarations, latest declaration first
+    while(symbolTable->numberOfScopeSymbols > start)
+    {
+        int ind = symbolTable->scopeSymbols[--symbolTable->numberOfScopeSymbols];
+
+        if(symbolTable->symbols[ind].name < 0) continue;
+
+        findSlot(symbolTable, symbolTable->symbols[ind].name)->visible = symbolTable->shadowed[ind];
+    }
+}
+
+Symbol* lookupSymbol(SymbolTable* symbolTable, int name)
+{
+    if(!symbolTable || name < 0 || !symbolTable->numberOfSlots) return NULL;
+
+    SymbolSlot* slot = findSlot(symbolTable, name);
+
+    if(slot->name < 0 || slot->visible < 0)
+        return NULL;
+
+    return &symbolTable->symbols[slot->visible];
 }
 
 void printSymbolTable(SymbolTable* symbolTable, FILE* out)
 {
     if(!symbolTable || !out) return;
 
-    fprintf(out, "Symbol Table\n============\n");
+    Sink sink;
+    initSink(&sink, out);
+
+    printSymbolTableToSink(symbolTable, &sink);
+
+    deleteSink(&sink);
+}
+
+void printSymbolTableToSink(SymbolTable* symbolTable, Sink* out)
+{
+    if(!symbolTable || !out) return;
+
+    writeSinkString(out, "Symbol Table\n============\n");
 
     for(int i = 0; i < symbolTable->numberOfSymbols; i++)
     {
-        fprintf(out, "#%d\n", i);
+        printfSink(out, "#%d\n", i);
 
         Symbol* symbol = &(symbolTable->symbols[i]);
 
+        const char* name = symbolTable->names && symbol->name >= 0 ? getInternedString(symbolTable->names, symbol->name) : "";
+
         // print type
         switch(symbol->type)
         {
             case VAR:
-                fprintf(out, 
+                printfSink(out, 
                     "   Type: VAR\n"
                     "   Name: %s\n"
                     "  Level: %d\n",
-                    symbol->name, symbol->level);
+                    name, symbol->level);
                     break;
 
             case CONST:
-                fprintf(out, 
+                printfSink(out, 
                     "   Type: CONST\n"
                     "   Name: %s\n"
                     "  Value: %d\n"
                     "  Level: %d\n",
-                    symbol->name, symbol->value, symbol->level);
+                    name, symbol->value, symbol->level);
                     break;
 
             case PROC:
-                fprintf(out, 
+                printfSink(out, 
                     "   Type: PROC\n"
                     "   Name: %s\n"
                     "  Level: %d\n",
-                    symbol->name, symbol->level);
+                    name, symbol->level);
                     break;
         }
         
-        fprintf(out, "\n");
+        writeSink(out, "\n", 1);
+    }
+}
+
+void printSymbolTableInFormat(SymbolTable* symbolTable, SymbolTableFormat format, Sink* out)
+{
+    if(!symbolTable || !out) return;
+
+    if(format == SYMBOL_TABLE_TEXT)
+    {
+        printSymbolTableToSink(symbolTable, out);
+        return;
+    }
+
+    static const char* typeNames[] = { "CONST", "VAR", "PROC" };
+
+    char separator = format == SYMBOL_TABLE_CSV ? ',' : '\t';
+
+    writeSinkString(out, "Symbol Table\n============\n");
+    printfSink(out, "index%ctype%cname%cvalue%clevel\n", separator, separator, separator, separator);
+
+    for(int i = 0; i < symbolTable->numberOfSymbols; i++)
+    {
+        Symbol* symbol = &(symbolTable->symbols[i]);
+
+        const char* name = symbolTable->names && symbol->name >= 0 ? getInternedString(symbolTable->names, symbol->name) : "";
+
+        printfSink(out, "%d%c%s%c%s%c", i, separator, typeNames[symbol->type], separator, name, separator);
+
+        if(symbol->type == CONST) printfSink(out, "%d", symbol->value);
+
+        printfSink(out, "%c%u\n", separator, symbol->level);
+    }
+}
+
+int writeBinarySymbolTable(SymbolTable* symbolTable, FILE* out)
+{
+    if(!symbolTable || !out || !symbolTable->names) return -1;
+
+    const InternPool* names = symbolTable->names;
+    int n = symbolTable->numberOfSymbols;
+
+    // Offset of each name in the pool plus 1, 0 if it is not in the pool yet,
+    // .. so that a name declared in many scopes is written once
+    uint32_t* nameOffsets = calloc(names->numberOfStrings + 1, sizeof(uint32_t));
+    BinarySymbol* symbols = malloc((n + 1) * sizeof(BinarySymbol));
+
+    if(!nameOffsets || !symbols)
+    {
+        free(nameOffsets);
+        free(symbols);
+        return -1;
     }
-}
\ No newline at end of file
+
+    uint32_t poolSize = 0;
+
+    for(int i = 0; i < n; i++)
+    {
+        const Symbol* symbol = &symbolTable->symbols[i];
+        int name = symbol->name;
+
+        if(name >= 0 && name < names->numberOfStrings && !nameOffsets[name])
+        {
+            nameOffsets[name] = poolSize + 1;
+            poolSize += getInternedStringLength(names, name) + 1;
+        }
+
+        symbols[i].type = symbol->type;
+        symbols[i].value = symbol->type == CONST ? symbol->value : 0;
+        symbols[i].level = symbol->level;
+        symbols[i].name = 0;
+    }
+
+    // Symbols without a name refer to an empty name at the end of the pool
+    uint32_t emptyName = poolSize++;
+
+    for(int i = 0; i < n; i++)
+    {
+        int name = symbolTable->symbols[i].name;
+
+        symbols[i].name = name >= 0 && name < names->numberOfStrings ? nameOffsets[name] - 1 : emptyName;
+    }
+
+    char header[BINARY_SYMBOL_TABLE_HEADER_SIZE];
+    uint16_t version = BINARY_SYMBOL_TABLE_VERSION, reserved = 0;
+    uint32_t numberOfSymbols = (uint32_t)n;
+
+    memcpy(header, BINARY_SYMBOL_TABLE_MAGIC, 4);
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &reserved, 2);
+    memcpy(header + 8, &numberOfSymbols, 4);
+    memcpy(header + 12, &poolSize, 4);
+
+    int err = fwrite(header, 1, sizeof(header), out) != sizeof(header) ||
+              fwrite(symbols, sizeof(BinarySymbol), n, out) != (size_t)n;
+
+    // The names are written in the order they were given offsets in
+    for(int i = 0; i < n && !err; i++)
+    {
+        int name = symbolTable->symbols[i].name;
+
+        if(name < 0 || name >= names->numberOfStrings || symbols[i].name != nameOffsets[name] - 1) continue;
+
+        size_t length = getInternedStringLength(names, name) + 1;
+
+        err = fwrite(getInternedString(names, name), 1, length, out) != length;
+
+        // Only the first symbol of each name writes it
+        nameOffsets[name] = 0;
+    }
+
+    err = err || fputc('\0', out) == EOF;
+
+    free(nameOffsets);
+    free(symbols);
+
+    return err ? -1 : 0;
+}
+
+int mapBinarySymbolTable(FILE* in, BinarySymbolTable* table)
+{
+    memset(table, 0, sizeof(*table));
+
+    struct stat st;
+
+    long start = in ? ftell(in) : -1;
+
+    if(start < 0 || fstat(fileno(in), &st) != 0 || !S_ISREG(st.st_mode) ||
+       st.st_size < start + BINARY_SYMBOL_TABLE_HEADER_SIZE)
+        return -1;
+
+    size_t size = (size_t)st.st_size;
+
+    char* base = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+
+    if(base == MAP_FAILED)
+        return -1;
+
+    const char* header = base + start;
+    size_t available = size - (size_t)start;
+
+    uint16_t version;
+    uint32_t numberOfSymbols, poolSize;
+
+    memcpy(&version, header + 4, 2);
+    memcpy(&numberOfSymbols, header + 8, 4);
+    memcpy(&poolSize, header + 12, 4);
+
+    size_t symbolsSize = (size_t)numberOfSymbols * sizeof(BinarySymbol);
+
+    int valid = memcmp(header, BINARY_SYMBOL_TABLE_MAGIC, 4) == 0 &&
+                version == BINARY_SYMBOL_TABLE_VERSION &&
+                start % 4 == 0 &&
+                numberOfSymbols <= 0x7fffffff &&
+                poolSize > 0 &&
+                BINARY_SYMBOL_TABLE_HEADER_SIZE + symbolsSize + poolSize <= available;
+
+    const BinarySymbol* symbols = (const BinarySymbol*)(header + BINARY_SYMBOL_TABLE_HEADER_SIZE);
+    const char* pool = header + BINARY_SYMBOL_TABLE_HEADER_SIZE + symbolsSize;
+
+    // Every name should be in the pool, which ends with a null, so that
+    // .. each one is terminated
+    if(valid)
+        valid = pool[poolSize - 1] == '\0';
+
+    for(uint32_t i = 0; i < numberOfSymbols && valid; i++)
+        valid = symbols[i].type <= PROC && symbols[i].name < poolSize;
+
+    if(!valid)
+    {
+        munmap(base, size);
+        return -1;
+    }
+
+    table->symbols = symbols;
+    table->numberOfSymbols = (int)numberOfSymbols;
+    table->names = pool;
+    table->namesSize = poolSize;
+    table->mapping = base;
+    table->mappingSize = size;
+
+    return 0;
+}
+
+void unmapBinarySymbolTable(BinarySymbolTable* table)
+{
+    if(table->mapping) munmap(table->mapping, table->mappingSize);
+
+    memset(table, 0, sizeof(*table));
+}
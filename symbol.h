@@ -2,6 +2,11 @@
 #define __SYMBOL_H__
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+#include "arena.h"
+#include "sink.h"
 
 /**
  * There are three possible types of symbols that can be an entry of a symbol table
@@ -20,29 +25,132 @@ typedef enum
  * name   : CONST, VAR, PROC
  * value  : CONST, VAR
  * level  : CONST, VAR, PROC
+ * The name is the id of the identifier in the InternPool of the symbol table.
  * */
 
 typedef struct Symbol Symbol;
 
 struct Symbol { 
 	SymbolType type;
-	char name[12];
+	int name;
 	int value;
 	unsigned int level;
 };
 
+/**
+ * Formats the symbol table can be printed in.
+ * SYMBOL_TABLE_TEXT : a padded block of lines per symbol, for people
+ * SYMBOL_TABLE_TSV  : a line per symbol, with tab separated fields, after a
+ *                     line of the field names, for tools
+ * SYMBOL_TABLE_CSV  : as SYMBOL_TABLE_TSV, with comma separated fields
+ * The fields are the index, the type, the name, the value and the level of
+ * .. the symbol, and the value is empty unless the symbol is a CONST. Names
+ * .. are identifiers, so they never need quoting.
+ * */
+typedef enum
+{
+    SYMBOL_TABLE_TEXT,
+    SYMBOL_TABLE_TSV,
+    SYMBOL_TABLE_CSV
+} SymbolTableFormat;
+
+/**
+ * Binary symbol table format, written by writeBinarySymbolTable() and mapped
+ * .. by mapBinarySymbolTable(), so that tools such as code generators can use
+ * .. the symbols of a parse without reading its output. All the fields are in
+ * .. host byte order.
+ *
+ * header  : magic "PL0S", uint16 version, uint16 reserved (0),
+ *           uint32 number of symbols (n), uint32 size of the name pool
+ * symbols : BinarySymbol[n], in the order of the symbol table
+ * pool    : null terminated names of the symbols, each distinct name once,
+ *           followed by an empty name for the symbols without one
+ * */
+#define BINARY_SYMBOL_TABLE_MAGIC "PL0S"
+#define BINARY_SYMBOL_TABLE_VERSION 1
+#define BINARY_SYMBOL_TABLE_HEADER_SIZE 16
+
+/**
+ * A symbol of the binary symbol table format.
+ * type  : the SymbolType of the symbol
+ * value : the value of the symbol, 0 unless it is a CONST
+ * level : the level of the symbol
+ * name  : offset of the name of the symbol in the name pool
+ * */
+typedef struct {
+    uint32_t type;
+    int32_t value;
+    uint32_t level;
+    uint32_t name;
+} BinarySymbol;
+
+/**
+ * Binary symbol table mapped by mapBinarySymbolTable(), which points into
+ * .. the memory mapped file and is read only.
+ * symbols : the symbols, numberOfSymbols of them
+ * names   : the name pool, namesSize bytes
+ * */
+typedef struct {
+    const BinarySymbol* symbols;
+    int numberOfSymbols;
+    const char* names;
+    size_t namesSize;
+
+    void* mapping;
+    size_t mappingSize;
+} BinarySymbolTable;
+
+/**
+ * Slot of the open addressing hash index of a symbol table.
+ * name    : the name of the slot, -1 if the slot is empty
+ * visible : index of the symbol that the name currently refers to, -1 if
+ *           the name is not declared in any open scope
+ * */
+typedef struct {
+    int name;
+    int visible;
+} SymbolSlot;
+
 /**
  * Symbol table.
+ * symbols keeps every added symbol in insertion order, including the ones
+ * .. of closed scopes, and is what printSymbolTable() prints.
+ * The symbols of the open scopes are indexed by name in slots, where each
+ * .. name refers to its declaration in the nearest enclosing scope. A symbol
+ * .. is linked to the one it hides through shadowed, so that closing a
+ * .. scope can restore the hidden declarations.
+ * scopeSymbols is the stack of the symbols in open scopes, and scopeStarts
+ * .. stores where each open scope, except the global one, begins in it.
+ * names is the pool that the names of the symbols are interned in.
+ * If arena is not NULL, the table allocates from it instead of the heap.
  * */
 typedef struct {
+    const InternPool* names;
+    Arena* arena;
+
     Symbol* symbols;
+    int* shadowed;
     int numberOfSymbols;
+    int capacity;
+
+    SymbolSlot* slots;
+    int numberOfSlots;
+    int numberOfNames;
+
+    int* scopeSymbols;
+    int numberOfScopeSymbols;
+
+    int* scopeStarts;
+    int numberOfScopes;
+    int scopeCapacity;
 } SymbolTable;
 
 /**
- * Initializes the given symbol table to a empty symbol table.
+ * Initializes the given symbol table to a empty symbol table, whose symbol
+ * .. names are interned in the given pool. The table allocates from the
+ * .. given arena, or from the heap if it is NULL.
  * */
-void initSymbolTable(SymbolTable*);
+void initSymbolTable(SymbolTable*, const InternPool*, Arena*);
 
 /**
  * Destructs the symbol table by making necessary deallocations on the members
@@ -51,13 +159,87 @@ void initSymbolTable(SymbolTable*);
 void deleteSymbolTable(SymbolTable*);
 
 /**
- * Appends a copy of the given symbol to the given symbol table.
+ * Appends a copy of the given symbol to the given symbol table, declaring
+ * .. it in the current scope.
+ * The returned pointer is valid until the next symbol is added.
  * */
 Symbol* addSymbol(SymbolTable*, Symbol);
 
+/**
+ * Replaces the given number of symbols from the given index on with the
+ * .. given number of the given symbols, keeping the order of the others.
+ * The replaced symbols should all be in closed scopes, as the symbols of a
+ * .. procedure are once it is parsed, and the new ones are added to a closed
+ * .. scope. The symbols after the replaced ones move by the difference in
+ * .. number, and the table is renumbered accordingly; their other users, such
+ * .. as trees, are not.
+ * Returns 0 on success, -1 if the range is not in the table or the
+ * .. allocation failed, in which case the table is not changed.
+ * */
+int replaceSymbols(SymbolTable*, int first, int removed, const Symbol*, int count);
+
+/**
+ * Opens a new scope nested in the current one.
+ * Returns 0 on success, -1 if the allocation failed, in which case no scope
+ * .. is opened, and the matching exitScope() should not be called.
+ * */
+int enterScope(SymbolTable*);
+
+/**
+ * Closes the current scope at once. Names declared in it refer again to
+ * .. their declarations in the enclosing scopes, if any. The symbols stay
+ * .. in the table and are still printed.
+ * Closing the global scope has no effect.
+ * */
+void exitScope(SymbolTable*);
+
+/**
+ * Returns the declaration of the given name in the nearest enclosing scope,
+ * .. or NULL if the name is not declared in any open scope.
+ * The returned pointer is valid until the next symbol is added.
+ * */
+Symbol* lookupSymbol(SymbolTable*, int);
+
 /**
  * Given symbol table, prints the entries of symbol table to the given file.
  * */
 void printSymbolTable(SymbolTable*, FILE*);
 
+/**
+ * Given symbol table, prints the entries of symbol table to the given sink.
+ * */
+void printSymbolTableToSink(SymbolTable*, Sink*);
+
+/**
+ * Same as printSymbolTableToSink(), in the given format.
+ * */
+void printSymbolTableInFormat(SymbolTable*, SymbolTableFormat, Sink*);
+
+/**
+ * Writes the given symbol table to the given file in the binary symbol table
+ * .. format. Returns 0 on success, -1 if the file cannot be written or the
+ * .. table has no names pool.
+ * */
+int writeBinarySymbolTable(SymbolTable*, FILE*);
+
+/**
+ * Memory maps a binary symbol table from the given file, starting from its
+ * .. current position, which should be a multiple of 4.
+ * Returns 0 on success, -1 if the file is not a valid binary symbol table.
+ * */
+int mapBinarySymbolTable(FILE*, BinarySymbolTable*);
+
+/**
+ * Releases the mapping of the given binary symbol table
+ * */
+void unmapBinarySymbolTable(BinarySymbolTable*);
+
+/**
+ * Returns the name of the given symbol of the given binary symbol table
+ * */
+static inline const char* getBinarySymbolName(const BinarySymbolTable* table, const BinarySymbol* symbol)
+{
+    return table->names + symbol->name;
+}
+
 #endif
\ No newline at end of file
@@ -1,5 +1,9 @@
 tests="tests_grader.txt"
+recover_tests="tests_recover.txt"
 parser="../parser.out"
+gen="../bench/gen.out"
+symbols="../bench/symbols.out"
+token_copy_test="./token_copy_test.out"
 EMPH='\033[1;31m'
 DEEMPH='\033[0m'
 
@@ -8,46 +12,193 @@ passed=0
 failed=0
 
 # check if parser.out and tests_grader.txt exists
-if [[ -e $parser && -e $tests ]] ; then
-    echo "$parser and $tests are found. Starting tests.."
+if [[ -e $parser && -e $tests && -e $gen && -e $symbols && -e $token_copy_test ]] ; then
+    echo "$parser, $gen, $symbols, $token_copy_test and $tests are found. Starting tests.."
 else
-    echo "$parser or $tests could not be found! Aborting.."
+    echo "$parser, $gen, $symbols, $token_copy_test or $tests could not be found! Aborting.."
     exit
 fi
 
-while read inp out gt_out ; do
-    # create directories if needed
-    out_dir=$(dirname "$out")
-    mkdir -p "$out_dir"
-    
-    # run the parser
-    ./"$parser" "$inp" "$out"
-    
-    # compare the output with ground truth
-    _diff="$(diff -B -w $out $gt_out)"
-    
+# the generated programs and the outputs of the steps that do not keep them
+tmp_dir="$(mktemp -d)"
+trap 'rm -rf "$tmp_dir"' EXIT
+
+# compares the output of a test with its ground truth
+# usage: check_output (output) (ground truth) (command to run it yourself)
+check_output() {
+    _diff="$(diff -B -w "$1" "$2")"
+
     if [[ $_diff ]] ; then
         # sad.. difference found
         echo "TEST $i FAILED"
         let failed=$failed+1
-        
-        echo "   There is difference between $out and $gt_out:"
+
+        echo "   There is difference between $1 and $2:"
         echo "==================================================="
         echo $_diff
         echo "==================================================="
         echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
-        echo "  (cd test/; ./\"$parser\" \"$inp\" \"$out\")"
-        echo "The output is in \"test/$out\""
+        echo "  (cd test/; $3)"
+        [[ $1 == "$tmp_dir"/* ]] || echo "The output is in \"test/$1\""
     else
         # yay! test passed
         echo "TEST $i PASSED"
         let passed=$passed+1
     fi
-    
+
     let i=$i+1
+}
 
+# checks that a command exited with 0, after writing the success message
+# usage: check_success (exit status) (output) (command to run it yourself)
+check_success() {
+    if [[ $1 -ne 0 ]] || ! grep -q "PARSING WAS SUCCESSFUL" "$2" ; then
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "   The parser exited with $1, and \"$2\" has no success message"
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo "  (cd test/; $3)"
+    else
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+
+    let i=$i+1
+}
+
+# runs the parser with the given options on each test of the given file
+# usage: run_tests (tests file) [options..]
+run_tests() {
+    local tests_file="$1"
+    shift
+
+    while read inp out gt_out ; do
+        # create directories if needed
+        out_dir=$(dirname "$out")
+        mkdir -p "$out_dir"
+
+        # run the parser
+        ./"$parser" "$@" "$inp" "$out"
+
+        # compare the output with ground truth
+        check_output "$out" "$gt_out" "./\"$parser\" $* \"$inp\" \"$out\""
+    done < "$tests_file"
+}
+
+run_tests "$tests"
+
+# the errors that a recovering parse finds, each with the index of its token
+run_tests "$recover_tests" --recover
+
+# copies of token lists that grow after they are copied
+"$token_copy_test"
+status=$?
+
+if [[ $status -ne 0 ]] ; then
+    echo "TEST $i FAILED"
+    let failed=$failed+1
+    echo "   $token_copy_test exited with $status"
+else
+    echo "TEST $i PASSED"
+    let passed=$passed+1
+fi
+
+let i=$i+1
+
+# the same tests through a parse cache, the first time storing each output
+# .. in it and the second time writing the output from there
+cache_dir="$tmp_dir/cache"
+run_tests "$tests" --cache "$cache_dir"
+run_tests "$tests" --cache "$cache_dir"
+
+# the symbol table that --export-symbols writes next to the output of each
+# .. test, mapped back, which is the same as the one of --symbols tsv, and
+# .. which is not there if the parse fails
+while read inp out gt_out ; do
+    sym_out="$tmp_dir/symbols.txt"
+    rm -f "$sym_out.sym"
+
+    ./"$parser" --symbols tsv --export-symbols "$inp" "$sym_out"
+
+    if grep -q "PARSING WAS SUCCESSFUL" "$sym_out" ; then
+        sed -n '/^Symbol Table$/,/^$/p' "$sym_out" > "$tmp_dir/symbols_gt.txt"
+    else
+        : > "$tmp_dir/symbols_gt.txt"
+    fi
+
+    : > "$tmp_dir/symbols_mapped.txt"
+    [[ -e $sym_out.sym ]] && "$symbols" "$sym_out.sym" > "$tmp_dir/symbols_mapped.txt"
+
+    check_output "$tmp_dir/symbols_mapped.txt" "$tmp_dir/symbols_gt.txt" "./\"$parser\" --symbols tsv --export-symbols \"$inp\" out.txt; $symbols out.txt.sym"
 done < "$tests"
 
+# the same tests through a server, which parses each request with the
+# .. options it was sent with
+socket="$tmp_dir/server.sock"
+./"$parser" --serve "$socket" -j 2 &
+server=$!
+
+for n in $(seq 50) ; do
+    [[ -S $socket ]] && break
+    sleep 0.1
+done
+
+run_tests "$tests" --connect "$socket"
+run_tests "$recover_tests" --recover --connect "$socket"
+
+# the server stops on SIGTERM, after removing its socket
+kill -TERM $server
+wait $server
+status=$?
+
+if [[ $status -ne 0 || -e $socket ]] ; then
+    echo "TEST $i FAILED"
+    let failed=$failed+1
+    echo "   The server exited with $status on SIGTERM, or left its socket"
+else
+    echo "TEST $i PASSED"
+    let passed=$passed+1
+fi
+
+let i=$i+1
+
+# a program of many top-level procedures, large enough to be parsed on many
+# .. threads by --parallel, and the same program with an error in one of its
+# .. procedures, whose outputs are the same as the ones of a serial parse
+procedures="$tmp_dir/procedures.pl0"
+"$gen" -s procedures -n 200000 --source "$procedures"
+sed 's/a3001 := x + 1/a3001 = x + 1/' "$procedures" > "$tmp_dir/procedures_err.pl0"
+
+for program in "$procedures" "$tmp_dir/procedures_err.pl0" ; do
+    for options in "" "-q" ; do
+        ./"$parser" $options "$program" "$tmp_dir/serial.txt"
+        ./"$parser" $options --parallel 4 "$program" "$tmp_dir/parallel.txt"
+        check_output "$tmp_dir/parallel.txt" "$tmp_dir/serial.txt" "$gen -s procedures -n 200000 --source procedures.pl0; sed 's/a3001 := x + 1/a3001 = x + 1/' procedures.pl0 > procedures_err.pl0; ./\"$parser\" $options --parallel 4 $(basename "$program") out.txt"
+    done
+done
+
+# deeply nested programs, whose trees are walked on a stack of their own by
+# .. the passes after an iterative parse
+deep="$tmp_dir/deep.pl0"
+"$gen" -s nested -n 20 -d 300000 --source "$deep"
+
+for options in "--code" "--fold --code" "--run" ; do
+    ./"$parser" --iterative -q $options "$deep" "$tmp_dir/deep.txt" < /dev/null
+    check_success $? "$tmp_dir/deep.txt" "$gen -s nested -n 20 -d 300000 --source deep.pl0; ./\"$parser\" --iterative -q $options deep.pl0 deep.txt < /dev/null"
+done
+
+# the output of a tree grows with the square of its depth, so its passes
+# .. are checked on a shallower program, with a stack that a recursion over
+# .. it would overflow
+"$gen" -s nested -n 20 -d 1000 --source "$deep"
+
+for options in "--ast" "--fold --ast" ; do
+    ./"$parser" -q $options "$deep" "$tmp_dir/deep_gt.txt"
+    (ulimit -s 64; ./"$parser" --iterative -q $options "$deep" "$tmp_dir/deep.txt")
+    check_output "$tmp_dir/deep.txt" "$tmp_dir/deep_gt.txt" "$gen -s nested -n 20 -d 1000 --source deep.pl0; (ulimit -s 64; ./\"$parser\" --iterative -q $options deep.pl0 deep.txt)"
+done
+
 echo "# of tests       : $i"
 echo "# of tests passed: $passed"
 echo "# of tests failed: $failed"
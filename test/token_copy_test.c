@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+#include "arena.h"
+#include "token.h"
+
+/**
+ * Copies token lists, allocated from an arena and from the heap, with
+ * .. getCopy(), and interns more lexemes into the copies than they were
+ * .. copied with, so that their pools grow. Checks that every lexeme of the
+ * .. copies reads back and is found again. Exits with 1 on a mismatch.
+ * Usage: token_copy_test
+ * */
+
+// Lexemes the lists are made of before they are copied, and after
+#define COPIED_LEXEMES 2
+#define ADDED_LEXEMES 1000
+
+/**
+ * Writes the lexeme of the given index to the given buffer
+ * */
+static void formatLexeme(char* buffer, size_t size, int ind)
+{
+    snprintf(buffer, size, "lexeme%d", ind);
+}
+
+/**
+ * Interns the lexemes from the given index up to the given one in the given
+ * .. list. Returns 0 if one of them does not get the id of its index.
+ * */
+static int internLexemes(TokenList* tokenList, int from, int to)
+{
+    char lexeme[32];
+
+    for(int ind = from; ind < to; ind++)
+    {
+        formatLexeme(lexeme, sizeof(lexeme), ind);
+
+        if(internLexeme(tokenList, lexeme, strlen(lexeme)) != ind) return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Checks that the given list has the lexemes up to the given index, in
+ * .. order, each of which is found again. Returns 0 on a mismatch.
+ * */
+static int checkLexemes(TokenList* tokenList, int to)
+{
+    char lexeme[32];
+
+    if(tokenList->lexemes.numberOfStrings != to) return 0;
+
+    for(int ind = 0; ind < to; ind++)
+    {
+        formatLexeme(lexeme, sizeof(lexeme), ind);
+
+        Token token = { .id = 2, .lexeme = ind };
+
+        if(strcmp(getTokenLexeme(tokenList, token), lexeme) != 0 ||
+           internLexeme(tokenList, lexeme, strlen(lexeme)) != ind)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Copies a list that allocates from the given arena, or from the heap if it
+ * .. is NULL, and grows the copy. Returns 0 on a mismatch.
+ * */
+static int testCopy(Arena* arena)
+{
+    TokenList tokenList;
+    initTokenListInArena(&tokenList, arena);
+
+    int ok = internLexemes(&tokenList, 0, COPIED_LEXEMES);
+
+    for(int ind = 0; ind < COPIED_LEXEMES; ind++)
+        addToken(&tokenList, (Token){ .id = 2, .lexeme = ind });
+
+    TokenList copy = getCopy(tokenList);
+
+    ok = ok && copy.numberOfTokens == COPIED_LEXEMES &&
+         internLexemes(&copy, COPIED_LEXEMES, COPIED_LEXEMES + ADDED_LEXEMES) &&
+         checkLexemes(&copy, COPIED_LEXEMES + ADDED_LEXEMES) &&
+         checkLexemes(&tokenList, COPIED_LEXEMES);
+
+    deleteTokenList(&copy);
+    deleteTokenList(&tokenList);
+
+    return ok;
+}
+
+int main()
+{
+    Arena arena;
+    initArena(&arena, 0);
+
+    int ret = 0;
+
+    if(!testCopy(&arena))
+    {
+        fprintf(stderr, "The copy of a token list in an arena lost its lexemes\n");
+        ret = 1;
+    }
+
+    if(!testCopy(NULL))
+    {
+        fprintf(stderr, "The copy of a token list in the heap lost its lexemes\n");
+        ret = 1;
+    }
+
+    deleteArena(&arena);
+
+    return ret;
+}
@@ -1,37 +1,217 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "token.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Width of each line written by printTokenList()
+#define TOKEN_LIST_LINE_LENGTH 26
+
+// Capacity of the first allocation made by addToken()
+#define TOKEN_LIST_MIN_CAPACITY 64
+
+/**
+ * End marker for the lists that have no ids array yet, so that iterators
+ * .. can always read the current id.
+ * */
+static const unsigned char emptyIds[1] = { 0 };
 
 void initTokenList(TokenList* tokenList)
 {
-    tokenList->tokens = NULL;
+    initTokenListInArena(tokenList, NULL);
+}
+
+void initTokenListInArena(TokenList* tokenList, Arena* arena)
+{
+    tokenList->ids = NULL;
+    tokenList->lexemeIds = NULL;
     tokenList->numberOfTokens = 0;
+    tokenList->capacity = 0;
+
+    initInternPool(&tokenList->lexemes, arena);
+
+    tokenList->arena = arena;
+
+    tokenList->mapping = NULL;
+    tokenList->mappingSize = 0;
+
+    tokenList->refill = NULL;
+    tokenList->source = NULL;
+    tokenList->moreTokens = 0;
+}
+
+/**
+ * Returns the token at the given index of the list. The index should be valid.
+ * */
+static Token getTokenAt(const TokenList* tokenList, int ind)
+{
+    Token token;
+
+    token.id = tokenList->ids[ind];
+    token.lexeme = tokenList->lexemeIds[ind];
+
+    return token;
+}
+
+/**
+ * Returns how the given token id is stored in the ids array.
+ * */
+static unsigned char packTokenId(int id)
+{
+    return id >= 0 && id < INVALID_TOKEN_ID ? (unsigned char)id : INVALID_TOKEN_ID;
+}
+
+/**
+ * Returns the given id of a token dump followed by the given digit. Ids stop
+ * .. growing once they are past the largest valid id, so that the digits of
+ * .. any long id do not overflow, and it stays invalid.
+ * */
+static inline int accumulateTokenId(int id, char digit)
+{
+    return id < INVALID_TOKEN_ID ? id * 10 + (digit - '0') : id;
+}
+
+void reserveTokenList(TokenList* tokenList, int capacity)
+{
+    if(!tokenList || tokenList->mapping || capacity <= tokenList->capacity) return;
+
+    // Keep room for the end marker
+    unsigned char* ids = (unsigned char*)arenaRealloc(tokenList->arena, tokenList->ids,
+                                                      tokenList->capacity + 1, capacity + 1);
+
+    // Keep the old list if an allocation failed
+    if(!ids) return;
+
+    tokenList->ids = ids;
+    tokenList->ids[tokenList->numberOfTokens] = 0;
+
+    int* lexemeIds = (int*)arenaRealloc(tokenList->arena, tokenList->lexemeIds,
+                                        tokenList->capacity * sizeof(int), capacity * sizeof(int));
+
+    if(!lexemeIds) return;
+
+    tokenList->lexemeIds = lexemeIds;
+    tokenList->capacity = capacity;
 }
 
 void addToken(TokenList* tokenList, Token token)
 {
-    // Increase number of tokens
-    tokenList->numberOfTokens++;
+    // Double the capacity if the list is full
+    if(tokenList->numberOfTokens == tokenList->capacity)
+    {
+        int capacity = tokenList->capacity * 2;
+
+        if(capacity < TOKEN_LIST_MIN_CAPACITY)
+            capacity = TOKEN_LIST_MIN_CAPACITY;
+
+        reserveTokenList(tokenList, capacity);
+
+        if(tokenList->numberOfTokens == tokenList->capacity)
+            return;
+    }
+
+    // Add token to the end of the list, moving the end marker after it
+    tokenList->ids[tokenList->numberOfTokens] = packTokenId(token.id);
+    tokenList->lexemeIds[tokenList->numberOfTokens] = token.lexeme;
+    tokenList->ids[++tokenList->numberOfTokens] = 0;
+}
+
+int internLexeme(TokenList* tokenList, const char* lexeme, size_t length)
+{
+    if(!tokenList) return -1;
+
+    return internString(&tokenList->lexemes, lexeme, length);
+}
+
+int replaceTokens(TokenList* tokenList, int first, int removed, const TokenList* source, int sourceFirst, int count)
+{
+    if(!tokenList || tokenList->mapping || tokenList->refill || first < 0 || removed < 0 ||
+       first + removed > tokenList->numberOfTokens || count < 0 ||
+       (count > 0 && (!source || sourceFirst < 0 || sourceFirst + count > source->numberOfTokens)))
+        return -1;
+
+    int numberOfTokens = tokenList->numberOfTokens - removed + count;
+
+    // A list that was never allocated stays so until it has tokens
+    if(numberOfTokens == 0 && !tokenList->ids)
+        return 0;
+
+    // Grow geometrically, as addToken() does
+    if(numberOfTokens > tokenList->capacity)
+    {
+        int capacity = tokenList->capacity * 2;
+
+        if(capacity < numberOfTokens)
+            capacity = numberOfTokens < TOKEN_LIST_MIN_CAPACITY ? TOKEN_LIST_MIN_CAPACITY : numberOfTokens;
+
+        reserveTokenList(tokenList, capacity);
+
+        if(numberOfTokens > tokenList->capacity)
+            return -1;
+    }
+
+    int end = first + removed;
+    int moved = tokenList->numberOfTokens - end;
+
+    // Move the tokens after the replaced ones, along with the end marker
+    memmove(&tokenList->ids[first + count], &tokenList->ids[end], moved + 1);
+    memmove(&tokenList->lexemeIds[first + count], &tokenList->lexemeIds[end], moved * sizeof(int));
+
+    tokenList->numberOfTokens = numberOfTokens;
+
+    int err = 0;
+
+    for(int i = 0; i < count; i++)
+    {
+        int lexeme = source->lexemeIds[sourceFirst + i];
+
+        if(lexeme >= 0)
+        {
+            lexeme = internString(&tokenList->lexemes, getInternedString(&source->lexemes, lexeme),
+                                  getInternedStringLength(&source->lexemes, lexeme));
+
+            if(lexeme < 0) err = -1;
+        }
+
+        tokenList->ids[first + i] = source->ids[sourceFirst + i];
+        tokenList->lexemeIds[first + i] = lexeme;
+    }
+
+    return err;
+}
 
-    // Allocate space for new token
-    tokenList->tokens = (Token*)realloc(tokenList->tokens, (tokenList->numberOfTokens) * sizeof(Token));
+const char* getTokenLexeme(const TokenList* tokenList, Token token)
+{
+    if(!tokenList || token.lexeme < 0 || token.lexeme >= tokenList->lexemes.numberOfStrings)
+        return "";
 
-    // Add token to the end of the list
-    tokenList->tokens[tokenList->numberOfTokens - 1] = token;
+    return getInternedString(&tokenList->lexemes, token.lexeme);
 }
 
 TokenList getCopy(TokenList src)
 {
     TokenList copy;
-    
-    copy.numberOfTokens = src.numberOfTokens;
 
-    if(src.tokens)
+    initTokenListInArena(&copy, src.arena);
+
+    if(src.ids && src.numberOfTokens > 0)
     {
-        copy.tokens = (Token*)malloc(src.numberOfTokens * sizeof(Token));
+        reserveTokenList(&copy, src.numberOfTokens);
+
+        if(copy.capacity < src.numberOfTokens || copyInternPool(&copy.lexemes, &src.lexemes) != 0)
+        {
+            deleteTokenList(&copy);
+            return copy;
+        }
+
+        copy.numberOfTokens = src.numberOfTokens;
 
-        for(int i = 0; i < src.numberOfTokens; i++)
-            copy.tokens[i] = src.tokens[i];
+        memcpy(copy.ids, src.ids, src.numberOfTokens + 1);
+        memcpy(copy.lexemeIds, src.lexemeIds, src.numberOfTokens * sizeof(int));
     }
 
     return copy;
@@ -39,36 +219,260 @@ TokenList getCopy(TokenList src)
 
 void printTokenList(TokenList tokenList, FILE* out)
 {
-    if(out == NULL || tokenList.tokens == NULL)
+    if(out == NULL || tokenList.ids == NULL)
         return;
 
     fprintf(out, "%10s   %12s\n", "Token Type", "Lexeme");
 
     for(int i = 0; i < tokenList.numberOfTokens; i++)
     {
-        fprintf(out, "%10d   %12s\n", tokenList.tokens[i].id, tokenList.tokens[i].lexeme);
+        Token token = getTokenAt(&tokenList, i);
+
+        fprintf(out, "%10d   %12s\n", token.id, getTokenLexeme(&tokenList, token));
     }
 }
 
-TokenList readTokenList(FILE* in)
+/**
+ * Reads the tokens by scanning the memory mapped file, starting from the
+ * .. current position of the given stream. The columns are scanned by hand
+ * .. the same way fscanf("%10d   %12s\n") would, without any stdio call
+ * .. per line.
+ * Returns 0 if the stream is not a memory mappable regular file, in which
+ * .. case nothing is read.
+ * */
+static int readMappedTokenList(FILE* in, TokenList* tokenList)
 {
-    TokenList tokenList;
+    struct stat st;
 
-    tokenList.tokens = NULL;
-    tokenList.numberOfTokens = 0;
+    long start = ftell(in);
 
-    if(!in) return tokenList;
+    if(start < 0 || fstat(fileno(in), &st) != 0 || !S_ISREG(st.st_mode))
+        return 0;
+
+    // Nothing except maybe the header left in the file
+    if(st.st_size <= start + TOKEN_LIST_HEADER_LENGTH)
+        return 1;
+
+    size_t size = (size_t)st.st_size;
+
+    char* base = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+
+    if(base == MAP_FAILED)
+        return 0;
 
     // Skip header, which is 26 characters
-    fseek(in, 26, SEEK_CUR);
+    const char* p = base + start + TOKEN_LIST_HEADER_LENGTH;
+    const char* end = base + size;
+
+    // Each token is on its own line, so the number of remaining lines is
+    // .. an upper bound on the number of tokens
+    int numberOfLines = 1;
+
+    for(const char* nl = p; (nl = memchr(nl, '\n', end - nl)) != NULL; nl++)
+        numberOfLines++;
+
+    reserveTokenList(tokenList, numberOfLines);
+
+    unsigned char* ids = tokenList->ids;
+    int* lexemeIds = tokenList->lexemeIds;
+
+    int n = 0;
+
+    while(n < tokenList->capacity)
+    {
+        // Token type: optionally signed integer after any whitespace
+        while(p < end && isspace((unsigned char)*p)) p++;
+
+        int sign = 1;
+
+        if(p < end && (*p == '-' || *p == '+'))
+        {
+            if(*p == '-') sign = -1;
+            p++;
+        }
+
+        if(p >= end || !isdigit((unsigned char)*p))
+            break;
+
+        int id = 0;
+
+        while(p < end && isdigit((unsigned char)*p))
+            id = accumulateTokenId(id, *p++);
+
+        // Lexeme: a run of non-whitespace characters after any whitespace
+        while(p < end && isspace((unsigned char)*p)) p++;
+
+        const char* lexeme = p;
+
+        while(p < end && !isspace((unsigned char)*p)) p++;
+
+        if(p == lexeme)
+            break;
+
+        size_t length = p - lexeme;
+
+        if(length > MAX_LEXEME_LENGTH)
+            length = MAX_LEXEME_LENGTH;
+
+        ids[n] = packTokenId(sign * id);
+        lexemeIds[n] = internLexeme(tokenList, lexeme, length);
+        n++;
+    }
+
+    if(ids) ids[n] = 0;
+
+    tokenList->numberOfTokens = n;
+
+    // Leave the stream positioned after the consumed tokens
+    fseek(in, (long)(p - base), SEEK_SET);
+
+    munmap(base, size);
+
+    return 1;
+}
+
+/**
+ * Reads the tokens from the given stream with stdio. Used for the streams
+ * .. that cannot be memory mapped, such as pipes.
+ * */
+static void readStreamTokenList(FILE* in, TokenList* tokenList)
+{
+    // Estimate the number of tokens from the remaining size of the file, so
+    // .. that the list is allocated once. Not possible on pipes.
+    long start = ftell(in);
+
+    if(start >= 0 && fseek(in, 0, SEEK_END) == 0)
+    {
+        long size = ftell(in) - start - TOKEN_LIST_HEADER_LENGTH;
+
+        fseek(in, start, SEEK_SET);
+
+        if(size > 0)
+            reserveTokenList(tokenList, (int)(size / TOKEN_LIST_LINE_LENGTH) + 1);
+    }
+
+    // Skip header, which is 26 characters. Pipes cannot seek, so
+    // .. consume it instead.
+    if(fseek(in, TOKEN_LIST_HEADER_LENGTH, SEEK_CUR) != 0)
+    {
+        for(int i = 0; i < TOKEN_LIST_HEADER_LENGTH && fgetc(in) != EOF; i++);
+    }
 
     Token token;
+    char lexeme[MAX_LEXEME_LENGTH + 1];
+
+    while( fscanf(in, "%10d   %11s%*[^ \t\r\n]", &token.id, lexeme) == 2 )
+    {
+        token.lexeme = internLexeme(tokenList, lexeme, strlen(lexeme));
+        addToken(tokenList, token);
+    }
+}
+
+void addTokenChunk(TokenList* tokenList, const TokenChunk* chunk)
+{
+    if(tokenList->mapping) return;
+
+    int needed = tokenList->numberOfTokens + chunk->numberOfTokens;
+
+    if(needed > tokenList->capacity)
+        reserveTokenList(tokenList, needed > tokenList->capacity * 2 ? needed : tokenList->capacity * 2);
+
+    if(needed > tokenList->capacity) return;
+
+    int n = tokenList->numberOfTokens;
 
-    while( fscanf(in, "%10d   %12s\n", &token.id, token.lexeme) == 2 )
+    for(int i = 0; i < chunk->numberOfTokens; i++, n++)
     {
-        addToken(&tokenList, token);
+        tokenList->ids[n] = chunk->ids[i];
+        tokenList->lexemeIds[n] = internLexeme(tokenList, chunk->lexemes[i], chunk->lengths[i]);
+    }
+
+    tokenList->ids[n] = 0;
+    tokenList->numberOfTokens = n;
+}
+
+size_t scanTokenChunk(const char* text, size_t length, int atEnd, TokenChunk* chunk)
+{
+    const char* p = text;
+    const char* end = text + length;
+
+    int n = chunk->numberOfTokens;
+
+    while(n < TOKEN_CHUNK_SIZE && !chunk->end)
+    {
+        // Each token is scanned as a whole, from its beginning
+        const char* start = p;
+
+        // Token type: optionally signed integer after any whitespace
+        while(p < end && isspace((unsigned char)*p)) p++;
+
+        int sign = 1;
+
+        if(p < end && (*p == '-' || *p == '+'))
+        {
+            if(*p == '-') sign = -1;
+            p++;
+        }
+
+        int id = 0;
+        const char* digits = p;
+
+        while(p < end && isdigit((unsigned char)*p))
+            id = accumulateTokenId(id, *p++);
+
+        // Lexeme: a run of non-whitespace characters after any whitespace
+        while(p < end && isspace((unsigned char)*p)) p++;
+
+        const char* lexeme = p;
+
+        while(p < end && !isspace((unsigned char)*p)) p++;
+
+        // The token may continue after the given characters
+        if(p == end && !atEnd)
+        {
+            p = start;
+            break;
+        }
+
+        // Not a token, so nothing after it is read either, as readTokenList()
+        if(digits == lexeme || !isdigit((unsigned char)*digits) || p == lexeme)
+        {
+            chunk->end = 1;
+            break;
+        }
+
+        size_t lexemeLength = p - lexeme;
+
+        if(lexemeLength > MAX_LEXEME_LENGTH)
+            lexemeLength = MAX_LEXEME_LENGTH;
+
+        chunk->ids[n] = packTokenId(sign * id);
+        chunk->lengths[n] = (unsigned char)lexemeLength;
+        memcpy(chunk->lexemes[n], lexeme, lexemeLength);
+        n++;
     }
 
+    chunk->numberOfTokens = n;
+
+    return p - text;
+}
+
+TokenList readTokenList(FILE* in)
+{
+    return readTokenListInArena(in, NULL);
+}
+
+TokenList readTokenListInArena(FILE* in, Arena* arena)
+{
+    TokenList tokenList;
+
+    initTokenListInArena(&tokenList, arena);
+
+    if(!in) return tokenList;
+
+    if(!readMappedTokenList(in, &tokenList))
+        readStreamTokenList(in, &tokenList);
+
     return tokenList;
 }
 
@@ -76,37 +480,236 @@ void deleteTokenList(TokenList* tokenList)
 {
     if(!tokenList) return;
     
-    if(tokenList->tokens)
-        free(tokenList->tokens);
+    // The arrays of a mapped list point into the mapping
+    if(tokenList->mapping)
+    {
+        munmap(tokenList->mapping, tokenList->mappingSize);
+    }
+    else
+    {
+        arenaFree(tokenList->arena, tokenList->ids);
+        arenaFree(tokenList->arena, tokenList->lexemeIds);
+    }
+
+    deleteInternPool(&tokenList->lexemes);
+
+    initTokenListInArena(tokenList, tokenList->arena);
+}
+
+/**
+ * Returns the size of the ids section of a binary token list with the given
+ * .. number of tokens, including the end marker and the padding.
+ * */
+static size_t getBinaryIdsSize(size_t numberOfTokens)
+{
+    return (numberOfTokens + 1 + 3) & ~(size_t)3;
+}
+
+int writeBinaryTokenList(TokenList tokenList, FILE* out)
+{
+    if(!out || tokenList.numberOfTokens < 0) return -1;
+
+    size_t n = (size_t)tokenList.numberOfTokens;
+    size_t idsSize = getBinaryIdsSize(n);
+
+    const InternPool* lexemes = &tokenList.lexemes;
+
+    // The arrays of the list are written as they are, so a 0 id, which
+    // .. would end the list early, or a missing lexeme cannot be written
+    for(size_t i = 0; i < n; i++)
+    {
+        if(tokenList.ids[i] == 0 || tokenList.lexemeIds[i] < 0)
+            return -1;
+    }
+
+    char header[BINARY_TOKEN_LIST_HEADER_SIZE];
+    uint16_t version = BINARY_TOKEN_LIST_VERSION, reserved = 0;
+    uint32_t numberOfTokens = (uint32_t)n;
+    uint32_t numberOfLexemes = (uint32_t)lexemes->numberOfStrings;
+    uint32_t poolSize = (uint32_t)lexemes->length;
+    uint32_t reserved2 = 0;
+
+    memcpy(header, BINARY_TOKEN_LIST_MAGIC, 4);
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &reserved, 2);
+    memcpy(header + 8, &numberOfTokens, 4);
+    memcpy(header + 12, &numberOfLexemes, 4);
+    memcpy(header + 16, &poolSize, 4);
+    memcpy(header + 20, &reserved2, 4);
+
+    // The ids are followed by the end marker and the padding. The lexeme
+    // .. pool is written as it is stored in the interner. An empty pool has
+    // .. no offsets array, so its end offset is written separately.
+    const char padding[4] = { 0 };
+    const unsigned char* ids = tokenList.ids ? tokenList.ids : emptyIds;
+    uint32_t endOffset = 0;
+
+    int err = fwrite(header, 1, sizeof(header), out) != sizeof(header) ||
+              fwrite(ids, 1, n + 1, out) != n + 1 ||
+              fwrite(padding, 1, idsSize - n - 1, out) != idsSize - n - 1 ||
+              fwrite(tokenList.lexemeIds, sizeof(int), n, out) != n ||
+              (numberOfLexemes ? fwrite(lexemes->offsets, sizeof(uint32_t), numberOfLexemes + 1, out) != numberOfLexemes + 1
+                               : fwrite(&endOffset, sizeof(uint32_t), 1, out) != 1) ||
+              fwrite(lexemes->chars, 1, poolSize, out) != poolSize;
+
+    return err ? -1 : 0;
+}
+
+int isBinaryTokenList(FILE* in)
+{
+    if(!in) return 0;
+
+    long start = ftell(in);
+
+    if(start < 0) return 0;
+
+    char magic[4];
+
+    int isBinary = fread(magic, 1, 4, in) == 4 && memcmp(magic, BINARY_TOKEN_LIST_MAGIC, 4) == 0;
+
+    fseek(in, start, SEEK_SET);
 
-    tokenList->tokens = NULL;
+    return isBinary;
 }
 
+TokenList mapBinaryTokenList(FILE* in)
+{
+    TokenList tokenList;
+
+    initTokenList(&tokenList);
+
+    struct stat st;
+
+    long start = in ? ftell(in) : -1;
+
+    if(start < 0 || fstat(fileno(in), &st) != 0 || !S_ISREG(st.st_mode) ||
+       st.st_size < start + BINARY_TOKEN_LIST_HEADER_SIZE)
+        return tokenList;
+
+    size_t size = (size_t)st.st_size;
+
+    char* base = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+
+    if(base == MAP_FAILED)
+        return tokenList;
+
+    const char* header = base + start;
+    size_t available = size - (size_t)start;
+
+    uint16_t version;
+    uint32_t numberOfTokens, numberOfLexemes, poolSize;
+
+    memcpy(&version, header + 4, 2);
+    memcpy(&numberOfTokens, header + 8, 4);
+    memcpy(&numberOfLexemes, header + 12, 4);
+    memcpy(&poolSize, header + 16, 4);
+
+    size_t idsSize = getBinaryIdsSize(numberOfTokens);
+    size_t lexemeIdsSize = (size_t)numberOfTokens * sizeof(uint32_t);
+    size_t offsetsSize = ((size_t)numberOfLexemes + 1) * sizeof(uint32_t);
+
+    // Mappings are page aligned, so the 4-byte alignment of the sections
+    // .. holds as long as the list starts at a multiple of 4
+    int valid = memcmp(header, BINARY_TOKEN_LIST_MAGIC, 4) == 0 &&
+                version == BINARY_TOKEN_LIST_VERSION &&
+                start % 4 == 0 &&
+                numberOfTokens <= 0x7fffffff && numberOfLexemes <= 0x7fffffff &&
+                BINARY_TOKEN_LIST_HEADER_SIZE + idsSize + lexemeIdsSize + offsetsSize + poolSize <= available;
+
+    const unsigned char* ids = (const unsigned char*)(header + BINARY_TOKEN_LIST_HEADER_SIZE);
+    const int* lexemeIds = (const int*)(header + BINARY_TOKEN_LIST_HEADER_SIZE + idsSize);
+    const uint32_t* offsets = (const uint32_t*)(header + BINARY_TOKEN_LIST_HEADER_SIZE + idsSize + lexemeIdsSize);
+    const char* pool = header + BINARY_TOKEN_LIST_HEADER_SIZE + idsSize + lexemeIdsSize + offsetsSize;
+
+    // Each lexeme should fill its range of the pool up to its terminating
+    // .. null and every token should refer to one of the lexemes
+    if(valid)
+        valid = ids[numberOfTokens] == 0 && offsets[0] == 0 && offsets[numberOfLexemes] == poolSize;
+
+    for(uint32_t i = 0; i < numberOfLexemes && valid; i++)
+    {
+        valid = offsets[i] < offsets[i + 1] && offsets[i + 1] <= poolSize &&
+                memchr(pool + offsets[i], '\0', offsets[i + 1] - offsets[i]) == pool + offsets[i + 1] - 1;
+    }
+
+    for(uint32_t i = 0; i < numberOfTokens && valid; i++)
+        valid = lexemeIds[i] >= 0 && (uint32_t)lexemeIds[i] < numberOfLexemes;
+
+    if(!valid)
+    {
+        munmap(base, size);
+        return tokenList;
+    }
+
+    // The mapping is private and read only, the list never writes to it
+    tokenList.numberOfTokens = (int)numberOfTokens;
+    tokenList.ids = (unsigned char*)ids;
+    tokenList.lexemeIds = (int*)lexemeIds;
+    tokenList.mapping = base;
+    tokenList.mappingSize = size;
+
+    initReadOnlyInternPool(&tokenList.lexemes, pool, offsets, (int)numberOfLexemes);
+
+    return tokenList;
+}
 
 TokenListIterator getTokenListIterator(TokenList* tokenList)
 {
     TokenListIterator it;
 
     it.currentTokenInd = 0;
+    it.windowStart = 0;
 
     if(tokenList) it.tokenList = tokenList;
     else          it.tokenList = NULL;
 
+    it.ids = tokenList && tokenList->ids ? tokenList->ids : emptyIds;
+
+    it.refillInd = tokenList && tokenList->refill && tokenList->moreTokens ? tokenList->numberOfTokens : -1;
+
+    // An empty window
+    if(it.refillInd == 0) refillTokenListIterator(&it);
+
     return it;
 }
 
+void refillTokenListIterator(TokenListIterator* it)
+{
+    TokenList* tokenList = it->tokenList;
+
+    // The iterator is at the end of the window
+    it->windowStart += it->currentTokenInd;
+
+    // Skip the windows that have no tokens, till the last one
+    do
+    {
+        tokenList->moreTokens = tokenList->refill(tokenList);
+    }
+    while(tokenList->moreTokens && tokenList->numberOfTokens == 0);
+
+    it->currentTokenInd = 0;
+    it->ids = tokenList->ids ? tokenList->ids : emptyIds;
+    it->refillInd = tokenList->moreTokens ? tokenList->numberOfTokens : -1;
+}
+
 Token getCurrentTokenFromIterator(TokenListIterator it)
 {
-    if(!it.tokenList || !it.tokenList->tokens || it.currentTokenInd >= it.tokenList->numberOfTokens)
+    if(!it.tokenList || !it.tokenList->ids || it.currentTokenInd >= it.tokenList->numberOfTokens)
     {
-        Token nulsymToken = { .id=0, .lexeme="" };
+        Token nulsymToken = { .id=0, .lexeme=-1 };
         return nulsymToken;
     }
 
-    return it.tokenList->tokens[it.currentTokenInd];
+    return getTokenAt(it.tokenList, it.currentTokenInd);
+}
+
+const char* getCurrentLexemeFromIterator(TokenListIterator it)
+{
+    return getTokenLexeme(it.tokenList, getCurrentTokenFromIterator(it));
 }
 
 void advanceTokenListIterator(TokenListIterator* it)
 {
-    if(it) it->currentTokenInd++;
-}
\ No newline at end of file
+    // Never move past the end marker
+    if(it && it->ids[it->currentTokenInd]) stepTokenListIterator(it);
+}
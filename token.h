@@ -2,32 +2,132 @@
 #define __TOKEN_H__
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+#include "arena.h"
 
 #define MAX_LEXEME_LENGTH 11
 
+// Beginning and width of the header written by printTokenList()
+#define TOKEN_LIST_HEADER "Token Type"
+#define TOKEN_LIST_HEADER_LENGTH 26
+
+/**
+ * Binary token list format, written by writeBinaryTokenList() and mapped by
+ * .. mapBinaryTokenList(). All the fields are in host byte order.
+ *
+ * header  : magic "PL0T", uint16 version, uint16 reserved (0),
+ *           uint32 number of tokens (n), uint32 number of distinct
+ *           lexemes (m), uint32 size of the lexeme pool, uint32 reserved (0)
+ * ids     : uint8[n + 1], token ids followed by a 0 end marker,
+ *           zero padded to a multiple of 4 bytes
+ * lexemes : uint32[n], lexeme id of each token
+ * offsets : uint32[m + 1], offset of each distinct lexeme in the lexeme
+ *           pool, followed by the size of the pool
+ * pool    : null terminated distinct lexemes
+ * */
+#define BINARY_TOKEN_LIST_MAGIC "PL0T"
+#define BINARY_TOKEN_LIST_VERSION 2
+#define BINARY_TOKEN_LIST_HEADER_SIZE 24
+
 /**
  * The struct to store token information
  * */
 typedef struct {
     int id; // numerical representation of the token
-    char lexeme[MAX_LEXEME_LENGTH + 1]; // null terminated string
+    int lexeme; // id of the lexeme in the lexemes pool of the token list, -1 if empty
 } Token;
 
+typedef struct TokenList TokenList;
+
+/**
+ * Called when all the tokens of a streamed token list are consumed, to
+ * .. replace them with the next ones. Returns 1 if more tokens can follow
+ * .. the new ones, 0 if they are the last ones.
+ * */
+typedef int (*TokenListRefill)(TokenList*);
+
 /**
  * The struct to store list of tokens and keep track
- * of number of tokens included in the list
+ * of number of tokens included in the list.
+ * capacity is the number of tokens the allocated list can hold before
+ * .. it has to grow again.
+ *
+ * The tokens are stored as a struct of arrays: ids holds the token ids
+ * .. densely, one byte per token, and lexemeIds holds the lexeme of each
+ * .. token. ids[numberOfTokens] is always 0, which marks the end of the
+ * .. list. Ids that do not fit in a byte are stored as INVALID_TOKEN_ID.
+ * Each distinct lexeme is stored once, in lexemes.
+ *
+ * The arrays of a TokenList returned by mapBinaryTokenList() point into the
+ * .. memory mapped file, and lexemes is a read only view of the mapped
+ * .. lexeme pool. Such a list is read only.
+ *
+ * If arena is not NULL, the list and its lexemes are allocated from it
+ * .. instead of the heap, and are freed all at once with the arena.
+ *
+ * A streamed list, which has a refill function, only holds a window of the
+ * .. tokens, see stream.h. Its iterators call refill once they are advanced
+ * .. past the window, which then holds the next tokens. The lexemes of all
+ * .. the tokens stay in lexemes.
+ * */
+struct TokenList {
+    unsigned char* ids;
+    int* lexemeIds;
+    int numberOfTokens;
+    int capacity;
+
+    InternPool lexemes;
+
+    Arena* arena;
+
+    // Memory mapped binary token list, if mapping is not NULL
+    void* mapping;
+    size_t mappingSize;
+
+    // Refill function and source of a streamed list. moreTokens is not 0
+    // .. if more tokens can follow the window.
+    TokenListRefill refill;
+    void* source;
+    int moreTokens;
+};
+
+#define INVALID_TOKEN_ID 255
+
+/**
+ * A fixed number of tokens, each with a copy of its lexeme, which is how
+ * .. tokens are handed over from a producer to a token list.
  * */
+#define TOKEN_CHUNK_SIZE 4096
+
 typedef struct {
-    Token* tokens;
+    unsigned char ids[TOKEN_CHUNK_SIZE];
+    unsigned char lengths[TOKEN_CHUNK_SIZE];
+    char lexemes[TOKEN_CHUNK_SIZE][MAX_LEXEME_LENGTH];
     int numberOfTokens;
-} TokenList;
+
+    // Not 0 if no token follows the ones in the chunk, in which case err is
+    // .. the error code of the producer, 0 if the input simply ended
+    int end;
+    int err;
+} TokenChunk;
 
 /**
- * The struct that helps to iterate on a TokenList
+ * The struct that helps to iterate on a TokenList.
+ * ids is the ids array of the list, which is never NULL so that the current
+ * .. token id can be peeked without any checks.
+ * refillInd is the index at which the window of a streamed list runs out,
+ * .. -1 if no more tokens can follow.
+ * windowStart is the index of the first token of the window in the whole
+ * .. streamed list, 0 for the other lists.
  * */
 typedef struct {
     TokenList* tokenList;
     int currentTokenInd;
+    const unsigned char* ids;
+    int refillInd;
+    int windowStart;
 } TokenListIterator;
 
 /**
@@ -36,16 +136,71 @@ typedef struct {
 void initTokenList(TokenList*);
 
 /**
- * Adds the given Token to the given TokenList
+ * Initializes the given TokenList to allocate from the given arena
+ * */
+void initTokenListInArena(TokenList*, Arena*);
+
+/**
+ * Makes sure the given TokenList can hold at least the given number of
+ * .. tokens without reallocating its list.
+ * */
+void reserveTokenList(TokenList*, int);
+
+/**
+ * Adds the given Token to the given TokenList. The lexeme of the token
+ * .. should be interned in the list by internLexeme().
+ * The list grows geometrically, so adding n tokens costs O(n) in total.
+ * Memory mapped lists are read only, nothing is added to them.
  * */
 void addToken(TokenList*, Token);
 
+/**
+ * Returns the id of the lexeme made of the given number of characters in the
+ * .. lexemes pool of the given TokenList, adding the lexeme if needed.
+ * Returns -1 on failure.
+ * */
+int internLexeme(TokenList*, const char*, size_t);
+
+/**
+ * Replaces the given number of tokens of the given TokenList from the given
+ * .. index on with the given number of tokens of the source list, from the
+ * .. given index of it on, interning their lexemes in the given list.
+ * Memory mapped and streamed lists cannot be edited.
+ * Returns 0 on success and -1 on failure, in which case the list is not
+ * .. changed, unless a lexeme could not be interned, which leaves it empty.
+ * */
+int replaceTokens(TokenList*, int first, int removed, const TokenList* source, int sourceFirst, int count);
+
+/**
+ * Returns the lexeme of the given token of the given TokenList as a null
+ * .. terminated string.
+ * */
+const char* getTokenLexeme(const TokenList*, Token);
+
+/**
+ * Adds the tokens of the given chunk to the given TokenList, interning their
+ * .. lexemes.
+ * */
+void addTokenChunk(TokenList*, const TokenChunk*);
+
+/**
+ * Scans the tokens in the format printTokenList() writes, without the header,
+ * .. from the given number of characters into the given chunk, the same way
+ * .. readTokenList() does. Stops when the chunk is full or a token may
+ * .. continue after the given characters, unless atEnd is not 0, in which
+ * .. case the given characters are the last ones.
+ * Sets end of the chunk once no more tokens can be scanned.
+ * Returns the number of the characters consumed.
+ * */
+size_t scanTokenChunk(const char*, size_t, int atEnd, TokenChunk*);
+
 /**
  * Creates and returns a copy of the given TokenList.
  * TokenList dynamically allocates memory for its list.
  * Therefore, shallow copying with assignment operator does not
  * .. guarantee any lifetime of the included tokens list, which
  * .. may cause dangling pointers.
+ * The copy allocates from the same arena as the given list.
  * */
 TokenList getCopy(TokenList);
 
@@ -58,9 +213,40 @@ void printTokenList(TokenList, FILE*);
  * Reads a list of tokens from given file.
  * The format of the list in the input file should be same as the printTokenList()
  * func prints.
+ * Regular files are memory mapped and scanned without stdio; other streams,
+ * .. such as pipes, are read with fscanf().
  * */
 TokenList readTokenList(FILE*);
 
+/**
+ * Same as readTokenList(), except that the list is allocated from the given
+ * .. arena.
+ * */
+TokenList readTokenListInArena(FILE*, Arena*);
+
+/**
+ * Writes the given TokenList to the given FILE in the binary token list
+ * .. format.
+ * Returns 0 on success, -1 if the list cannot be represented in the format
+ * .. or writing fails.
+ * */
+int writeBinaryTokenList(TokenList, FILE*);
+
+/**
+ * Checks whether the given file, starting from its current position, is in
+ * .. the binary token list format. The position of the file is not changed.
+ * Streams that cannot seek, such as pipes, are never considered binary.
+ * */
+int isBinaryTokenList(FILE*);
+
+/**
+ * Memory maps a binary token list from the given file, starting from its
+ * .. current position, and wraps it as a TokenList without copying the
+ * .. tokens. The mapping is released by deleteTokenList().
+ * If the file is not a valid binary token list, returns an empty list.
+ * */
+TokenList mapBinaryTokenList(FILE*);
+
 /**
  * Makes the necessary deallocations on the TokenList
  * */
@@ -79,8 +265,58 @@ TokenListIterator getTokenListIterator(TokenList*);
 Token getCurrentTokenFromIterator(TokenListIterator);
 
 /**
- * Advances the position of next token of TokenListIterator by one.
+ * Returns the lexeme of the current token from TokenListIterator, which is
+ * .. an empty string if all the tokens have already consumed.
+ * */
+const char* getCurrentLexemeFromIterator(TokenListIterator);
+
+/**
+ * Advances the position of next token of TokenListIterator by one, unless
+ * .. all the tokens have already consumed.
  * */
 void advanceTokenListIterator(TokenListIterator*);
 
+/**
+ * Replaces the window of the streamed list of the given iterator with the
+ * .. next tokens, and moves the iterator to the first of them.
+ * */
+void refillTokenListIterator(TokenListIterator*);
+
+/**
+ * Advances the given iterator by one without checking for the end marker,
+ * .. which should not be the current token. Refills streamed lists.
+ * */
+static inline void stepTokenListIterator(TokenListIterator* it)
+{
+    if(++it->currentTokenInd == it->refillInd)
+        refillTokenListIterator(it);
+}
+
+/**
+ * Returns the id of the current token of the given iterator without copying
+ * .. the token. Returns 0 if all the tokens have already consumed.
+ * */
+static inline int peekTokenType(const TokenListIterator* it)
+{
+    return it->ids[it->currentTokenInd];
+}
+
+/**
+ * Returns the index of the current token of the given iterator in the whole
+ * .. list, which a streamed list counts across its windows.
+ * */
+static inline int getTokenListIteratorIndex(const TokenListIterator* it)
+{
+    return it->windowStart + it->currentTokenInd;
+}
+
+/**
+ * Returns the lexeme id of the current token of the given iterator without
+ * .. copying the token. Valid only if peekTokenType() is not 0.
+ * */
+static inline int peekTokenLexeme(const TokenListIterator* it)
+{
+    return it->tokenList->lexemeIds[it->currentTokenInd];
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "vm.h"
+#include "data.h"
+
+/**
+ * Operations the instructions are decoded into, one for each OPR and SIO
+ * .. operation, so that each one is dispatched at once. LOD and STO of the
+ * .. current record, which are the most common ones, get their own.
+ * */
+typedef enum {
+    VM_LIT, VM_LOD0, VM_LOD, VM_STO0, VM_STO, VM_CAL, VM_INT, VM_JMP, VM_JPC,
+    VM_RET, VM_NEG, VM_ADD, VM_SUB, VM_MUL, VM_DIV, VM_ODD, VM_MOD,
+    VM_EQL, VM_NEQ, VM_LSS, VM_LEQ, VM_GTR, VM_GEQ,
+    VM_WRITE, VM_READ, VM_HALT
+} VmOp;
+
+/**
+ * A decoded instruction. handler is the address of the code of op in the
+ * .. threaded loop, and is not used by the switch loop.
+ * */
+typedef struct {
+    const void* handler;
+    int op;
+    int l;
+    int m;
+} VmInstruction;
+
+/**
+ * State a loop starts from and returns the error code in
+ * */
+typedef struct {
+    int* stack;
+    int** display;
+    int numberOfInstructions;
+    int limit;
+    FILE* in;
+    Sink* out;
+} VmState;
+
+static const int oprOps[] = {
+    [OPR_RET] = VM_RET, [OPR_NEG] = VM_NEG, [OPR_ADD] = VM_ADD, [OPR_SUB] = VM_SUB,
+    [OPR_MUL] = VM_MUL, [OPR_DIV] = VM_DIV, [OPR_ODD] = VM_ODD, [OPR_MOD] = VM_MOD,
+    [OPR_EQL] = VM_EQL, [OPR_NEQ] = VM_NEQ, [OPR_LSS] = VM_LSS, [OPR_LEQ] = VM_LEQ,
+    [OPR_GTR] = VM_GTR, [OPR_GEQ] = VM_GEQ
+};
+
+/**
+ * Decodes the given instruction. Instructions that the machine does not know
+ * .. halt it.
+ * */
+static void decodeInstruction(const Instruction* instruction, VmInstruction* decoded)
+{
+    int op = VM_HALT;
+
+    switch(instruction->op)
+    {
+    case OP_LIT: op = VM_LIT; break;
+    case OP_LOD: op = instruction->l == 0 ? VM_LOD0 : VM_LOD; break;
+    case OP_STO: op = instruction->l == 0 ? VM_STO0 : VM_STO; break;
+    case OP_CAL: op = VM_CAL; break;
+    case OP_INT: op = VM_INT; break;
+    case OP_JMP: op = VM_JMP; break;
+    case OP_JPC: op = VM_JPC; break;
+
+    case OP_OPR:
+        if(instruction->m >= OPR_RET && instruction->m <= OPR_GEQ)
+            op = oprOps[instruction->m];
+        break;
+
+    case OP_SIO:
+        if(instruction->m == SIO_WRITE)     op = VM_WRITE;
+        else if(instruction->m == SIO_READ) op = VM_READ;
+        break;
+    }
+
+    decoded->handler = NULL;
+    decoded->op = op;
+    decoded->l = instruction->l;
+    decoded->m = instruction->m;
+}
+
+// The loop is written once, in vmloop.h, and compiled for each dispatch
+#define VM_LOOP runSwitchLoop
+#define VM_LOOP_THREADED 0
+#include "vmloop.h"
+#undef VM_LOOP
+#undef VM_LOOP_THREADED
+
+#if VM_HAS_THREADED_DISPATCH
+#define VM_LOOP runThreadedLoop
+#define VM_LOOP_THREADED 1
+#include "vmloop.h"
+#undef VM_LOOP
+#undef VM_LOOP_THREADED
+#endif
+
+int runCode(const Code* code, FILE* in, Sink* out, Arena* arena)
+{
+    return runCodeWith(code, VM_BEST, in, out, arena);
+}
+
+int runCodeWith(const Code* code, VmDispatch dispatch, FILE* in, Sink* out, Arena* arena)
+{
+    if(!code || code->numberOfInstructions == 0) return 0;
+
+    // A HALT after the last instruction keeps the machine in the code
+    int numberOfInstructions = code->numberOfInstructions + 1;
+
+    VmInstruction* decoded = arenaRealloc(arena, NULL, 0, numberOfInstructions * sizeof(VmInstruction));
+    int* stack = arenaRealloc(arena, NULL, 0, VM_STACK_SIZE * sizeof(int));
+    int** display = arenaRealloc(arena, NULL, 0, (code->numberOfLevels + 1) * sizeof(int*));
+
+    int err = -1;
+
+    if(decoded && stack && display)
+    {
+        for(int i = 0; i < code->numberOfInstructions; i++)
+            decodeInstruction(&code->instructions[i], &decoded[i]);
+
+        Instruction halt = { OP_SIO, 0, SIO_HALT };
+        decodeInstruction(&halt, &decoded[code->numberOfInstructions]);
+
+        // Every level starts at the record of the program
+        for(int level = 0; level <= code->numberOfLevels; level++)
+            display[level] = stack;
+
+        VmState state;
+        state.stack = stack;
+        state.display = display;
+        state.numberOfInstructions = numberOfInstructions;
+        state.limit = VM_STACK_SIZE - code->stackMargin;
+        state.in = in;
+        state.out = out;
+
+#if VM_HAS_THREADED_DISPATCH
+        if(dispatch != VM_SWITCH)
+            err = runThreadedLoop(decoded, &state);
+        else
+#else
+        (void)dispatch;
+#endif
+            err = runSwitchLoop(decoded, &state);
+    }
+
+    arenaFree(arena, display);
+    arenaFree(arena, stack);
+    arenaFree(arena, decoded);
+
+    return err;
+}
+
+void printVmErrToSink(int errCode, Sink* sink)
+{
+    if(!sink || !errCode) return;
+
+    printfSink(sink, "\nRUNTIME ERROR[%d]: %s.\n", errCode, vmErrorMsg[errCode]);
+}
@@ -0,0 +1,79 @@
+#ifndef __VM_H__
+#define __VM_H__
+
+#include <stdio.h>
+#include "codegen.h"
+#include "arena.h"
+#include "sink.h"
+
+/**
+ * Number of the words of the stack of the P-machine
+ * */
+#define VM_STACK_SIZE (1 << 20)
+
+/**
+ * 1 if the compiler supports computed gotos, which the threaded dispatch
+ * .. needs, 0 otherwise. Building with -DVM_NO_THREADED_DISPATCH sets it to 0.
+ * */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(VM_NO_THREADED_DISPATCH)
+#define VM_HAS_THREADED_DISPATCH 1
+#else
+#define VM_HAS_THREADED_DISPATCH 0
+#endif
+
+/**
+ * How the machine dispatches the instructions.
+ * VM_SWITCH   : a loop around a switch on the operation
+ * VM_THREADED : each instruction jumps right to the next one's handler,
+ *               which falls back to VM_SWITCH if the compiler does not
+ *               support it
+ * VM_BEST     : VM_THREADED if it is supported, VM_SWITCH otherwise
+ * */
+typedef enum {
+    VM_SWITCH,
+    VM_THREADED,
+    VM_BEST
+} VmDispatch;
+
+/**
+ * Runs the given code on a P-machine, whose stack is allocated from the given
+ * .. arena, or from the heap if it is NULL, with the best dispatch.
+ *
+ * The machine has a stack of words, with sp pointing at the top word, and bp
+ * .. at the base of the current activation record. Its display holds the
+ * .. base of the latest record of each level up to the current one, so that
+ * .. the record a level difference of l leads to, base(l), is found at
+ * .. once. The links of a record are the entry of the display it replaced,
+ * .. the dynamic link, the return address and the level of the caller, in
+ * .. this order. The instructions are:
+ * LIT 0, M : pushes M
+ * OPR 0, M : RET returns from the current record, NEG and ODD replace the
+ *            top word, the others pop two words and push their result, 1 or
+ *            0 for the comparisons
+ * LOD L, M : pushes the word at M in base(L)
+ * STO L, M : pops the top word into the word at M in base(L)
+ * CAL L, M : calls the procedure at M, declared in base(L)
+ * INT 0, M : allocates M words, including the links, for the current record
+ * JMP 0, M : jumps to M
+ * JPC 0, M : pops the top word, and jumps to M if it is 0
+ * SIO 0, M : WRITE pops the top word and writes it on a line of its own on
+ *            out, READ reads a number from in and pushes it, HALT stops the
+ *            machine
+ *
+ * Arithmetic wraps around on overflow.
+ * Returns 0 once the machine halts, or the runtime error code that stopped
+ * .. it, see vmErrorMsg, or -1 if the machine cannot be allocated.
+ * */
+int runCode(const Code*, FILE* in, Sink* out, Arena*);
+
+/**
+ * Same as runCode(), except that the instructions are dispatched as given.
+ * */
+int runCodeWith(const Code*, VmDispatch, FILE* in, Sink* out, Arena*);
+
+/**
+ * Given the runtime error code, prints error message on sink.
+ * */
+void printVmErrToSink(int errCode, Sink*);
+
+#endif
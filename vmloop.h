@@ -0,0 +1,225 @@
+/**
+ * The loop of the P-machine, without an include guard, as vm.c includes it
+ * .. once for each dispatch. VM_LOOP is the name of the function, and
+ * .. VM_LOOP_THREADED is 1 for the threaded dispatch, 0 for the switch.
+ *
+ * The loop runs the given decoded code from its first instruction, and
+ * .. returns 0 once it halts, or the runtime error code.
+ * */
+#if VM_LOOP_THREADED
+#define VM_CASE(op) do_##op:
+#define VM_NEXT() goto *(ip++)->handler
+#else
+#define VM_CASE(op) case op:
+#define VM_NEXT() continue
+#endif
+
+// Pops the operands of a binary operator and pushes the given result
+#define VM_BINARY(result) do { int rhs = *sp--; int lhs = *sp; *sp = (result); (void)lhs; (void)rhs; } while(0)
+
+static int VM_LOOP(VmInstruction* code, VmState* state)
+{
+    int* stack = state->stack;
+    int** display = state->display;
+
+    // The links of the program record are all 0
+    int* bp = stack;
+    int* sp = stack + FRAME_LINKS - 1;
+    int level = 0;
+
+    for(int i = 0; i < FRAME_LINKS; i++)
+        stack[i] = 0;
+
+    const VmInstruction* ip = code;
+    int err = 0;
+
+#if VM_LOOP_THREADED
+    static const void* const handlers[] = {
+        [VM_LIT] = &&do_VM_LIT, [VM_LOD0] = &&do_VM_LOD0, [VM_LOD] = &&do_VM_LOD,
+        [VM_STO0] = &&do_VM_STO0, [VM_STO] = &&do_VM_STO, [VM_CAL] = &&do_VM_CAL,
+        [VM_INT] = &&do_VM_INT, [VM_JMP] = &&do_VM_JMP, [VM_JPC] = &&do_VM_JPC,
+        [VM_RET] = &&do_VM_RET, [VM_NEG] = &&do_VM_NEG, [VM_ADD] = &&do_VM_ADD,
+        [VM_SUB] = &&do_VM_SUB, [VM_MUL] = &&do_VM_MUL, [VM_DIV] = &&do_VM_DIV,
+        [VM_ODD] = &&do_VM_ODD, [VM_MOD] = &&do_VM_MOD, [VM_EQL] = &&do_VM_EQL,
+        [VM_NEQ] = &&do_VM_NEQ, [VM_LSS] = &&do_VM_LSS, [VM_LEQ] = &&do_VM_LEQ,
+        [VM_GTR] = &&do_VM_GTR, [VM_GEQ] = &&do_VM_GEQ, [VM_WRITE] = &&do_VM_WRITE,
+        [VM_READ] = &&do_VM_READ, [VM_HALT] = &&do_VM_HALT
+    };
+
+    for(int i = 0; i < state->numberOfInstructions; i++)
+        code[i].handler = handlers[code[i].op];
+
+    VM_NEXT();
+#else
+    for(;;)
+    {
+        switch((ip++)->op)
+        {
+#endif
+
+    VM_CASE(VM_LIT)
+        *++sp = ip[-1].m;
+        VM_NEXT();
+
+    VM_CASE(VM_LOD0)
+        sp[1] = bp[ip[-1].m];
+        sp++;
+        VM_NEXT();
+
+    VM_CASE(VM_LOD)
+        sp[1] = display[level - ip[-1].l][ip[-1].m];
+        sp++;
+        VM_NEXT();
+
+    VM_CASE(VM_STO0)
+        bp[ip[-1].m] = *sp--;
+        VM_NEXT();
+
+    VM_CASE(VM_STO)
+        display[level - ip[-1].l][ip[-1].m] = *sp--;
+        VM_NEXT();
+
+    VM_CASE(VM_CAL)
+    {
+        int callee = level - ip[-1].l + 1;
+        int* frame = sp + 1;
+
+        frame[0] = (int)(display[callee] - stack);
+        frame[1] = (int)(bp - stack);
+        frame[2] = (int)(ip - code);
+        frame[3] = level;
+
+        display[callee] = frame;
+        bp = frame;
+        level = callee;
+
+        ip = code + ip[-1].m;
+        VM_NEXT();
+    }
+
+    VM_CASE(VM_INT)
+        // The links are checked along with the record, by the margin
+        if(bp - stack + ip[-1].m > state->limit)
+        {
+            err = 1;
+            goto halt;
+        }
+
+        sp = bp + ip[-1].m - 1;
+        VM_NEXT();
+
+    VM_CASE(VM_JMP)
+        ip = code + ip[-1].m;
+        VM_NEXT();
+
+    VM_CASE(VM_JPC)
+        if(*sp-- == 0)
+            ip = code + ip[-1].m;
+        VM_NEXT();
+
+    VM_CASE(VM_RET)
+        sp = bp - 1;
+        display[level] = stack + bp[0];
+        level = bp[3];
+        ip = code + bp[2];
+        bp = stack + bp[1];
+        VM_NEXT();
+
+    VM_CASE(VM_NEG)
+        *sp = (int)(0u - (unsigned)*sp);
+        VM_NEXT();
+
+    VM_CASE(VM_ADD)
+        VM_BINARY((int)((unsigned)lhs + (unsigned)rhs));
+        VM_NEXT();
+
+    VM_CASE(VM_SUB)
+        VM_BINARY((int)((unsigned)lhs - (unsigned)rhs));
+        VM_NEXT();
+
+    VM_CASE(VM_MUL)
+        VM_BINARY((int)((unsigned)lhs * (unsigned)rhs));
+        VM_NEXT();
+
+    VM_CASE(VM_DIV)
+        if(*sp == 0)
+        {
+            err = 2;
+            goto halt;
+        }
+
+        // The only quotient that overflows wraps around to itself
+        VM_BINARY(rhs == -1 ? (int)(0u - (unsigned)lhs) : lhs / rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_MOD)
+        if(*sp == 0)
+        {
+            err = 2;
+            goto halt;
+        }
+
+        VM_BINARY(rhs == -1 ? 0 : lhs % rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_ODD)
+        *sp = *sp % 2 != 0;
+        VM_NEXT();
+
+    VM_CASE(VM_EQL)
+        VM_BINARY(lhs == rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_NEQ)
+        VM_BINARY(lhs != rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_LSS)
+        VM_BINARY(lhs < rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_LEQ)
+        VM_BINARY(lhs <= rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_GTR)
+        VM_BINARY(lhs > rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_GEQ)
+        VM_BINARY(lhs >= rhs);
+        VM_NEXT();
+
+    VM_CASE(VM_WRITE)
+        printfSink(state->out, "%d\n", *sp--);
+        VM_NEXT();
+
+    VM_CASE(VM_READ)
+    {
+        int value;
+
+        if(!state->in || fscanf(state->in, "%d", &value) != 1)
+        {
+            err = 3;
+            goto halt;
+        }
+
+        *++sp = value;
+        VM_NEXT();
+    }
+
+    VM_CASE(VM_HALT)
+        goto halt;
+
+#if !VM_LOOP_THREADED
+        }
+    }
+#endif
+
+halt:
+    return err;
+}
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_BINARY